@@ -157,6 +157,11 @@
 #define S3C64XX_EINT0FLTCON2	S3C64XX_GPIOREG(0x918)
 #define S3C64XX_EINT0FLTCON3	S3C64XX_GPIOREG(0x91C)
 
+/* one 8 bit field per pair of EINTs in EINT0FLTCONx */
+#define S3C64XX_EINT0FLT_EN		(1 << 7)
+#define S3C64XX_EINT0FLT_DIGITAL	(1 << 6)
+#define S3C64XX_EINT0FLT_WIDTH_MASK	(0x3f)
+
 #define S3C64XX_EINT0MASK	S3C64XX_GPIOREG(0x920)
 #define S3C64XX_EINT0PEND	S3C64XX_GPIOREG(0x924)
 
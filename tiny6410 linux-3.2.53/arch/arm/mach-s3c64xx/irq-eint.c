@@ -18,6 +18,8 @@
 #include <linux/gpio.h>
 #include <linux/irq.h>
 #include <linux/io.h>
+#include <linux/clk.h>
+#include <linux/err.h>
 
 #include <asm/hardware/vic.h>
 
@@ -28,10 +30,14 @@
 #include <mach/map.h>
 #include <plat/cpu.h>
 #include <plat/pm.h>
+#include <plat/irq-eint.h>
 
 #define eint_offset(irq)	((irq) - IRQ_EINT(0))
 #define eint_irq_to_bit(irq)	((u32)(1 << eint_offset(irq)))
 
+/* rate of the clock counted by the EINT digital filters */
+static unsigned long eint_filter_rate;
+
 static inline void s3c_irq_eint_mask(struct irq_data *data)
 {
 	u32 mask;
@@ -138,6 +144,67 @@ static int s3c_irq_eint_set_type(struct irq_data *data, unsigned int type)
 	return 0;
 }
 
+/**
+ * s3c64xx_eint_set_filter - set the noise filter of a group 0 EINT
+ * @irq: IRQ_EINT(0) to IRQ_EINT(27)
+ * @usecs: shortest pulse to let through, 0 to turn the filter off
+ *
+ * The digital filter ignores pulses shorter than its width, which is
+ * counted in crystal clock cycles and is at most 63 of them, i.e. a few
+ * microseconds. It stops glitches and contact chatter from raising an
+ * interrupt each, but cannot debounce a switch on its own.
+ *
+ * EINTs are filtered in pairs (0 and 1, 2 and 3, ...), so this also
+ * changes the filter of the other EINT of the pair.
+ *
+ * If @usecs is longer than the filter can be, the longest filter is set
+ * and -ERANGE is returned, so that the caller can debounce the rest in
+ * software.
+ */
+int s3c64xx_eint_set_filter(unsigned int irq, unsigned int usecs)
+{
+	int offs = eint_offset(irq);
+	void __iomem *reg;
+	unsigned long flags;
+	unsigned long width;
+	unsigned int shift;
+	u32 ctrl, val = 0;
+	int ret = 0;
+
+	if (offs < 0 || offs > 27 || !eint_filter_rate)
+		return -EINVAL;
+
+	reg = S3C64XX_EINT0FLTCON0 + (offs / 8) * 4;
+	shift = ((offs % 8) / 2) * 8;
+
+	if (usecs) {
+		/* anything near a millisecond is far beyond the filter */
+		if (usecs < USEC_PER_MSEC)
+			width = DIV_ROUND_UP(usecs * (eint_filter_rate / 1000),
+					     USEC_PER_MSEC);
+		else
+			width = S3C64XX_EINT0FLT_WIDTH_MASK + 1;
+
+		if (width > S3C64XX_EINT0FLT_WIDTH_MASK) {
+			width = S3C64XX_EINT0FLT_WIDTH_MASK;
+			ret = -ERANGE;
+		}
+
+		val = S3C64XX_EINT0FLT_EN | S3C64XX_EINT0FLT_DIGITAL | width;
+	}
+
+	local_irq_save(flags);
+
+	ctrl = __raw_readl(reg);
+	ctrl &= ~(0xff << shift);
+	ctrl |= val << shift;
+	__raw_writel(ctrl, reg);
+
+	local_irq_restore(flags);
+
+	return ret;
+}
+
 static struct irq_chip s3c_irq_eint = {
 	.name		= "s3c-eint",
 	.irq_mask	= s3c_irq_eint_mask,
@@ -194,8 +261,15 @@ static void s3c_irq_demux_eint20_27(unsigned int irq, struct irq_desc *desc)
 
 static int __init s3c64xx_init_irq_eint(void)
 {
+	struct clk *xtal;
 	int irq;
 
+	xtal = clk_get(NULL, "xtal");
+	if (!IS_ERR(xtal)) {
+		eint_filter_rate = clk_get_rate(xtal);
+		clk_put(xtal);
+	}
+
 	for (irq = IRQ_EINT(0); irq <= IRQ_EINT(27); irq++) {
 		irq_set_chip_and_handler(irq, &s3c_irq_eint, handle_level_irq);
 		irq_set_chip_data(irq, (void *)eint_irq_to_bit(irq));
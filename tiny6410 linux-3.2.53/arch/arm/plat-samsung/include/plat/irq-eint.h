@@ -0,0 +1,10 @@
+/* arch/arm/plat-samsung/include/plat/irq-eint.h
+ *
+ * Header file for S3C64XX external interrupt (EINT) support
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+*/
+
+extern int s3c64xx_eint_set_filter(unsigned int irq, unsigned int usecs);
@@ -19,6 +19,13 @@
 #include <linux/clk.h>
 #include <linux/io.h>
 #include <linux/pwm.h>
+#include <linux/interrupt.h>
+#include <linux/kfifo.h>
+#include <linux/miscdevice.h>
+#include <linux/moduleparam.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
 
 #include <mach/map.h>
 
@@ -39,6 +46,24 @@ struct pwm_device {
 	unsigned char		 running;
 	unsigned char		 use_count;
 	unsigned char		 pwm_id;
+
+#ifdef CONFIG_S3C24XX_PWM_STREAM
+	/* streaming mode, see Documentation/arm/Samsung/PWM-stream.txt */
+	int			 irq;
+	struct mutex		 stream_mutex;
+	wait_queue_head_t	 stream_wait;
+	DECLARE_KFIFO_PTR(stream_fifo, u32);
+	struct miscdevice	 stream_misc;
+	char			 stream_name[16];
+
+	unsigned int		 stream_period_ns;
+	unsigned long		 stream_tcnt;
+	unsigned long		 stream_tin_ns;
+	unsigned long		 stream_played;
+	unsigned long		 stream_underruns;
+	unsigned char		 stream_running;
+	unsigned char		 stream_starved;
+#endif
 };
 
 #define pwm_dbg(_pwm, msg...) dev_dbg(&(_pwm)->pdev->dev, msg)
@@ -247,6 +272,377 @@ int pwm_config(struct pwm_device *pwm, int duty_ns, int period_ns)
 
 EXPORT_SYMBOL(pwm_config);
 
+#ifdef CONFIG_S3C24XX_PWM_STREAM
+/* Streaming mode.
+ *
+ * The timer has no DMA request, so the compare buffer is fed from the
+ * timer interrupt instead. TCMPB is double buffered: the value written
+ * in the interrupt at the end of one period is loaded by the hardware at
+ * the end of the next, so the handler has a whole period to run.
+ *
+ * Samples are converted to TCMPB values when they are queued, which
+ * leaves the handler with a fifo read and a register write. The writer
+ * is only woken once half of the fifo is free, so it fills it in batches.
+ */
+
+static unsigned int stream_samples = 1024;
+module_param(stream_samples, uint, 0644);
+MODULE_PARM_DESC(stream_samples, "Samples buffered per streaming PWM");
+
+static inline int pwm_stream_writable(struct pwm_device *pwm)
+{
+	return kfifo_avail(&pwm->stream_fifo) >= kfifo_size(&pwm->stream_fifo) / 2;
+}
+
+static irqreturn_t pwm_stream_irq(int irq, void *dev_id)
+{
+	struct pwm_device *pwm = dev_id;
+	u32 tcmp;
+
+	if (!pwm->stream_running)
+		return IRQ_HANDLED;
+
+	if (kfifo_get(&pwm->stream_fifo, &tcmp)) {
+		__raw_writel(tcmp, S3C2410_TCMPB(pwm->pwm_id));
+		pwm->stream_played++;
+		pwm->stream_starved = 0;
+	} else if (!pwm->stream_starved) {
+		/* keep the last duty cycle until more samples arrive */
+		pwm->stream_starved = 1;
+		pwm->stream_underruns++;
+	}
+
+	if (pwm_stream_writable(pwm) && waitqueue_active(&pwm->stream_wait))
+		wake_up_interruptible(&pwm->stream_wait);
+
+	return IRQ_HANDLED;
+}
+
+/* called with stream_mutex held */
+static int pwm_stream_setup(struct pwm_device *pwm)
+{
+	int ret;
+
+	if (!pwm->stream_period_ns)
+		return -EINVAL;
+
+	/* set the period, samples are converted against the resulting TCNTB */
+	ret = pwm_config(pwm, 0, pwm->stream_period_ns);
+	if (ret)
+		return ret;
+
+	pwm->stream_tcnt = __raw_readl(S3C2410_TCNTB(pwm->pwm_id));
+	pwm->stream_tin_ns = NS_IN_HZ / clk_get_rate(pwm->clk);
+	return 0;
+}
+
+static int pwm_stream_tcmp(struct pwm_device *pwm, u32 duty_ns, u32 *tcmp)
+{
+	long val;
+
+	if (duty_ns > pwm->stream_period_ns)
+		return -EINVAL;
+
+	/* same rounding as pwm_config() */
+	val = pwm->stream_tcnt - duty_ns / pwm->stream_tin_ns;
+	if (val == pwm->stream_tcnt)
+		val--;
+	if (val < 0)
+		val = 0;
+
+	*tcmp = val;
+	return 0;
+}
+
+static void pwm_stream_stop(struct pwm_device *pwm)
+{
+	if (pwm->stream_running) {
+		pwm_disable(pwm);
+		pwm->stream_running = 0;
+		synchronize_irq(pwm->irq);
+	}
+
+	kfifo_reset(&pwm->stream_fifo);
+	pwm->stream_tcnt = 0;
+
+	/* TCMPB no longer matches, make the next pwm_config() rewrite it */
+	pwm->duty_ns = -1;
+}
+
+static inline struct pwm_device *pwm_stream_file(struct file *file)
+{
+	return container_of(file->private_data, struct pwm_device, stream_misc);
+}
+
+static int pwm_stream_open(struct inode *inode, struct file *file)
+{
+	struct pwm_device *pwm = pwm_stream_file(file);
+	struct pwm_device *req;
+	int ret;
+
+	req = pwm_request(pwm->pwm_id, pwm->stream_name);
+	if (IS_ERR(req))
+		return PTR_ERR(req);
+
+	ret = kfifo_alloc(&pwm->stream_fifo, max(stream_samples, 16U),
+			  GFP_KERNEL);
+	if (ret)
+		goto err_free;
+
+	pwm->stream_played = 0;
+	pwm->stream_underruns = 0;
+	pwm->stream_starved = 0;
+
+	ret = request_irq(pwm->irq, pwm_stream_irq, 0, pwm->stream_name, pwm);
+	if (ret)
+		goto err_fifo;
+
+	return nonseekable_open(inode, file);
+
+ err_fifo:
+	kfifo_free(&pwm->stream_fifo);
+ err_free:
+	pwm_free(pwm);
+	return ret;
+}
+
+static int pwm_stream_flush(struct file *file, fl_owner_t id)
+{
+	struct pwm_device *pwm = pwm_stream_file(file);
+
+	if (!(file->f_mode & FMODE_WRITE) || (file->f_flags & O_NONBLOCK))
+		return 0;
+
+	/* let the queued samples play out, like close() on a sound device */
+	return wait_event_interruptible(pwm->stream_wait,
+					!pwm->stream_running ||
+					kfifo_is_empty(&pwm->stream_fifo));
+}
+
+static int pwm_stream_release(struct inode *inode, struct file *file)
+{
+	struct pwm_device *pwm = pwm_stream_file(file);
+
+	mutex_lock(&pwm->stream_mutex);
+	pwm_stream_stop(pwm);
+	mutex_unlock(&pwm->stream_mutex);
+
+	free_irq(pwm->irq, pwm);
+	kfifo_free(&pwm->stream_fifo);
+	pwm_free(pwm);
+	return 0;
+}
+
+static ssize_t pwm_stream_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct pwm_device *pwm = pwm_stream_file(file);
+	u32 chunk[32];
+	size_t done = 0;
+	unsigned int n, i;
+	int ret = 0;
+
+	if (count % sizeof(u32))
+		return -EINVAL;
+
+	while (done < count) {
+		mutex_lock(&pwm->stream_mutex);
+
+		if (!pwm->stream_tcnt) {
+			ret = pwm_stream_setup(pwm);
+			if (ret)
+				goto out_unlock;
+		}
+
+		n = min_t(size_t, (count - done) / sizeof(u32),
+			  kfifo_avail(&pwm->stream_fifo));
+		n = min_t(unsigned int, n, ARRAY_SIZE(chunk));
+
+		if (n == 0) {
+			/* full: make sure it is draining before we wait */
+			if (!pwm->stream_running) {
+				pwm->stream_running = 1;
+				pwm_enable(pwm);
+			}
+			mutex_unlock(&pwm->stream_mutex);
+
+			if (file->f_flags & O_NONBLOCK) {
+				ret = -EAGAIN;
+				break;
+			}
+
+			ret = wait_event_interruptible(pwm->stream_wait,
+						       pwm_stream_writable(pwm));
+			if (ret)
+				break;
+			continue;
+		}
+
+		if (copy_from_user(chunk, buf + done, n * sizeof(u32))) {
+			ret = -EFAULT;
+			goto out_unlock;
+		}
+
+		for (i = 0; i < n; i++) {
+			ret = pwm_stream_tcmp(pwm, chunk[i], &chunk[i]);
+			if (ret)
+				goto out_unlock;
+		}
+
+		kfifo_in(&pwm->stream_fifo, chunk, n);
+		done += n * sizeof(u32);
+
+		mutex_unlock(&pwm->stream_mutex);
+	}
+
+	mutex_lock(&pwm->stream_mutex);
+ out_unlock:
+	if (!pwm->stream_running && !kfifo_is_empty(&pwm->stream_fifo)) {
+		pwm->stream_running = 1;
+		pwm_enable(pwm);
+	}
+	mutex_unlock(&pwm->stream_mutex);
+
+	return done ? done : ret;
+}
+
+static unsigned int pwm_stream_poll(struct file *file, poll_table *wait)
+{
+	struct pwm_device *pwm = pwm_stream_file(file);
+
+	poll_wait(file, &pwm->stream_wait, wait);
+
+	return pwm_stream_writable(pwm) ? POLLOUT | POLLWRNORM : 0;
+}
+
+static const struct file_operations pwm_stream_fops = {
+	.owner		= THIS_MODULE,
+	.open		= pwm_stream_open,
+	.flush		= pwm_stream_flush,
+	.release	= pwm_stream_release,
+	.write		= pwm_stream_write,
+	.poll		= pwm_stream_poll,
+	.llseek		= no_llseek,
+};
+
+static ssize_t pwm_show_stream_period(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct pwm_device *pwm = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", pwm->stream_period_ns);
+}
+
+static ssize_t pwm_store_stream_period(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct pwm_device *pwm = dev_get_drvdata(dev);
+	unsigned long val;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	if (val == 0 || val > NS_IN_HZ)
+		return -ERANGE;
+
+	mutex_lock(&pwm->stream_mutex);
+	if (pwm->stream_running) {
+		ret = -EBUSY;
+	} else {
+		pwm->stream_period_ns = val;
+		pwm->stream_tcnt = 0;
+	}
+	mutex_unlock(&pwm->stream_mutex);
+
+	return ret ? ret : count;
+}
+
+static ssize_t pwm_show_stream_played(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct pwm_device *pwm = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%lu\n", pwm->stream_played);
+}
+
+static ssize_t pwm_show_stream_underruns(struct device *dev,
+					 struct device_attribute *attr,
+					 char *buf)
+{
+	struct pwm_device *pwm = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%lu\n", pwm->stream_underruns);
+}
+
+static DEVICE_ATTR(stream_period_ns, S_IWUSR | S_IRUGO,
+		   pwm_show_stream_period, pwm_store_stream_period);
+static DEVICE_ATTR(stream_played, S_IRUGO, pwm_show_stream_played, NULL);
+static DEVICE_ATTR(stream_underruns, S_IRUGO, pwm_show_stream_underruns, NULL);
+
+static struct attribute *pwm_stream_attrs[] = {
+	&dev_attr_stream_period_ns.attr,
+	&dev_attr_stream_played.attr,
+	&dev_attr_stream_underruns.attr,
+	NULL
+};
+
+static const struct attribute_group pwm_stream_attr_group = {
+	.attrs = pwm_stream_attrs,
+};
+
+static void s3c_pwm_stream_probe(struct pwm_device *pwm)
+{
+	struct device *dev = &pwm->pdev->dev;
+	int ret;
+
+	pwm->irq = platform_get_irq(pwm->pdev, 0);
+	if (pwm->irq < 0)
+		return;
+
+	mutex_init(&pwm->stream_mutex);
+	init_waitqueue_head(&pwm->stream_wait);
+
+	snprintf(pwm->stream_name, sizeof(pwm->stream_name),
+		 "pwm-stream%d", pwm->pwm_id);
+	pwm->stream_misc.minor = MISC_DYNAMIC_MINOR;
+	pwm->stream_misc.name = pwm->stream_name;
+	pwm->stream_misc.fops = &pwm_stream_fops;
+	pwm->stream_misc.parent = dev;
+
+	ret = sysfs_create_group(&dev->kobj, &pwm_stream_attr_group);
+	if (ret)
+		goto err;
+
+	ret = misc_register(&pwm->stream_misc);
+	if (ret) {
+		sysfs_remove_group(&dev->kobj, &pwm_stream_attr_group);
+		goto err;
+	}
+
+	return;
+
+ err:
+	/* the PWM itself is still usable */
+	dev_warn(dev, "streaming not available (%d)\n", ret);
+	pwm->irq = -1;
+}
+
+static void s3c_pwm_stream_remove(struct pwm_device *pwm)
+{
+	if (pwm->irq < 0)
+		return;
+
+	misc_deregister(&pwm->stream_misc);
+	sysfs_remove_group(&pwm->pdev->dev.kobj, &pwm_stream_attr_group);
+}
+#else
+static inline void s3c_pwm_stream_probe(struct pwm_device *pwm) { }
+static inline void s3c_pwm_stream_remove(struct pwm_device *pwm) { }
+#endif /* CONFIG_S3C24XX_PWM_STREAM */
+
 static int pwm_register(struct pwm_device *pwm)
 {
 	pwm->duty_ns = -1;
@@ -326,6 +722,7 @@ static int s3c_pwm_probe(struct platform_device *pdev)
 		 pwm_is_tdiv(pwm) ? "div" : "ext", pwm->tcon_base);
 
 	platform_set_drvdata(pdev, pwm);
+	s3c_pwm_stream_probe(pwm);
 	return 0;
 
  err_clk_tdiv:
@@ -345,6 +742,7 @@ static int __devexit s3c_pwm_remove(struct platform_device *pdev)
 {
 	struct pwm_device *pwm = platform_get_drvdata(pdev);
 
+	s3c_pwm_stream_remove(pwm);
 	clk_disable(pwm->clk_div);
 	clk_disable(pwm->clk);
 	clk_put(pwm->clk_div);
@@ -0,0 +1,537 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  Based on the deadline i/o scheduler,
+ *  Copyright (C) 2002 Jens Axboe <axboe@kernel.dk>
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
+
+/*
+ * See Documentation/block/flash-iosched.txt
+ */
+static const int write_expire = HZ / 4;	/* max time an async write is held */
+static const int sync_write_expire = HZ / 50;	/* ditto for sync writes */
+static const int writes_starved = 2;	/* max times reads can starve a write */
+static const unsigned int default_unit = 4 << (20 - 9);	/* 4MB in sectors */
+
+/* unit fill buckets: <25%, <50%, <75%, <100%, full */
+#define FLASH_FILL_BUCKETS	5
+
+struct flash_data {
+	struct request_queue *queue;
+
+	/*
+	 * requests are present on both sort_list and fifo_list
+	 */
+	struct rb_root sort_list[2];
+	struct list_head fifo_list[2];
+	unsigned int nr_writes;
+
+	/*
+	 * write unit currently being dispatched
+	 */
+	struct request *next_write;
+	sector_t batch_unit;
+	unsigned int starved;		/* times reads have starved writes */
+
+	struct timer_list hold_timer;
+	struct work_struct unplug_work;
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int write_expire;
+	int sync_write_expire;
+	int writes_starved;
+	unsigned int unit_sectors;	/* 0: use the device's erase size */
+
+	/*
+	 * statistics
+	 */
+	unsigned long units_dispatched;
+	unsigned long units_expired;
+	unsigned long unit_fill[FLASH_FILL_BUCKETS];
+};
+
+/*
+ * The unit writes are grouped by: set by the user, or else the
+ * preferred erase size the driver advertised as discard granularity
+ * (SD allocation unit / eMMC erase group), or else the optimal I/O size.
+ * Drivers set those limits after the elevator is attached, so this is
+ * looked up every time rather than cached at init.
+ */
+static unsigned int flash_unit_sectors(struct flash_data *fd)
+{
+	struct queue_limits *lim = &fd->queue->limits;
+
+	if (fd->unit_sectors)
+		return fd->unit_sectors;
+	if (lim->discard_granularity >= 1024)
+		return lim->discard_granularity >> 9;
+	if (lim->io_opt >= 1024)
+		return lim->io_opt >> 9;
+	return default_unit;
+}
+
+static inline sector_t flash_unit(sector_t sector, unsigned int unit_sectors)
+{
+	sector_div(sector, unit_sectors);
+	return sector;
+}
+
+static inline struct rb_root *
+flash_rb_root(struct flash_data *fd, struct request *rq)
+{
+	return &fd->sort_list[rq_data_dir(rq)];
+}
+
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int data_dir = rq_data_dir(rq);
+	unsigned long expire = 0;
+
+	elv_rb_add(flash_rb_root(fd, rq), rq);
+
+	if (data_dir == WRITE) {
+		expire = rq_is_sync(rq) ? fd->sync_write_expire :
+					  fd->write_expire;
+		fd->nr_writes++;
+	}
+
+	rq_set_fifo_time(rq, jiffies + expire);
+	list_add_tail(&rq->queuelist, &fd->fifo_list[data_dir]);
+}
+
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	if (rq_data_dir(rq) == WRITE) {
+		if (fd->next_write == rq) {
+			struct rb_node *node = rb_next(&rq->rb_node);
+
+			fd->next_write = node ? rb_entry_rq(node) : NULL;
+		}
+		fd->nr_writes--;
+	}
+
+	rq_fifo_clear(rq);
+	elv_rb_del(flash_rb_root(fd, rq), rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	sector_t sector = bio->bi_sector + bio_sectors(bio);
+	struct request *__rq;
+
+	/*
+	 * check for front merge, back merges are found through the
+	 * elevator hash
+	 */
+	__rq = elv_rb_find(&fd->sort_list[bio_data_dir(bio)], sector);
+	if (__rq) {
+		BUG_ON(sector != blk_rq_pos(__rq));
+
+		if (elv_rq_merge_ok(__rq, bio)) {
+			*req = __rq;
+			return ELEVATOR_FRONT_MERGE;
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(flash_rb_root(fd, req), req);
+		elv_rb_add(flash_rb_root(fd, req), req);
+	}
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	flash_remove_request(q, next);
+}
+
+static void flash_move_to_dispatch(struct request_queue *q, struct request *rq)
+{
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+static void flash_account_unit(struct flash_data *fd, unsigned int fill,
+			       unsigned int unit_sectors, int expired)
+{
+	unsigned int bucket;
+
+	if (fill >= unit_sectors)
+		bucket = FLASH_FILL_BUCKETS - 1;
+	else
+		bucket = div_u64((u64)fill * (FLASH_FILL_BUCKETS - 1),
+				 unit_sectors);
+
+	fd->unit_fill[bucket]++;
+	fd->units_dispatched++;
+	if (expired)
+		fd->units_expired++;
+}
+
+/*
+ * Walk the queued writes in sector order, one unit at a time, and
+ * decide which unit to write next:
+ *
+ *  - a unit that is completely covered goes first, it will be written
+ *    in one go and the card never has to merge it with old data;
+ *  - then the unit holding the oldest expired write;
+ *  - when forced, or when so many writes are held that submitters are
+ *    about to block, the fullest unit.
+ *
+ * Otherwise everything is held back and *wait is set to the time the
+ * first write expires.  Returns the lowest request of the chosen unit.
+ */
+static struct request *
+flash_pick_unit(struct flash_data *fd, int force, unsigned long *wait)
+{
+	unsigned int unit_sectors = flash_unit_sectors(fd);
+	struct request *first = NULL, *fullest = NULL, *oldest = NULL;
+	unsigned int fill = 0, fullest_fill = 0, oldest_fill = 0;
+	unsigned long oldest_time = 0;
+	sector_t unit, cur = 0;
+	struct rb_node *node;
+	struct request *rq;
+
+	for (node = rb_first(&fd->sort_list[WRITE]); node;
+	     node = rb_next(node)) {
+		rq = rb_entry_rq(node);
+		unit = flash_unit(blk_rq_pos(rq), unit_sectors);
+
+		if (!first || unit != cur) {
+			if (first && fill > fullest_fill) {
+				fullest = first;
+				fullest_fill = fill;
+			}
+			first = rq;
+			cur = unit;
+			fill = 0;
+		}
+
+		fill += blk_rq_sectors(rq);
+
+		if (!oldest || time_before(rq_fifo_time(rq), oldest_time)) {
+			oldest = first;
+			oldest_time = rq_fifo_time(rq);
+		}
+		if (oldest == first)
+			oldest_fill = fill;
+	}
+	if (first && fill > fullest_fill) {
+		fullest = first;
+		fullest_fill = fill;
+	}
+
+	if (!fullest)
+		return NULL;
+
+	fd->batch_unit = flash_unit(blk_rq_pos(fullest), unit_sectors);
+	if (fullest_fill >= unit_sectors) {
+		flash_account_unit(fd, fullest_fill, unit_sectors, 0);
+		return fullest;
+	}
+
+	if (!time_before(jiffies, oldest_time)) {
+		fd->batch_unit = flash_unit(blk_rq_pos(oldest), unit_sectors);
+		flash_account_unit(fd, oldest_fill, unit_sectors, 1);
+		return oldest;
+	}
+
+	if (force || fd->nr_writes >= fd->queue->nr_requests / 2) {
+		flash_account_unit(fd, fullest_fill, unit_sectors, 0);
+		return fullest;
+	}
+
+	*wait = oldest_time;
+	return NULL;
+}
+
+/*
+ * Next write of the unit being dispatched, if any is left.
+ */
+static struct request *flash_next_write(struct flash_data *fd)
+{
+	struct request *rq = fd->next_write;
+
+	if (rq && flash_unit(blk_rq_pos(rq), flash_unit_sectors(fd)) ==
+		  fd->batch_unit)
+		return rq;
+
+	fd->next_write = NULL;
+	return NULL;
+}
+
+/*
+ * Reads go first and in arrival order: there is no seek to optimise
+ * for.  Writes are dispatched a whole unit at a time, in sector order.
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int reads = !list_empty(&fd->fifo_list[READ]);
+	const int writes = !list_empty(&fd->fifo_list[WRITE]);
+	unsigned long wait = 0;
+	struct request *rq;
+
+	if (reads && !(writes && fd->starved >= fd->writes_starved)) {
+		if (writes)
+			fd->starved++;
+		rq = rq_entry_fifo(fd->fifo_list[READ].next);
+		goto dispatch;
+	}
+
+	if (!writes)
+		return 0;
+
+	rq = flash_next_write(fd);
+	if (!rq)
+		rq = flash_pick_unit(fd, force, &wait);
+	if (!rq) {
+		/*
+		 * All units are being held back.  Let reads through if
+		 * there are any, and come back when the oldest write
+		 * expires.
+		 */
+		mod_timer(&fd->hold_timer, wait);
+		if (!reads)
+			return 0;
+		rq = rq_entry_fifo(fd->fifo_list[READ].next);
+		goto dispatch;
+	}
+
+	fd->starved = 0;
+	{
+		struct rb_node *node = rb_next(&rq->rb_node);
+
+		fd->next_write = node ? rb_entry_rq(node) : NULL;
+	}
+
+dispatch:
+	flash_move_to_dispatch(q, rq);
+	return 1;
+}
+
+static void flash_kick_queue(struct work_struct *work)
+{
+	struct flash_data *fd =
+		container_of(work, struct flash_data, unplug_work);
+	struct request_queue *q = fd->queue;
+
+	spin_lock_irq(q->queue_lock);
+	__blk_run_queue(q);
+	spin_unlock_irq(q->queue_lock);
+}
+
+static void flash_hold_timer(unsigned long data)
+{
+	struct flash_data *fd = (struct flash_data *) data;
+
+	kblockd_schedule_work(fd->queue, &fd->unplug_work);
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	del_timer_sync(&fd->hold_timer);
+	cancel_work_sync(&fd->unplug_work);
+
+	BUG_ON(!list_empty(&fd->fifo_list[READ]));
+	BUG_ON(!list_empty(&fd->fifo_list[WRITE]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	fd->queue = q;
+	INIT_LIST_HEAD(&fd->fifo_list[READ]);
+	INIT_LIST_HEAD(&fd->fifo_list[WRITE]);
+	fd->sort_list[READ] = RB_ROOT;
+	fd->sort_list[WRITE] = RB_ROOT;
+	setup_timer(&fd->hold_timer, flash_hold_timer, (unsigned long) fd);
+	INIT_WORK(&fd->unplug_work, flash_kick_queue);
+	fd->write_expire = write_expire;
+	fd->sync_write_expire = sync_write_expire;
+	fd->writes_starved = writes_starved;
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_write_expire_show, fd->write_expire, 1);
+SHOW_FUNCTION(flash_sync_write_expire_show, fd->sync_write_expire, 1);
+SHOW_FUNCTION(flash_writes_starved_show, fd->writes_starved, 0);
+SHOW_FUNCTION(flash_unit_size_show, flash_unit_sectors(fd) >> 1, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_write_expire_store, &fd->write_expire, 0, INT_MAX, 1);
+STORE_FUNCTION(flash_sync_write_expire_store, &fd->sync_write_expire, 0, INT_MAX, 1);
+STORE_FUNCTION(flash_writes_starved_store, &fd->writes_starved, INT_MIN, INT_MAX, 0);
+#undef STORE_FUNCTION
+
+static ssize_t
+flash_unit_size_store(struct elevator_queue *e, const char *page, size_t count)
+{
+	struct flash_data *fd = e->elevator_data;
+	int kb;
+	int ret = flash_var_store(&kb, page, count);
+
+	/* 0 goes back to the device's preferred erase size */
+	if (kb < 0)
+		kb = 0;
+	fd->unit_sectors = min_t(unsigned int, kb, INT_MAX >> 1) << 1;
+	return ret;
+}
+
+static ssize_t flash_unit_stats_show(struct elevator_queue *e, char *page)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	return sprintf(page, "%lu %lu %lu %lu %lu %lu %lu\n",
+		       fd->units_dispatched, fd->units_expired,
+		       fd->unit_fill[0], fd->unit_fill[1], fd->unit_fill[2],
+		       fd->unit_fill[3], fd->unit_fill[4]);
+}
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(write_expire),
+	FD_ATTR(sync_write_expire),
+	FD_ATTR(writes_starved),
+	FD_ATTR(unit_size),
+	__ATTR(unit_stats, S_IRUGO, flash_unit_stats_show, NULL),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
@@ -37,6 +37,7 @@
 #include <plat/gpio-cfg.h>
 #include <plat/gpio-cfg-helpers.h>
 #include <plat/gpio-fns.h>
+#include <plat/irq-eint.h>
 #include <plat/pm.h>
 
 #ifndef DEBUG_GPIO
@@ -851,6 +852,36 @@ static int samsung_gpiolib_get(struct gpio_chip *chip, unsigned offset)
 	return val;
 }
 
+/*
+ * Multi-pin variants of samsung_gpiolib_set() and samsung_gpiolib_get(),
+ * doing one access to the DAT register for all the pins of the bank.
+ */
+static void samsung_gpiolib_set_multiple(struct gpio_chip *chip,
+					 unsigned long mask, unsigned long bits)
+{
+	struct samsung_gpio_chip *ourchip = to_samsung_gpio(chip);
+	void __iomem *base = ourchip->base;
+	unsigned long flags;
+	unsigned long dat;
+
+	samsung_gpio_lock(ourchip, flags);
+
+	dat = __raw_readl(base + 0x04);
+	dat &= ~mask;
+	dat |= bits & mask;
+	__raw_writel(dat, base + 0x04);
+
+	samsung_gpio_unlock(ourchip, flags);
+}
+
+static unsigned long samsung_gpiolib_get_multiple(struct gpio_chip *chip,
+						  unsigned long mask)
+{
+	struct samsung_gpio_chip *ourchip = to_samsung_gpio(chip);
+
+	return __raw_readl(ourchip->base + 0x04) & mask;
+}
+
 /*
  * CONFIG_S3C_GPIO_TRACK enables the tracking of the s3c specific gpios
  * for use with the configuration calls, and other parts of the s3c gpiolib
@@ -908,6 +939,10 @@ static void __init samsung_gpiolib_add(struct samsung_gpio_chip *chip)
 		gc->set = samsung_gpiolib_set;
 	if (!gc->get)
 		gc->get = samsung_gpiolib_get;
+	if (!gc->set_multiple && gc->set == samsung_gpiolib_set)
+		gc->set_multiple = samsung_gpiolib_set_multiple;
+	if (!gc->get_multiple && gc->get == samsung_gpiolib_get)
+		gc->get_multiple = samsung_gpiolib_get_multiple;
 
 #ifdef CONFIG_PM
 	if (chip->pm != NULL) {
@@ -1068,6 +1103,18 @@ static int s3c64xx_gpiolib_lbank_to_irq(struct gpio_chip *chip, unsigned pin)
 {
 	return pin >= 8 ? IRQ_EINT(16) + pin - 8 : -ENXIO;
 }
+
+/* debounce the group 0 EINTs with their hardware filter */
+static int s3c64xx_gpiolib_eint_set_debounce(struct gpio_chip *chip,
+					     unsigned pin, unsigned debounce)
+{
+	int irq = chip->to_irq(chip, pin);
+
+	if (irq < 0)
+		return -ENOTSUPP;
+
+	return s3c64xx_eint_set_filter(irq, debounce);
+}
 #endif
 
 struct samsung_gpio_chip s3c24xx_gpios[] = {
@@ -1246,6 +1293,7 @@ static struct samsung_gpio_chip s3c64xx_gpios_4bit[] = {
 			.ngpio	= S3C64XX_GPIO_M_NR,
 			.label	= "GPM",
 			.to_irq = s3c64xx_gpiolib_mbank_to_irq,
+			.set_debounce = s3c64xx_gpiolib_eint_set_debounce,
 		},
 	},
 #endif
@@ -1276,6 +1324,7 @@ static struct samsung_gpio_chip s3c64xx_gpios_4bit2[] = {
 			.ngpio	= S3C64XX_GPIO_L_NR,
 			.label	= "GPL",
 			.to_irq = s3c64xx_gpiolib_lbank_to_irq,
+			.set_debounce = s3c64xx_gpiolib_eint_set_debounce,
 		},
 	},
 #endif
@@ -1335,6 +1384,7 @@ static struct samsung_gpio_chip s3c64xx_gpios_2bit[] = {
 			.ngpio	= S3C64XX_GPIO_N_NR,
 			.label	= "GPN",
 			.to_irq = samsung_gpiolib_to_irq,
+			.set_debounce = s3c64xx_gpiolib_eint_set_debounce,
 		},
 	},
 #endif
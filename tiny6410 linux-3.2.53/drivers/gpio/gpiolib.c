@@ -11,6 +11,10 @@
 #include <linux/of_gpio.h>
 #include <linux/idr.h>
 #include <linux/slab.h>
+#include <linux/miscdevice.h>
+#include <linux/gpiodev.h>
+#include <linux/uaccess.h>
+#include <linux/delay.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/gpio.h>
@@ -1001,6 +1005,304 @@ static int __init gpiolib_sysfs_init(void)
 }
 postcore_initcall(gpiolib_sysfs_init);
 
+#ifdef CONFIG_GPIO_DEV
+
+/*
+ * /dev/gpio lets userspace read or write several GPIOs with one ioctl,
+ * instead of one sysfs "value" file access per GPIO.
+ *
+ * By default the same GPIOs as through sysfs are accessible: they must be
+ * exported, and must be outputs to be written. The active_low setting is
+ * honoured.
+ *
+ * Alternatively, an open file may claim a set of GPIOs of one gpio_chip
+ * (GPIO_CLAIM). They are then requested on behalf of that file, so neither
+ * kernel drivers nor sysfs nor other files can use them, and are released
+ * when the file is closed. Through that file only the claimed GPIOs can be
+ * accessed, without the sysfs checks, and a sequence of values can be
+ * written with one GPIO_WRITE_BATCH call. Since values are written with
+ * gpio_set_multiple(), the other GPIOs of the chip are never disturbed.
+ *
+ * Mapping the GPIO registers into the process is not offered: on most SoCs
+ * (the Samsung ones included) the data registers of all the banks share one
+ * page and have no per-bit set/clear aliases, so the kernel could not stop
+ * the process from changing GPIOs it does not own.
+ */
+
+/* Values of a GPIO_WRITE_BATCH call are copied in chunks of this size */
+#define GPIO_BATCH_CHUNK	64
+
+/* Longest delay allowed between the values of a batch */
+#define GPIO_BATCH_MAX_DELAY	(1000 * NSEC_PER_USEC)
+
+struct gpio_dev_file {
+	struct mutex		lock;
+	unsigned		base;
+	unsigned long		mask;	/* claimed GPIOs, bit N is base + N */
+	unsigned long		out;	/* claimed GPIOs set up as outputs */
+};
+
+/*
+ * Check access to unclaimed GPIOs through sysfs rules.
+ *
+ * Returns zero and the mask of active-low GPIOs among those selected by
+ * @mask in *@active_low, or a negative errno. Caller holds sysfs_lock.
+ */
+static int gpio_dev_check(unsigned base, unsigned long mask, bool out,
+		unsigned long *active_low)
+{
+	unsigned long	m;
+
+	*active_low = 0;
+
+	for (m = mask; m; m &= m - 1) {
+		unsigned		bit = __ffs(m);
+		unsigned		gpio = base + bit;
+		struct gpio_desc	*desc;
+
+		if (!gpio_is_valid(gpio))
+			return -EINVAL;
+		desc = &gpio_desc[gpio];
+		if (!test_bit(FLAG_EXPORT, &desc->flags))
+			return -EIO;
+		if (out && !test_bit(FLAG_IS_OUT, &desc->flags))
+			return -EPERM;
+		if (test_bit(FLAG_ACTIVE_LOW, &desc->flags))
+			*active_low |= 1UL << bit;
+	}
+	return 0;
+}
+
+static void gpio_dev_free(unsigned base, unsigned long mask)
+{
+	for (; mask; mask &= mask - 1)
+		gpio_free(base + __ffs(mask));
+}
+
+static int gpio_dev_claim(struct gpio_dev_file *df,
+		struct gpio_claim __user *argp)
+{
+	struct gpio_claim	gc;
+	struct gpio_chip	*chip = NULL;
+	unsigned long		m, done = 0;
+	int			status = 0;
+
+	if (copy_from_user(&gc, argp, sizeof(gc)))
+		return -EFAULT;
+	if (!gc.mask || (gc.output & ~gc.mask))
+		return -EINVAL;
+
+	mutex_lock(&df->lock);
+	if (df->mask) {
+		status = -EBUSY;
+		goto out;
+	}
+
+	for (m = gc.mask; m; m &= m - 1) {
+		unsigned	bit = __ffs(m);
+		unsigned	gpio = gc.base + bit;
+
+		status = gpio_is_valid(gpio) ? gpio_request(gpio, "gpiodev")
+					     : -EINVAL;
+		if (status)
+			goto fail;
+		done |= 1UL << bit;
+
+		/* requested, so the chip can't go away */
+		if (!chip)
+			chip = gpio_to_chip(gpio);
+		if (gpio_to_chip(gpio) != chip) {
+			status = -EXDEV;
+			goto fail;
+		}
+
+		if (gc.output & (1UL << bit))
+			status = gpio_direction_output(gpio,
+					!!(gc.bits & (1UL << bit)));
+		else
+			status = gpio_direction_input(gpio);
+		if (status)
+			goto fail;
+	}
+
+	df->base = gc.base;
+	df->mask = gc.mask;
+	df->out = gc.output;
+	goto out;
+
+fail:
+	gpio_dev_free(gc.base, done);
+out:
+	mutex_unlock(&df->lock);
+	return status;
+}
+
+/*
+ * Wait between two values of a batch.  Delays of a millisecond sleep,
+ * shorter ones busy-wait; either way the CPU may be given up afterwards,
+ * so that a long batch does not stall everything else on UP.
+ */
+static void gpio_batch_delay(unsigned delay_ns)
+{
+	unsigned long	us = delay_ns / NSEC_PER_USEC;
+
+	if (delay_ns >= NSEC_PER_MSEC) {
+		usleep_range(us, us + us / 8);
+		return;
+	}
+	ndelay(delay_ns);
+	cond_resched();
+}
+
+static int gpio_dev_write_batch(struct gpio_dev_file *df,
+		struct gpio_batch __user *argp)
+{
+	struct gpio_batch	gb;
+	const __u32 __user	*values;
+	__u32			buf[GPIO_BATCH_CHUNK];
+	unsigned		done = 0;
+	int			status = 0;
+
+	if (copy_from_user(&gb, argp, sizeof(gb)))
+		return -EFAULT;
+	if (gb.delay_ns > GPIO_BATCH_MAX_DELAY || gb.count > INT_MAX ||
+			gb.padding)
+		return -EINVAL;
+	values = (const __u32 __user *)(unsigned long)gb.values;
+
+	mutex_lock(&df->lock);
+	if (!df->mask || gb.mask & ~df->out) {
+		status = df->mask ? -EPERM : -EINVAL;
+		goto out;
+	}
+
+	while (done < gb.count) {
+		unsigned	i, n = min_t(unsigned, gb.count - done,
+					     GPIO_BATCH_CHUNK);
+
+		if (copy_from_user(buf, values + done, n * sizeof(*buf))) {
+			status = -EFAULT;
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			if ((i || done) && gb.delay_ns)
+				gpio_batch_delay(gb.delay_ns);
+			gpio_set_multiple(df->base, gb.mask, buf[i]);
+		}
+		done += n;
+
+		if (done < gb.count) {
+			if (fatal_signal_pending(current)) {
+				status = -EINTR;
+				break;
+			}
+			cond_resched();
+		}
+	}
+out:
+	mutex_unlock(&df->lock);
+	return done ? done : status;
+}
+
+static long gpio_dev_ioctl(struct file *file, unsigned int cmd,
+		unsigned long arg)
+{
+	struct gpio_dev_file		*df = file->private_data;
+	struct gpio_multiple __user	*argp = (void __user *)arg;
+	struct gpio_multiple		gm;
+	unsigned long			active_low = 0;
+	long				status = 0;
+
+	switch (cmd) {
+	case GPIO_CLAIM:
+		return gpio_dev_claim(df, (void __user *)arg);
+	case GPIO_WRITE_BATCH:
+		return gpio_dev_write_batch(df, (void __user *)arg);
+	case GPIO_GET_MULTIPLE:
+	case GPIO_SET_MULTIPLE:
+		break;
+	default:
+		return -ENOTTY;
+	}
+
+	if (copy_from_user(&gm, argp, sizeof(gm)))
+		return -EFAULT;
+
+	mutex_lock(&df->lock);
+	if (df->mask) {
+		/* only the claimed GPIOs */
+		if (gm.base != df->base || gm.mask & ~df->mask)
+			status = -EINVAL;
+		else if (cmd == GPIO_SET_MULTIPLE && gm.mask & ~df->out)
+			status = -EPERM;
+	} else {
+		mutex_lock(&sysfs_lock);
+		status = gpio_dev_check(gm.base, gm.mask,
+				cmd == GPIO_SET_MULTIPLE, &active_low);
+	}
+
+	if (!status) {
+		if (cmd == GPIO_SET_MULTIPLE)
+			gpio_set_multiple(gm.base, gm.mask,
+					gm.bits ^ active_low);
+		else
+			gm.bits = (gpio_get_multiple(gm.base, gm.mask)
+					^ active_low) & gm.mask;
+	}
+
+	if (!df->mask)
+		mutex_unlock(&sysfs_lock);
+	mutex_unlock(&df->lock);
+
+	if (!status && cmd == GPIO_GET_MULTIPLE &&
+			copy_to_user(argp, &gm, sizeof(gm)))
+		status = -EFAULT;
+	return status;
+}
+
+static int gpio_dev_open(struct inode *inode, struct file *file)
+{
+	struct gpio_dev_file	*df;
+
+	df = kzalloc(sizeof(*df), GFP_KERNEL);
+	if (!df)
+		return -ENOMEM;
+	mutex_init(&df->lock);
+	file->private_data = df;
+	return nonseekable_open(inode, file);
+}
+
+static int gpio_dev_release(struct inode *inode, struct file *file)
+{
+	struct gpio_dev_file	*df = file->private_data;
+
+	gpio_dev_free(df->base, df->mask);
+	kfree(df);
+	return 0;
+}
+
+static const struct file_operations gpio_dev_fops = {
+	.owner		= THIS_MODULE,
+	.open		= gpio_dev_open,
+	.release	= gpio_dev_release,
+	.unlocked_ioctl	= gpio_dev_ioctl,
+	.llseek		= no_llseek,
+};
+
+static struct miscdevice gpio_dev = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= "gpio",
+	.fops		= &gpio_dev_fops,
+};
+
+static int __init gpiolib_dev_init(void)
+{
+	return misc_register(&gpio_dev);
+}
+device_initcall(gpiolib_dev_init);
+
+#endif /* CONFIG_GPIO_DEV */
+
 #else
 static inline int gpiochip_export(struct gpio_chip *chip)
 {
@@ -1650,6 +1952,122 @@ void gpio_set_value_cansleep(unsigned gpio, int value)
 }
 EXPORT_SYMBOL_GPL(gpio_set_value_cansleep);
 
+/*
+ * Split the GPIOs base..base + BITS_PER_LONG - 1 selected by @mask into
+ * per-chip groups. For the group starting at the lowest bit set in @mask,
+ * return its chip and the bits of @mask it covers in *@group, and the
+ * offset of GPIO @base within that chip in *@shift (it may be negative).
+ */
+static struct gpio_chip *gpio_multiple_group(unsigned base, unsigned long mask,
+		unsigned long *group, int *shift)
+{
+	unsigned		gpio = base + __ffs(mask);
+	struct gpio_chip	*chip;
+	unsigned		end;
+
+	if (!gpio_is_valid(gpio) || !(chip = gpio_to_chip(gpio))) {
+		WARN(1, "%s: invalid GPIO %d\n", __func__, gpio);
+		*group = mask & -mask;
+		return NULL;
+	}
+
+	end = chip->base + chip->ngpio - base;
+	*group = end < BITS_PER_LONG ? mask & ((1UL << end) - 1) : mask;
+	*shift = base - chip->base;
+	return chip;
+}
+
+/**
+ * gpio_get_multiple() - read several gpio values at once
+ * @base: gpio corresponding to bit 0 of @mask
+ * @mask: bit N selects gpio @base + N
+ * Context: process context if any of the gpios may sleep, otherwise any
+ *
+ * Returns the values of the selected gpios, bit N holding the value of
+ * gpio @base + N. The gpios of each gpio_chip with a get_multiple() method
+ * are read in one access; others are read one by one. As with
+ * gpio_get_value(), the gpios must have been requested.
+ */
+unsigned long gpio_get_multiple(unsigned base, unsigned long mask)
+{
+	unsigned long	bits = 0;
+
+	while (mask) {
+		struct gpio_chip	*chip;
+		unsigned long		group, val;
+		int			shift = 0;
+
+		chip = gpio_multiple_group(base, mask, &group, &shift);
+		mask &= ~group;
+		if (!chip)
+			continue;
+
+		might_sleep_if(chip->can_sleep);
+		if (chip->get_multiple && chip->ngpio <= BITS_PER_LONG) {
+			if (shift >= 0)
+				val = chip->get_multiple(chip, group << shift)
+					>> shift;
+			else
+				val = chip->get_multiple(chip, group >> -shift)
+					<< -shift;
+			bits |= val & group;
+		} else if (chip->get) {
+			for (val = group; val; val &= val - 1) {
+				unsigned	bit = __ffs(val);
+
+				if (chip->get(chip, bit + shift))
+					bits |= 1UL << bit;
+			}
+		}
+	}
+	return bits;
+}
+EXPORT_SYMBOL_GPL(gpio_get_multiple);
+
+/**
+ * gpio_set_multiple() - assign several gpio values at once
+ * @base: gpio corresponding to bit 0 of @mask
+ * @mask: bit N selects gpio @base + N
+ * @bits: bit N holds the value for gpio @base + N
+ * Context: process context if any of the gpios may sleep, otherwise any
+ *
+ * The gpios of each gpio_chip with a set_multiple() method are changed
+ * together, in one atomic update; others are changed one by one. Other
+ * gpios of the chip are not disturbed. As with gpio_set_value(), the gpios
+ * must have been requested and configured as outputs.
+ */
+void gpio_set_multiple(unsigned base, unsigned long mask, unsigned long bits)
+{
+	while (mask) {
+		struct gpio_chip	*chip;
+		unsigned long		group, val;
+		int			shift = 0;
+
+		chip = gpio_multiple_group(base, mask, &group, &shift);
+		mask &= ~group;
+		if (!chip)
+			continue;
+
+		might_sleep_if(chip->can_sleep);
+		if (chip->set_multiple && chip->ngpio <= BITS_PER_LONG) {
+			if (shift >= 0)
+				chip->set_multiple(chip, group << shift,
+						   (bits & group) << shift);
+			else
+				chip->set_multiple(chip, group >> -shift,
+						   (bits & group) >> -shift);
+		} else {
+			for (val = group; val; val &= val - 1) {
+				unsigned	bit = __ffs(val);
+
+				chip->set(chip, bit + shift,
+					  !!(bits & (1UL << bit)));
+			}
+		}
+	}
+}
+EXPORT_SYMBOL_GPL(gpio_set_multiple);
+
 
 #ifdef CONFIG_DEBUG_FS
 
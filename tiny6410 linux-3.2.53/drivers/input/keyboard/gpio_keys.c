@@ -35,6 +35,8 @@ struct gpio_button_data {
 	struct timer_list timer;
 	struct work_struct work;
 	int timer_debounce;	/* in msecs */
+	bool mask_irq;		/* mask the irq while debouncing */
+	atomic_t masked;
 	bool disabled;
 };
 
@@ -114,10 +116,16 @@ static void gpio_keys_disable_button(struct gpio_button_data *bdata)
 		/*
 		 * Disable IRQ and possible debouncing timer.
 		 */
-		disable_irq(gpio_to_irq(bdata->button->gpio));
+		int irq = gpio_to_irq(bdata->button->gpio);
+
+		disable_irq(irq);
 		if (bdata->timer_debounce)
 			del_timer_sync(&bdata->timer);
 
+		/* drop the mask of a debounce that will not finish now */
+		if (atomic_xchg(&bdata->masked, 0))
+			enable_irq(irq);
+
 		bdata->disabled = true;
 	}
 }
@@ -348,6 +356,9 @@ static void gpio_keys_timer(unsigned long _data)
 {
 	struct gpio_button_data *data = (struct gpio_button_data *)_data;
 
+	if (atomic_xchg(&data->masked, 0))
+		enable_irq(gpio_to_irq(data->button->gpio));
+
 	schedule_work(&data->work);
 }
 
@@ -358,10 +369,17 @@ static irqreturn_t gpio_keys_isr(int irq, void *dev_id)
 
 	BUG_ON(irq != gpio_to_irq(button->gpio));
 
-	if (bdata->timer_debounce)
+	if (bdata->timer_debounce) {
+		/*
+		 * Ignore the rest of the bounce instead of taking an
+		 * interrupt for each edge; the state is read once the
+		 * timer has unmasked the line again.
+		 */
+		if (bdata->mask_irq && !atomic_xchg(&bdata->masked, 1))
+			disable_irq_nosync(irq);
 		mod_timer(&bdata->timer,
 			jiffies + msecs_to_jiffies(bdata->timer_debounce));
-	else
+	} else
 		schedule_work(&bdata->work);
 
 	return IRQ_HANDLED;
@@ -397,7 +415,10 @@ static int __devinit gpio_keys_setup_key(struct platform_device *pdev,
 	if (button->debounce_interval) {
 		error = gpio_set_debounce(button->gpio,
 					  button->debounce_interval * 1000);
-		/* use timer if gpiolib doesn't provide debounce */
+		/*
+		 * use timer if gpiolib doesn't provide debounce, or only a
+		 * shorter hardware filter which still stops the glitches
+		 */
 		if (error < 0)
 			bdata->timer_debounce = button->debounce_interval;
 	}
@@ -417,6 +438,8 @@ static int __devinit gpio_keys_setup_key(struct platform_device *pdev,
 	 */
 	if (!button->can_disable)
 		irqflags |= IRQF_SHARED;
+	else
+		bdata->mask_irq = bdata->timer_debounce != 0;
 
 	error = request_threaded_irq(irq, NULL, gpio_keys_isr, irqflags, desc, bdata);
 	if (error < 0) {
@@ -433,6 +456,22 @@ fail2:
 	return error;
 }
 
+static void gpio_remove_key(struct gpio_button_data *bdata)
+{
+	int irq = gpio_to_irq(bdata->button->gpio);
+
+	if (bdata->mask_irq) {
+		/* keep the timer from unmasking the irq once it is freed */
+		disable_irq(irq);
+		del_timer_sync(&bdata->timer);
+	}
+	free_irq(irq, bdata);
+	if (bdata->timer_debounce)
+		del_timer_sync(&bdata->timer);
+	cancel_work_sync(&bdata->work);
+	gpio_free(bdata->button->gpio);
+}
+
 static int gpio_keys_open(struct input_dev *input)
 {
 	struct gpio_keys_drvdata *ddata = input_get_drvdata(input);
@@ -642,13 +681,8 @@ static int __devinit gpio_keys_probe(struct platform_device *pdev)
  fail3:
 	sysfs_remove_group(&pdev->dev.kobj, &gpio_keys_attr_group);
  fail2:
-	while (--i >= 0) {
-		free_irq(gpio_to_irq(pdata->buttons[i].gpio), &ddata->data[i]);
-		if (ddata->data[i].timer_debounce)
-			del_timer_sync(&ddata->data[i].timer);
-		cancel_work_sync(&ddata->data[i].work);
-		gpio_free(pdata->buttons[i].gpio);
-	}
+	while (--i >= 0)
+		gpio_remove_key(&ddata->data[i]);
 
 	platform_set_drvdata(pdev, NULL);
  fail1:
@@ -671,14 +705,8 @@ static int __devexit gpio_keys_remove(struct platform_device *pdev)
 
 	device_init_wakeup(&pdev->dev, 0);
 
-	for (i = 0; i < ddata->n_buttons; i++) {
-		int irq = gpio_to_irq(ddata->data[i].button->gpio);
-		free_irq(irq, &ddata->data[i]);
-		if (ddata->data[i].timer_debounce)
-			del_timer_sync(&ddata->data[i].timer);
-		cancel_work_sync(&ddata->data[i].work);
-		gpio_free(ddata->data[i].button->gpio);
-	}
+	for (i = 0; i < ddata->n_buttons; i++)
+		gpio_remove_key(&ddata->data[i]);
 
 	input_unregister_device(input);
 
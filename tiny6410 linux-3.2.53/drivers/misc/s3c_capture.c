@@ -0,0 +1,488 @@
+/*
+ * Pulse capture for Samsung S3C24XX/S3C64XX
+ *
+ * Counts or timestamps pulse trains from flow meters, encoders and the
+ * like and hands them to userspace in batches through /dev/pulse-capture.
+ *
+ *  - count mode: a PWM timer is clocked from its TCLK pin, so the edges
+ *    are counted by the timer itself. The timer interrupts once every
+ *    'batch' edges and queues one timestamped event.
+ *
+ *  - timestamp mode: one interrupt per edge on a GPIO (an EINT), each
+ *    queued as an event with its ktime_get() timestamp. Readers are only
+ *    woken once a batch of events is waiting.
+ *
+ * See Documentation/misc-devices/pulse-capture.txt.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/clk.h>
+#include <linux/io.h>
+#include <linux/fs.h>
+#include <linux/gpio.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/kfifo.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/pwm.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/pulse_capture.h>
+
+#include <mach/map.h>
+#include <mach/irqs.h>
+
+#include <plat/regs-timer.h>
+
+/* TIMER4 has no output and is used as the system timer */
+#define CAPTURE_TIMERS		4
+
+/* TCNTB is only 16 bits wide on S3C24XX */
+#define CAPTURE_MAX_BATCH	65536
+
+static unsigned int ring_size = 4096;
+module_param(ring_size, uint, 0644);
+MODULE_PARM_DESC(ring_size, "Events buffered per open file");
+
+struct capture {
+	struct mutex		lock;
+	wait_queue_head_t	wait;
+	DECLARE_KFIFO_PTR(fifo, struct pulse_event);
+
+	unsigned int		mode;
+	unsigned int		source;
+	unsigned int		batch;
+	unsigned int		wake_len;
+	unsigned long		timeout;
+	int			irq;
+
+	/* updated from the interrupt handler */
+	u64			count;
+	u32			overruns;
+	unsigned char		wake_any;
+
+	/* count mode */
+	struct pwm_device	*pwm;
+	struct clk		*tin;
+	struct clk		*tin_parent;
+	unsigned long		saved_tcntb;
+	unsigned long		saved_tcmpb;
+	unsigned long		saved_tcon;
+};
+
+static inline unsigned int capture_tcon_base(unsigned int id)
+{
+	return id == 0 ? 0 : (id * 4) + 4;
+}
+
+static void capture_queue(struct capture *cap)
+{
+	struct pulse_event ev = {
+		.time_ns	= ktime_to_ns(ktime_get()),
+		.count		= cap->count,
+	};
+
+	if (!kfifo_put(&cap->fifo, &ev))
+		cap->overruns++;
+
+	if (waitqueue_active(&cap->wait) &&
+	    (cap->wake_any || kfifo_len(&cap->fifo) >= cap->wake_len))
+		wake_up_interruptible(&cap->wait);
+}
+
+static irqreturn_t capture_gpio_irq(int irq, void *dev_id)
+{
+	struct capture *cap = dev_id;
+
+	cap->count++;
+	capture_queue(cap);
+
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t capture_timer_irq(int irq, void *dev_id)
+{
+	struct capture *cap = dev_id;
+
+	cap->count += cap->batch;
+	capture_queue(cap);
+
+	return IRQ_HANDLED;
+}
+
+static int capture_setup_gpio(struct capture *cap,
+			      struct pulse_capture_setup *setup)
+{
+	unsigned long irqflags = 0;
+	int ret;
+
+	if (setup->flags & PULSE_CAPTURE_RISING)
+		irqflags |= IRQF_TRIGGER_RISING;
+	if (setup->flags & PULSE_CAPTURE_FALLING)
+		irqflags |= IRQF_TRIGGER_FALLING;
+	if (!irqflags || setup->batch > kfifo_size(&cap->fifo) / 2)
+		return -EINVAL;
+
+	ret = gpio_request(setup->source, "pulse-capture");
+	if (ret)
+		return ret;
+
+	ret = gpio_direction_input(setup->source);
+	if (ret)
+		goto err_gpio;
+
+	cap->irq = gpio_to_irq(setup->source);
+	if (cap->irq < 0) {
+		ret = cap->irq;
+		goto err_gpio;
+	}
+
+	cap->batch = setup->batch;
+	cap->wake_len = setup->batch;
+
+	ret = request_irq(cap->irq, capture_gpio_irq, irqflags,
+			  "pulse-capture", cap);
+	if (ret)
+		goto err_gpio;
+
+	return 0;
+
+ err_gpio:
+	gpio_free(setup->source);
+	return ret;
+}
+
+static int capture_setup_timer(struct capture *cap,
+			       struct pulse_capture_setup *setup)
+{
+	unsigned int id = setup->source;
+	unsigned int shift = capture_tcon_base(id);
+	unsigned long flags;
+	unsigned long tcon;
+	char devname[16];
+	struct clk *tclk;
+	int ret;
+
+	if (id >= CAPTURE_TIMERS || setup->batch > CAPTURE_MAX_BATCH ||
+	    setup->flags)
+		return -EINVAL;
+
+	/* claim the timer so that no PWM user can touch it */
+	cap->pwm = pwm_request(id, "pulse-capture");
+	if (IS_ERR(cap->pwm))
+		return PTR_ERR(cap->pwm);
+
+	snprintf(devname, sizeof(devname), "s3c24xx-pwm.%u", id);
+	cap->tin = clk_get_sys(devname, "pwm-tin");
+	if (IS_ERR(cap->tin)) {
+		ret = PTR_ERR(cap->tin);
+		goto err_pwm;
+	}
+
+	tclk = clk_get(NULL, id >= 2 ? "pwm-tclk1" : "pwm-tclk0");
+	if (IS_ERR(tclk)) {
+		ret = PTR_ERR(tclk);
+		goto err_tin;
+	}
+
+	cap->tin_parent = clk_get_parent(cap->tin);
+	ret = clk_set_parent(cap->tin, tclk);
+	clk_put(tclk);
+	if (ret)
+		goto err_tin;
+
+	cap->batch = setup->batch;
+	cap->wake_len = 1;
+	cap->irq = IRQ_TIMER0 + id;
+
+	ret = request_irq(cap->irq, capture_timer_irq, 0,
+			  "pulse-capture", cap);
+	if (ret)
+		goto err_parent;
+
+	/* the timer counts TCLK edges down from batch - 1 and reloads */
+
+	local_irq_save(flags);
+
+	cap->saved_tcntb = __raw_readl(S3C2410_TCNTB(id));
+	cap->saved_tcmpb = __raw_readl(S3C2410_TCMPB(id));
+	cap->saved_tcon = __raw_readl(S3C2410_TCON);
+
+	__raw_writel(cap->batch - 1, S3C2410_TCNTB(id));
+	__raw_writel(0, S3C2410_TCMPB(id));
+
+	tcon = cap->saved_tcon & ~(0xf << shift);
+	tcon |= (1 << (shift + 3)) | (1 << (shift + 1));
+	__raw_writel(tcon, S3C2410_TCON);
+
+	tcon &= ~(1 << (shift + 1));
+	tcon |= 1 << shift;
+	__raw_writel(tcon, S3C2410_TCON);
+
+	local_irq_restore(flags);
+
+	return 0;
+
+ err_parent:
+	clk_set_parent(cap->tin, cap->tin_parent);
+ err_tin:
+	clk_put(cap->tin);
+ err_pwm:
+	pwm_free(cap->pwm);
+	cap->pwm = NULL;
+	return ret;
+}
+
+static void capture_stop_timer(struct capture *cap)
+{
+	unsigned int id = cap->source;
+	unsigned int shift = capture_tcon_base(id);
+	unsigned long flags;
+	unsigned long tcon;
+
+	local_irq_save(flags);
+
+	tcon = __raw_readl(S3C2410_TCON) & ~(0xf << shift);
+	__raw_writel(tcon, S3C2410_TCON);
+
+	/* give the timer back as we found it */
+	__raw_writel(cap->saved_tcntb, S3C2410_TCNTB(id));
+	__raw_writel(cap->saved_tcmpb, S3C2410_TCMPB(id));
+	__raw_writel(tcon | (1 << (shift + 1)), S3C2410_TCON);
+	__raw_writel(tcon | (cap->saved_tcon & (0xf << shift)), S3C2410_TCON);
+
+	local_irq_restore(flags);
+
+	free_irq(cap->irq, cap);
+	clk_set_parent(cap->tin, cap->tin_parent);
+	clk_put(cap->tin);
+	pwm_free(cap->pwm);
+}
+
+/* edges seen so far, including the ones still in the timer */
+static u64 capture_count(struct capture *cap)
+{
+	u64 count;
+	u32 left;
+
+	if (cap->mode != PULSE_CAPTURE_COUNT)
+		return cap->count;
+
+	do {
+		count = cap->count;
+		left = __raw_readl(S3C2410_TCNTO(cap->source));
+		barrier();
+	} while (count != cap->count);
+
+	return count + cap->batch - 1 - left;
+}
+
+static long capture_setup(struct capture *cap, void __user *argp)
+{
+	struct pulse_capture_setup setup;
+	int ret;
+
+	if (copy_from_user(&setup, argp, sizeof(setup)))
+		return -EFAULT;
+
+	if (setup.padding || setup.batch == 0)
+		return -EINVAL;
+
+	mutex_lock(&cap->lock);
+
+	if (cap->mode) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	cap->source = setup.source;
+	cap->timeout = setup.timeout_ms ?
+		msecs_to_jiffies(setup.timeout_ms) : MAX_SCHEDULE_TIMEOUT;
+
+	switch (setup.mode) {
+	case PULSE_CAPTURE_TIMESTAMP:
+		ret = capture_setup_gpio(cap, &setup);
+		break;
+	case PULSE_CAPTURE_COUNT:
+		ret = capture_setup_timer(cap, &setup);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	if (!ret)
+		cap->mode = setup.mode;
+ out:
+	mutex_unlock(&cap->lock);
+	return ret;
+}
+
+static long capture_ioctl(struct file *file, unsigned int cmd,
+			  unsigned long arg)
+{
+	struct capture *cap = file->private_data;
+	void __user *argp = (void __user *)arg;
+	struct pulse_capture_status status;
+
+	switch (cmd) {
+	case PULSE_CAPTURE_SETUP:
+		return capture_setup(cap, argp);
+
+	case PULSE_CAPTURE_STATUS:
+		memset(&status, 0, sizeof(status));
+		status.count = capture_count(cap);
+		status.time_ns = ktime_to_ns(ktime_get());
+		status.overruns = cap->overruns;
+		status.queued = kfifo_len(&cap->fifo);
+
+		if (copy_to_user(argp, &status, sizeof(status)))
+			return -EFAULT;
+		return 0;
+	}
+
+	return -ENOTTY;
+}
+
+static ssize_t capture_read(struct file *file, char __user *buf,
+			    size_t count, loff_t *ppos)
+{
+	struct capture *cap = file->private_data;
+	unsigned int copied;
+	long ret;
+
+	count -= count % sizeof(struct pulse_event);
+	if (!count)
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&cap->lock))
+		return -ERESTARTSYS;
+
+	if (!cap->mode) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (file->f_flags & O_NONBLOCK) {
+		if (kfifo_is_empty(&cap->fifo)) {
+			ret = -EAGAIN;
+			goto out;
+		}
+	} else {
+		/* wait for a batch, then settle for whatever has arrived */
+		ret = wait_event_interruptible_timeout(cap->wait,
+				kfifo_len(&cap->fifo) >= cap->wake_len,
+				cap->timeout);
+		if (ret < 0)
+			goto out;
+
+		if (kfifo_is_empty(&cap->fifo)) {
+			cap->wake_any = 1;
+			ret = wait_event_interruptible(cap->wait,
+					!kfifo_is_empty(&cap->fifo));
+			cap->wake_any = 0;
+			if (ret)
+				goto out;
+		}
+	}
+
+	ret = kfifo_to_user(&cap->fifo, buf, count, &copied);
+	if (!ret)
+		ret = copied;
+ out:
+	mutex_unlock(&cap->lock);
+	return ret;
+}
+
+static unsigned int capture_poll(struct file *file, poll_table *wait)
+{
+	struct capture *cap = file->private_data;
+
+	poll_wait(file, &cap->wait, wait);
+
+	if (!cap->mode)
+		return POLLERR;
+
+	return kfifo_len(&cap->fifo) >= cap->wake_len ? POLLIN | POLLRDNORM : 0;
+}
+
+static int capture_open(struct inode *inode, struct file *file)
+{
+	struct capture *cap;
+	int ret;
+
+	cap = kzalloc(sizeof(*cap), GFP_KERNEL);
+	if (!cap)
+		return -ENOMEM;
+
+	ret = kfifo_alloc(&cap->fifo, max(ring_size, 16U), GFP_KERNEL);
+	if (ret) {
+		kfree(cap);
+		return ret;
+	}
+
+	mutex_init(&cap->lock);
+	init_waitqueue_head(&cap->wait);
+	file->private_data = cap;
+
+	return nonseekable_open(inode, file);
+}
+
+static int capture_release(struct inode *inode, struct file *file)
+{
+	struct capture *cap = file->private_data;
+
+	switch (cap->mode) {
+	case PULSE_CAPTURE_TIMESTAMP:
+		free_irq(cap->irq, cap);
+		gpio_free(cap->source);
+		break;
+	case PULSE_CAPTURE_COUNT:
+		capture_stop_timer(cap);
+		break;
+	}
+
+	kfifo_free(&cap->fifo);
+	kfree(cap);
+	return 0;
+}
+
+static const struct file_operations capture_fops = {
+	.owner		= THIS_MODULE,
+	.open		= capture_open,
+	.release	= capture_release,
+	.read		= capture_read,
+	.poll		= capture_poll,
+	.unlocked_ioctl	= capture_ioctl,
+	.llseek		= no_llseek,
+};
+
+static struct miscdevice capture_misc = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= "pulse-capture",
+	.fops		= &capture_fops,
+};
+
+static int __init capture_init(void)
+{
+	return misc_register(&capture_misc);
+}
+
+static void __exit capture_exit(void)
+{
+	misc_deregister(&capture_misc);
+}
+
+module_init(capture_init);
+module_exit(capture_exit);
+
+MODULE_DESCRIPTION("S3C24XX/S3C64XX pulse counter and capture");
+MODULE_LICENSE("GPL");
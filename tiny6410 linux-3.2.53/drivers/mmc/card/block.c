@@ -89,6 +89,7 @@ struct mmc_blk_data {
 	unsigned int	flags;
 #define MMC_BLK_CMD23	(1 << 0)	/* Can do SET_BLOCK_COUNT for multiblock */
 #define MMC_BLK_REL_WR	(1 << 1)	/* MMC Reliable write support */
+#define MMC_BLK_PACKED_WR (1 << 2)	/* eMMC 4.5 packed write support */
 
 	unsigned int	usage;
 	unsigned int	read_only;
@@ -107,6 +108,7 @@ struct mmc_blk_data {
 	 */
 	unsigned int	part_curr;
 	struct device_attribute force_ro;
+	struct device_attribute discard_stats;
 };
 
 static DEFINE_MUTEX(open_lock);
@@ -124,6 +126,22 @@ enum mmc_blk_status {
 module_param(perdev_minors, int, 0444);
 MODULE_PARM_DESC(perdev_minors, "Minors numbers to allocate per device");
 
+static bool pack_writes = 1;
+module_param(pack_writes, bool, 0644);
+MODULE_PARM_DESC(pack_writes, "Combine queued writes into one transfer");
+
+static bool discard_defer = 1;
+module_param(discard_defer, bool, 0444);
+MODULE_PARM_DESC(discard_defer, "Queue discards and issue them when the card is idle");
+
+static unsigned int discard_idle_ms = 500;
+module_param(discard_idle_ms, uint, 0644);
+MODULE_PARM_DESC(discard_idle_ms, "Idle time before queued discards are issued");
+
+static unsigned int discard_latency_ms = 20;
+module_param(discard_latency_ms, uint, 0644);
+MODULE_PARM_DESC(discard_latency_ms, "Target duration of a single background erase");
+
 static struct mmc_blk_data *mmc_blk_get(struct gendisk *disk)
 {
 	struct mmc_blk_data *md;
@@ -197,6 +215,22 @@ out:
 	return ret;
 }
 
+static ssize_t discard_stats_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	int ret;
+	struct mmc_blk_data *md = mmc_blk_get(dev_to_disk(dev));
+	struct mmc_discard_queue *dq = &md->queue.dq;
+
+	ret = snprintf(buf, PAGE_SIZE, "%lu %lu %llu %lu %lu %lu %lu\n",
+		       dq->queued, dq->merged,
+		       (unsigned long long)dq->pending, dq->issued,
+		       dq->issued_sectors, dq->cancelled_sectors,
+		       dq->errors);
+	mmc_blk_put(md);
+	return ret;
+}
+
 static int mmc_blk_open(struct block_device *bdev, fmode_t mode)
 {
 	struct mmc_blk_data *md = mmc_blk_get(bdev->bd_disk);
@@ -749,20 +783,11 @@ static inline void mmc_blk_reset_success(struct mmc_blk_data *md, int type)
 	md->reset_done &= ~type;
 }
 
-static int mmc_blk_issue_discard_rq(struct mmc_queue *mq, struct request *req)
+static int mmc_blk_do_discard(struct mmc_card *card, unsigned int from,
+			      unsigned int nr)
 {
-	struct mmc_blk_data *md = mq->data;
-	struct mmc_card *card = md->queue.card;
-	unsigned int from, nr, arg;
-	int err = 0, type = MMC_BLK_DISCARD;
-
-	if (!mmc_can_erase(card)) {
-		err = -EOPNOTSUPP;
-		goto out;
-	}
-
-	from = blk_rq_pos(req);
-	nr = blk_rq_sectors(req);
+	unsigned int arg;
+	int err;
 
 	if (mmc_can_discard(card))
 		arg = MMC_DISCARD_ARG;
@@ -770,7 +795,7 @@ static int mmc_blk_issue_discard_rq(struct mmc_queue *mq, struct request *req)
 		arg = MMC_TRIM_ARG;
 	else
 		arg = MMC_ERASE_ARG;
-retry:
+
 	if (card->quirks & MMC_QUIRK_INAND_CMD38) {
 		err = mmc_switch(card, EXT_CSD_CMD_SET_NORMAL,
 				 INAND_CMD38_ARG_EXT_CSD,
@@ -779,9 +804,130 @@ retry:
 				 INAND_CMD38_ARG_ERASE,
 				 0);
 		if (err)
-			goto out;
+			return err;
 	}
-	err = mmc_erase(card, from, nr, arg);
+	return mmc_erase(card, from, nr, arg);
+}
+
+/*
+ * Erasing stalls the card, for hundreds of milliseconds on some SD
+ * cards, and discards are only hints.  So unless the queue promises
+ * that discarded blocks read back as zeroes, complete the request at
+ * once and erase later, when the card is idle.
+ */
+static bool mmc_blk_defer_discard(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+
+	if (!discard_defer || mq->queue->limits.discard_zeroes_data)
+		return false;
+
+	if (mmc_dq_add(&mq->dq, blk_rq_pos(req), blk_rq_sectors(req)))
+		return false;
+
+	spin_lock_irq(&md->lock);
+	__blk_end_request(req, 0, blk_rq_bytes(req));
+	spin_unlock_irq(&md->lock);
+	return true;
+}
+
+/*
+ * A write must not be undone by a deferred discard queued before it.
+ */
+static void mmc_blk_cancel_discards(struct mmc_queue *mq,
+				    struct mmc_queue_req *mqrq)
+{
+	struct request *prq;
+
+	if (!mq->dq.pending || rq_data_dir(mqrq->req) != WRITE)
+		return;
+
+	if (mqrq->cmd_type == MMC_PACKED_NONE) {
+		mmc_dq_cancel(&mq->dq, blk_rq_pos(mqrq->req),
+			      blk_rq_sectors(mqrq->req));
+		return;
+	}
+
+	list_for_each_entry(prq, &mqrq->packed.list, queuelist)
+		mmc_dq_cancel(&mq->dq, blk_rq_pos(prq), blk_rq_sectors(prq));
+}
+
+/*
+ * Queue thread idle handler: once the card has been idle for
+ * discard_idle_ms, issue deferred discards one chunk at a time.  The
+ * chunk size is adjusted so that one erase takes about
+ * discard_latency_ms, which bounds how long a request arriving in the
+ * middle of it has to wait.
+ */
+static long mmc_blk_discard_idle(struct mmc_queue *mq)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_discard_queue *dq = &mq->dq;
+	unsigned int nr, min_nr, max_nr;
+	unsigned long idle_at;
+	ktime_t start;
+	s64 ms;
+	sector_t from;
+	int err;
+
+	if (!dq->pending)
+		return MAX_SCHEDULE_TIMEOUT;
+
+	idle_at = mq->last_busy + msecs_to_jiffies(discard_idle_ms);
+	if (time_before(jiffies, idle_at))
+		return idle_at - jiffies;
+
+	set_current_state(TASK_RUNNING);
+
+	min_nr = max(card->erase_size, 1u);
+	max_nr = max(mq->queue->limits.max_discard_sectors, min_nr);
+	if (!dq->chunk)
+		dq->chunk = clamp(card->pref_erase, min_nr, max_nr);
+
+	nr = mmc_dq_pop(dq, dq->chunk, min_nr, &from);
+
+	mmc_claim_host(card->host);
+	start = ktime_get();
+	err = mmc_blk_part_switch(card, md);
+	if (!err)
+		err = mmc_blk_do_discard(card, from, nr);
+	ms = ktime_to_ms(ktime_sub(ktime_get(), start));
+	mmc_release_host(card->host);
+
+	dq->issued++;
+	dq->issued_sectors += nr;
+	if (err)
+		dq->errors++;
+
+	if (ms > discard_latency_ms)
+		dq->chunk = max(rounddown(dq->chunk / 2, min_nr), min_nr);
+	else if (ms < discard_latency_ms / 4 && dq->chunk <= max_nr / 2)
+		dq->chunk *= 2;
+
+	/* Go round again, foreground requests first */
+	return 0;
+}
+
+static int mmc_blk_issue_discard_rq(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	unsigned int from, nr;
+	int err = 0, type = MMC_BLK_DISCARD;
+
+	if (!mmc_can_erase(card)) {
+		err = -EOPNOTSUPP;
+		goto out;
+	}
+
+	if (mmc_blk_defer_discard(mq, req))
+		return 1;
+
+	from = blk_rq_pos(req);
+	nr = blk_rq_sectors(req);
+retry:
+	err = mmc_blk_do_discard(card, from, nr);
 out:
 	if (err == -EIO && !mmc_blk_reset(md, card->host, type))
 		goto retry;
@@ -1010,12 +1156,182 @@ static int mmc_blk_err_check(struct mmc_card *card,
 	if (!brq->data.bytes_xfered)
 		return MMC_BLK_RETRY;
 
+	if (mq_mrq->cmd_type != MMC_PACKED_NONE) {
+		if (brq->data.blocks << 9 != brq->data.bytes_xfered)
+			return MMC_BLK_PARTIAL;
+		return MMC_BLK_SUCCESS;
+	}
+
 	if (blk_rq_bytes(req) != brq->data.bytes_xfered)
 		return MMC_BLK_PARTIAL;
 
 	return MMC_BLK_SUCCESS;
 }
 
+static int mmc_blk_packed_err_check(struct mmc_card *card,
+				    struct mmc_async_req *areq)
+{
+	struct mmc_queue_req *mq_mrq = container_of(areq, struct mmc_queue_req,
+						    mmc_active);
+	struct mmc_packed *packed = &mq_mrq->packed;
+	struct request *req = mq_mrq->req;
+	int err, check;
+	u32 status;
+	u8 *ext_csd;
+
+	packed->idx_failure = -1;
+
+	check = mmc_blk_err_check(card, areq);
+	if (mq_mrq->cmd_type != MMC_PACKED_WRITE)
+		return check;
+
+	err = get_card_status(card, &status, 0);
+	if (err) {
+		pr_err("%s: error %d sending status command\n",
+		       req->rq_disk->disk_name, err);
+		return MMC_BLK_ABORT;
+	}
+
+	if (!(status & R1_EXCEPTION_EVENT))
+		return check;
+
+	ext_csd = kzalloc(512, GFP_KERNEL);
+	if (!ext_csd)
+		return MMC_BLK_ABORT;
+
+	err = mmc_send_ext_csd(card, ext_csd);
+	if (err) {
+		pr_err("%s: error %d reading ext_csd\n",
+		       req->rq_disk->disk_name, err);
+		check = MMC_BLK_ABORT;
+		goto out;
+	}
+
+	if ((ext_csd[EXT_CSD_EXP_EVENTS_STATUS] & EXT_CSD_PACKED_FAILURE) &&
+	    (ext_csd[EXT_CSD_PACKED_CMD_STATUS] &
+	     EXT_CSD_PACKED_GENERIC_ERROR)) {
+		if (ext_csd[EXT_CSD_PACKED_CMD_STATUS] &
+		    EXT_CSD_PACKED_INDEXED_ERROR) {
+			/* The card counts entries from 1 */
+			packed->idx_failure =
+				ext_csd[EXT_CSD_PACKED_FAILURE_INDEX] - 1;
+			check = MMC_BLK_PARTIAL;
+		}
+		pr_err("%s: packed write failed, nr %u, sectors %u, failure index %d\n",
+		       req->rq_disk->disk_name, packed->nr_entries,
+		       packed->blocks, packed->idx_failure);
+	}
+ out:
+	kfree(ext_csd);
+	return check;
+}
+
+/*
+ * Decide whether @req goes out alone or as the first of a pack.
+ * Called once per request, before the first mmc_blk_rw_rq_prep().
+ */
+static void mmc_blk_prep_packed_list(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_queue_req *mqrq = mq->mqrq_cur;
+	enum mmc_packed_type type;
+	unsigned int max_entries;
+
+	mqrq->cmd_type = MMC_PACKED_NONE;
+
+	if (!pack_writes || !mmc_req_packable(req))
+		return;
+
+	if (md->flags & MMC_BLK_PACKED_WR) {
+		type = MMC_PACKED_WRITE;
+		max_entries = min_t(unsigned int, MMC_PACKED_MAX_ENTRIES,
+				    card->ext_csd.max_packed_writes);
+	} else {
+		type = MMC_PACKED_CONTIG;
+		max_entries = UINT_MAX;
+	}
+
+	if (mmc_queue_pack(mq, mqrq, type, max_entries) > 1)
+		mqrq->cmd_type = type;
+}
+
+static void mmc_blk_packed_wrq_prep(struct mmc_queue_req *mqrq,
+				    struct mmc_card *card,
+				    struct mmc_queue *mq)
+{
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct mmc_packed *packed = &mqrq->packed;
+	struct mmc_blk_data *md = mq->data;
+	struct request *req = mqrq->req;
+	struct request *prq;
+	__le32 *hdr = packed->cmd_hdr;
+	unsigned int hdr_blocks = 0, i = 1;
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.data = &brq->data;
+
+	if (mqrq->cmd_type == MMC_PACKED_WRITE) {
+		/*
+		 * Entry 0 describes the pack, entry i holds the CMD23
+		 * and CMD25 arguments of the i-th request.
+		 */
+		memset(hdr, 0, MMC_PACKED_HDR_SZ);
+		hdr[0] = cpu_to_le32((packed->nr_entries << 16) |
+				     (MMC_PACKED_CMD_WR << 8) |
+				     MMC_PACKED_CMD_VER);
+		list_for_each_entry(prq, &packed->list, queuelist) {
+			u32 addr = blk_rq_pos(prq);
+
+			if (!mmc_card_blockaddr(card))
+				addr <<= 9;
+			hdr[i * 2] = cpu_to_le32(blk_rq_sectors(prq));
+			hdr[i * 2 + 1] = cpu_to_le32(addr);
+			i++;
+		}
+		hdr_blocks = MMC_PACKED_HDR_SZ >> 9;
+	}
+
+	brq->cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+	brq->data.blksz = 512;
+	brq->data.blocks = packed->blocks + hdr_blocks;
+	brq->data.flags |= MMC_DATA_WRITE;
+
+	/* SPI multiblock writes terminate using a special token */
+	if (!mmc_host_is_spi(card->host)) {
+		brq->stop.opcode = MMC_STOP_TRANSMISSION;
+		brq->stop.arg = 0;
+		brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+		brq->mrq.stop = &brq->stop;
+	}
+
+	if (mqrq->cmd_type == MMC_PACKED_WRITE ||
+	    ((md->flags & MMC_BLK_CMD23) &&
+	     !(card->quirks & MMC_QUIRK_BLK_NO_CMD23))) {
+		brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+		brq->sbc.arg = brq->data.blocks;
+		if (mqrq->cmd_type == MMC_PACKED_WRITE)
+			brq->sbc.arg |= MMC_CMD23_ARG_PACKED;
+		brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+		brq->mrq.sbc = &brq->sbc;
+	}
+
+	mmc_set_data_timeout(&brq->data, card);
+
+	brq->data.sg = mqrq->sg;
+	brq->data.sg_len = mmc_queue_map_sg(mq, mqrq);
+
+	mqrq->mmc_active.mrq = &brq->mrq;
+	mqrq->mmc_active.err_check = mmc_blk_packed_err_check;
+
+	mmc_queue_bounce_pre(mqrq);
+}
+
 static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 			       struct mmc_card *card,
 			       int disable_multi,
@@ -1025,6 +1341,12 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 	struct mmc_blk_request *brq = &mqrq->brq;
 	struct request *req = mqrq->req;
 	struct mmc_blk_data *md = mq->data;
+	bool do_rel_wr;
+
+	if (mqrq->cmd_type != MMC_PACKED_NONE) {
+		mmc_blk_packed_wrq_prep(mqrq, card, mq);
+		return;
+	}
 
 	/*
 	 * Reliable writes are used to implement Forced Unit Access and
@@ -1033,8 +1355,8 @@ static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
 	 * XXX: this really needs a good explanation of why REQ_META
 	 * is treated special.
 	 */
-	bool do_rel_wr = ((req->cmd_flags & REQ_FUA) ||
-			  (req->cmd_flags & REQ_META)) &&
+	do_rel_wr = ((req->cmd_flags & REQ_FUA) ||
+		     (req->cmd_flags & REQ_META)) &&
 		(rq_data_dir(req) == WRITE) &&
 		(md->flags & MMC_BLK_REL_WR);
 
@@ -1188,6 +1510,93 @@ static int mmc_blk_cmd_err(struct mmc_blk_data *md, struct mmc_card *card,
 	return ret;
 }
 
+/*
+ * Complete the first @bytes of a pack, which are known to be on the
+ * card.  What is left is split up again: the first unfinished request
+ * is retried on its own through @mq_rq, the others go back to the
+ * block layer and are picked up (and possibly packed) again later.
+ * Returns non-zero if @mq_rq->req still has to be issued.
+ */
+static int mmc_blk_end_packed_req(struct mmc_queue *mq,
+				  struct mmc_queue_req *mq_rq,
+				  unsigned int bytes)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_packed *packed = &mq_rq->packed;
+	struct request *prq;
+	unsigned int done;
+	int ret = 0;
+
+	spin_lock_irq(&md->lock);
+	while (!list_empty(&packed->list)) {
+		prq = list_entry_rq(packed->list.next);
+		list_del_init(&prq->queuelist);
+
+		done = min(bytes, blk_rq_bytes(prq));
+		bytes -= done;
+		if (done == blk_rq_bytes(prq)) {
+			__blk_end_request(prq, 0, done);
+			continue;
+		}
+
+		if (done)
+			__blk_end_request(prq, 0, done);
+		mq_rq->req = prq;
+		ret = 1;
+		break;
+	}
+
+	/* Requeue back to front so the queue keeps the original order */
+	while (!list_empty(&packed->list)) {
+		prq = list_entry_rq(packed->list.prev);
+		list_del_init(&prq->queuelist);
+		blk_requeue_request(mq->queue, prq);
+	}
+	spin_unlock_irq(&md->lock);
+
+	mq_rq->cmd_type = MMC_PACKED_NONE;
+	return ret;
+}
+
+static int mmc_blk_packed_done(struct mmc_queue *mq,
+			       struct mmc_queue_req *mq_rq,
+			       enum mmc_blk_status status)
+{
+	struct mmc_blk_data *md = mq->data;
+	struct mmc_card *card = md->queue.card;
+	struct mmc_packed *packed = &mq_rq->packed;
+	struct request *prq;
+	unsigned int bytes = 0;
+	u32 blocks;
+	int i = 0;
+
+	if (status == MMC_BLK_SUCCESS) {
+		mmc_blk_reset_success(md, MMC_BLK_WRITE);
+		return mmc_blk_end_packed_req(mq, mq_rq, packed->blocks << 9);
+	}
+
+	/*
+	 * Work out how much of the pack made it.  A packed write has to
+	 * be told by the card; a contiguous batch is a single transfer,
+	 * so the usual partial write accounting applies.
+	 */
+	if (mq_rq->cmd_type == MMC_PACKED_WRITE) {
+		list_for_each_entry(prq, &packed->list, queuelist) {
+			if (i++ >= packed->idx_failure)
+				break;
+			bytes += blk_rq_bytes(prq);
+		}
+	} else if (mmc_card_sd(card)) {
+		blocks = mmc_sd_num_wr_blocks(card);
+		if (blocks != (u32)-1)
+			bytes = blocks << 9;
+	} else {
+		bytes = mq_rq->brq.data.bytes_xfered;
+	}
+
+	return mmc_blk_end_packed_req(mq, mq_rq, bytes);
+}
+
 static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 {
 	struct mmc_blk_data *md = mq->data;
@@ -1202,6 +1611,11 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 	if (!rqc && !mq->mqrq_prev->req)
 		return 0;
 
+	if (rqc) {
+		mmc_blk_prep_packed_list(mq, rqc);
+		mmc_blk_cancel_discards(mq, mq->mqrq_cur);
+	}
+
 	do {
 		if (rqc) {
 			mmc_blk_rw_rq_prep(mq->mqrq_cur, card, 0, mq);
@@ -1218,6 +1632,20 @@ static int mmc_blk_issue_rw_rq(struct mmc_queue *mq, struct request *rqc)
 		type = rq_data_dir(req) == READ ? MMC_BLK_READ : MMC_BLK_WRITE;
 		mmc_queue_bounce_post(mq_rq);
 
+		if (mq_rq->cmd_type != MMC_PACKED_NONE) {
+			ret = mmc_blk_packed_done(mq, mq_rq, status);
+			if (ret) {
+				/*
+				 * Retry the unfinished request on its own
+				 * so the normal error handling applies.
+				 */
+				mmc_blk_rw_rq_prep(mq_rq, card, 0, mq);
+				mmc_start_req(card->host,
+					      &mq_rq->mmc_active, NULL);
+			}
+			continue;
+		}
+
 		switch (status) {
 		case MMC_BLK_SUCCESS:
 		case MMC_BLK_PARTIAL:
@@ -1421,8 +1849,13 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 		goto err_putdisk;
 
 	md->queue.issue_fn = mmc_blk_issue_rq;
+	md->queue.idle_fn = mmc_blk_discard_idle;
 	md->queue.data = md;
 
+	/* Deferred discards do not zero anything until much later */
+	if (discard_defer)
+		md->queue.queue->limits.discard_zeroes_data = 0;
+
 	md->disk->major	= MMC_BLOCK_MAJOR;
 	md->disk->first_minor = devidx * perdev_minors;
 	md->disk->fops = &mmc_bdops;
@@ -1464,6 +1897,19 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 		blk_queue_flush(md->queue.queue, REQ_FLUSH | REQ_FUA);
 	}
 
+	/*
+	 * Packed writes are eMMC 4.5 only and always go with CMD23.
+	 * Other cards (SD, older eMMC) still get back-to-back writes
+	 * batched into one transfer, see mmc_blk_prep_packed_list().
+	 */
+	if (mmc_card_mmc(card) &&
+	    md->flags & MMC_BLK_CMD23 &&
+	    !(card->quirks & MMC_QUIRK_BLK_NO_CMD23) &&
+	    card->ext_csd.packed_event_en &&
+	    md->queue.mqrq_cur->packed.cmd_hdr &&
+	    md->queue.mqrq_prev->packed.cmd_hdr)
+		md->flags |= MMC_BLK_PACKED_WR;
+
 	return md;
 
  err_putdisk:
@@ -1572,6 +2018,8 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 {
 	if (md) {
 		if (md->disk->flags & GENHD_FL_UP) {
+			device_remove_file(disk_to_dev(md->disk),
+					   &md->discard_stats);
 			device_remove_file(disk_to_dev(md->disk), &md->force_ro);
 
 			/* Stop new requests from getting into the queue */
@@ -1610,8 +2058,22 @@ static int mmc_add_disk(struct mmc_blk_data *md)
 	md->force_ro.attr.mode = S_IRUGO | S_IWUSR;
 	ret = device_create_file(disk_to_dev(md->disk), &md->force_ro);
 	if (ret)
-		del_gendisk(md->disk);
+		goto del_disk;
+
+	md->discard_stats.show = discard_stats_show;
+	sysfs_attr_init(&md->discard_stats.attr);
+	md->discard_stats.attr.name = "discard_stats";
+	md->discard_stats.attr.mode = S_IRUGO;
+	ret = device_create_file(disk_to_dev(md->disk), &md->discard_stats);
+	if (ret)
+		goto remove_force_ro;
+
+	return 0;
 
+remove_force_ro:
+	device_remove_file(disk_to_dev(md->disk), &md->force_ro);
+del_disk:
+	del_gendisk(md->disk);
 	return ret;
 }
 
@@ -63,13 +63,23 @@ static int mmc_queue_thread(void *d)
 		if (req || mq->mqrq_prev->req) {
 			set_current_state(TASK_RUNNING);
 			mq->issue_fn(mq, req);
+			mq->last_busy = jiffies;
 		} else {
+			long timeout = MAX_SCHEDULE_TIMEOUT;
+
 			if (kthread_should_stop()) {
 				set_current_state(TASK_RUNNING);
 				break;
 			}
+			/*
+			 * Nothing to do: give the idle handler a chance
+			 * to run background work, it tells us how long
+			 * to sleep before asking again.
+			 */
+			if (mq->idle_fn)
+				timeout = mq->idle_fn(mq);
 			up(&mq->thread_sem);
-			schedule();
+			schedule_timeout(timeout);
 			down(&mq->thread_sem);
 		}
 
@@ -255,6 +265,26 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 			goto cleanup_queue;
 	}
 
+	INIT_LIST_HEAD(&mqrq_cur->packed.list);
+	INIT_LIST_HEAD(&mqrq_prev->packed.list);
+	if (card->ext_csd.packed_event_en) {
+		mqrq_cur->packed.cmd_hdr = kzalloc(MMC_PACKED_HDR_SZ,
+						   GFP_KERNEL);
+		mqrq_prev->packed.cmd_hdr = kzalloc(MMC_PACKED_HDR_SZ,
+						    GFP_KERNEL);
+		if (!mqrq_cur->packed.cmd_hdr || !mqrq_prev->packed.cmd_hdr) {
+			pr_warning("%s: unable to allocate packed header\n",
+				   mmc_card_name(card));
+			kfree(mqrq_cur->packed.cmd_hdr);
+			mqrq_cur->packed.cmd_hdr = NULL;
+			kfree(mqrq_prev->packed.cmd_hdr);
+			mqrq_prev->packed.cmd_hdr = NULL;
+		}
+	}
+
+	mq->dq.ranges = RB_ROOT;
+	mq->last_busy = jiffies;
+
 	sema_init(&mq->thread_sem, 1);
 
 	mq->thread = kthread_run(mmc_queue_thread, mq, "mmcqd/%d%s",
@@ -267,6 +297,11 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 
 	return 0;
  free_bounce_sg:
+	kfree(mqrq_cur->packed.cmd_hdr);
+	mqrq_cur->packed.cmd_hdr = NULL;
+	kfree(mqrq_prev->packed.cmd_hdr);
+	mqrq_prev->packed.cmd_hdr = NULL;
+
 	kfree(mqrq_cur->bounce_sg);
 	mqrq_cur->bounce_sg = NULL;
 	kfree(mqrq_prev->bounce_sg);
@@ -300,6 +335,10 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	/* Then terminate our worker thread */
 	kthread_stop(mq->thread);
 
+	/* Deferred discards are only hints, drop what is left */
+	while (mmc_dq_pop(&mq->dq, UINT_MAX, 1, NULL))
+		;
+
 	/* Empty the queue */
 	spin_lock_irqsave(q->queue_lock, flags);
 	q->queuedata = NULL;
@@ -324,6 +363,12 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	kfree(mqrq_prev->bounce_buf);
 	mqrq_prev->bounce_buf = NULL;
 
+	kfree(mqrq_cur->packed.cmd_hdr);
+	mqrq_cur->packed.cmd_hdr = NULL;
+
+	kfree(mqrq_prev->packed.cmd_hdr);
+	mqrq_prev->packed.cmd_hdr = NULL;
+
 	mq->card = NULL;
 }
 EXPORT_SYMBOL(mmc_cleanup_queue);
@@ -372,6 +417,308 @@ void mmc_queue_resume(struct mmc_queue *mq)
 	}
 }
 
+struct mmc_dq_range {
+	struct rb_node		rb_node;
+	sector_t		start;
+	sector_t		end;		/* exclusive */
+};
+
+#define MMC_DQ_MAX_RANGES	1024
+
+#define rb_to_range(node)	rb_entry((node), struct mmc_dq_range, rb_node)
+
+/*
+ * Ranges never overlap, so they are sorted by their end as well as by
+ * their start.  Find the first one ending at or after @sector.
+ */
+static struct mmc_dq_range *mmc_dq_find(struct mmc_discard_queue *dq,
+					sector_t sector)
+{
+	struct rb_node *node = dq->ranges.rb_node;
+	struct mmc_dq_range *found = NULL, *r;
+
+	while (node) {
+		r = rb_to_range(node);
+		if (r->end >= sector) {
+			found = r;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+	return found;
+}
+
+static struct mmc_dq_range *mmc_dq_next(struct mmc_dq_range *r)
+{
+	struct rb_node *node = rb_next(&r->rb_node);
+
+	return node ? rb_to_range(node) : NULL;
+}
+
+static void mmc_dq_insert(struct mmc_discard_queue *dq,
+			  struct mmc_dq_range *new)
+{
+	struct rb_node **p = &dq->ranges.rb_node, *parent = NULL;
+
+	while (*p) {
+		parent = *p;
+		if (new->start < rb_to_range(parent)->start)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&new->rb_node, parent, p);
+	rb_insert_color(&new->rb_node, &dq->ranges);
+	dq->nr_ranges++;
+}
+
+static void mmc_dq_erase(struct mmc_discard_queue *dq, struct mmc_dq_range *r)
+{
+	rb_erase(&r->rb_node, &dq->ranges);
+	dq->nr_ranges--;
+	kfree(r);
+}
+
+/**
+ * mmc_dq_add - defer a discard
+ * @dq: discard queue
+ * @start: first sector
+ * @nr: number of sectors
+ *
+ * The range is merged with any queued range it overlaps or touches.
+ * Returns -ENOSPC if too many separate ranges are queued already, in
+ * which case the caller should issue the discard itself.
+ */
+int mmc_dq_add(struct mmc_discard_queue *dq, sector_t start, unsigned int nr)
+{
+	sector_t end = start + nr;
+	struct mmc_dq_range *r, *next;
+
+	r = mmc_dq_find(dq, start);
+	if (!r || r->start > end) {
+		if (dq->nr_ranges >= MMC_DQ_MAX_RANGES)
+			return -ENOSPC;
+		r = kmalloc(sizeof(*r), GFP_NOIO);
+		if (!r)
+			return -ENOMEM;
+		r->start = start;
+		r->end = end;
+		mmc_dq_insert(dq, r);
+		dq->pending += nr;
+		dq->queued++;
+		return 0;
+	}
+
+	/* Grow r to cover the new range and swallow what it now touches */
+	dq->pending -= r->end - r->start;
+	if (start < r->start)
+		r->start = start;
+	if (end > r->end)
+		r->end = end;
+	while ((next = mmc_dq_next(r)) && next->start <= r->end) {
+		dq->pending -= next->end - next->start;
+		if (next->end > r->end)
+			r->end = next->end;
+		mmc_dq_erase(dq, next);
+	}
+	dq->pending += r->end - r->start;
+	dq->queued++;
+	dq->merged++;
+	return 0;
+}
+
+/**
+ * mmc_dq_cancel - forget queued discards for a range about to be written
+ * @dq: discard queue
+ * @start: first sector
+ * @nr: number of sectors
+ */
+void mmc_dq_cancel(struct mmc_discard_queue *dq, sector_t start,
+		   unsigned int nr)
+{
+	sector_t end = start + nr, cut;
+	struct mmc_dq_range *r, *next, *tail;
+
+	if (RB_EMPTY_ROOT(&dq->ranges))
+		return;
+
+	for (r = mmc_dq_find(dq, start + 1); r && r->start < end; r = next) {
+		next = mmc_dq_next(r);
+
+		if (r->start < start && r->end > end) {
+			/* Punch a hole; if that fails drop the tail */
+			tail = kmalloc(sizeof(*tail), GFP_NOIO);
+			if (tail) {
+				tail->start = end;
+				tail->end = r->end;
+				mmc_dq_insert(dq, tail);
+			}
+			cut = r->end - start - (tail ? r->end - end : 0);
+			r->end = start;
+		} else if (r->start < start) {
+			cut = r->end - start;
+			r->end = start;
+		} else if (r->end > end) {
+			cut = end - r->start;
+			r->start = end;
+		} else {
+			cut = r->end - r->start;
+			mmc_dq_erase(dq, r);
+		}
+		dq->pending -= cut;
+		dq->cancelled_sectors += cut;
+	}
+}
+
+/**
+ * mmc_dq_pop - take the next chunk of deferred discards
+ * @dq: discard queue
+ * @max: maximum number of sectors
+ * @align: chunk end alignment in sectors, when it can be honoured
+ * @start: first sector of the chunk
+ *
+ * Returns the number of sectors in the chunk, 0 if nothing is queued.
+ */
+unsigned int mmc_dq_pop(struct mmc_discard_queue *dq, unsigned int max,
+			unsigned int align, sector_t *start)
+{
+	struct rb_node *node = rb_first(&dq->ranges);
+	struct mmc_dq_range *r;
+	sector_t end, rem;
+	unsigned int nr;
+
+	if (!node)
+		return 0;
+
+	r = rb_to_range(node);
+	end = r->end;
+	if (end - r->start > max) {
+		end = r->start + max;
+		/* End on an erase boundary so no partial group is lost */
+		if (align > 1) {
+			rem = end;
+			rem = sector_div(rem, align);
+			if (end - rem > r->start)
+				end -= rem;
+		}
+	}
+
+	nr = end - r->start;
+	if (start)
+		*start = r->start;
+	dq->pending -= nr;
+	if (end == r->end)
+		mmc_dq_erase(dq, r);
+	else
+		r->start = end;
+
+	return nr;
+}
+
+/**
+ * mmc_queue_pack - gather queued writes to go out with @mqrq->req
+ * @mq: MMC queue
+ * @mqrq: queue request whose ->req has already been fetched
+ * @type: MMC_PACKED_WRITE or MMC_PACKED_CONTIG
+ * @max_entries: maximum number of requests, ->req included
+ *
+ * Pull writes off the head of the queue for as long as they fit in
+ * a single data transfer.  For MMC_PACKED_CONTIG each request must
+ * start where the previous one ended, so the whole batch is one
+ * ordinary multiple block write: this is how small sequential writes
+ * that the elevator did not get a chance to merge (the queue thread
+ * fetches requests as soon as they arrive) still reach SD cards as
+ * one large CMD25.  MMC_PACKED_WRITE accepts any write and reserves
+ * room for the packed command header.
+ *
+ * Returns the number of requests gathered.  If that is one, nothing
+ * was taken off the queue and @mqrq->packed is left empty.
+ */
+unsigned int mmc_queue_pack(struct mmc_queue *mq, struct mmc_queue_req *mqrq,
+			    enum mmc_packed_type type, unsigned int max_entries)
+{
+	struct request_queue *q = mq->queue;
+	struct mmc_packed *packed = &mqrq->packed;
+	struct request *cur = mqrq->req, *next;
+	unsigned int max_sectors, max_segs, sectors, segs;
+
+	max_sectors = min(queue_max_hw_sectors(q),
+			  mq->card->host->max_blk_count);
+	max_segs = queue_max_segments(q);
+
+	sectors = blk_rq_sectors(cur);
+	segs = cur->nr_phys_segments;
+	if (type == MMC_PACKED_WRITE) {
+		sectors += MMC_PACKED_HDR_SZ >> 9;
+		segs++;
+	}
+
+	packed->nr_entries = 1;
+	packed->blocks = blk_rq_sectors(cur);
+	packed->idx_failure = -1;
+	list_add_tail(&cur->queuelist, &packed->list);
+
+	spin_lock_irq(q->queue_lock);
+	while (packed->nr_entries < max_entries) {
+		next = blk_peek_request(q);
+		if (!next || !mmc_req_packable(next))
+			break;
+
+		if (type == MMC_PACKED_CONTIG &&
+		    blk_rq_pos(next) != blk_rq_pos(cur) + blk_rq_sectors(cur))
+			break;
+
+		if (sectors + blk_rq_sectors(next) > max_sectors ||
+		    segs + next->nr_phys_segments > max_segs)
+			break;
+
+		blk_start_request(next);
+		list_add_tail(&next->queuelist, &packed->list);
+		packed->nr_entries++;
+		packed->blocks += blk_rq_sectors(next);
+		sectors += blk_rq_sectors(next);
+		segs += next->nr_phys_segments;
+		cur = next;
+	}
+	spin_unlock_irq(q->queue_lock);
+
+	if (packed->nr_entries == 1)
+		list_del_init(&mqrq->req->queuelist);
+
+	return packed->nr_entries;
+}
+
+/*
+ * Map every request of a pack back to back into @sg, behind the
+ * packed command header if there is one.
+ */
+static unsigned int mmc_queue_packed_map_sg(struct mmc_queue *mq,
+					    struct mmc_queue_req *mqrq,
+					    struct scatterlist *sg)
+{
+	struct scatterlist *__sg = sg;
+	unsigned int sg_len = 0;
+	struct request *req;
+
+	if (mqrq->cmd_type == MMC_PACKED_WRITE) {
+		__sg->page_link &= ~0x02;
+		sg_set_buf(__sg, mqrq->packed.cmd_hdr, MMC_PACKED_HDR_SZ);
+		sg_len++;
+		__sg++;
+	}
+
+	list_for_each_entry(req, &mqrq->packed.list, queuelist) {
+		sg_len += blk_rq_map_sg(mq->queue, req, __sg);
+		/* blk_rq_map_sg() terminated the list, carry on past it */
+		__sg = sg + sg_len - 1;
+		(__sg++)->page_link &= ~0x02;
+	}
+	sg_mark_end(sg + sg_len - 1);
+
+	return sg_len;
+}
+
 /*
  * Prepare the sg list(s) to be handed of to the host driver
  */
@@ -382,12 +729,18 @@ unsigned int mmc_queue_map_sg(struct mmc_queue *mq, struct mmc_queue_req *mqrq)
 	struct scatterlist *sg;
 	int i;
 
-	if (!mqrq->bounce_buf)
+	if (!mqrq->bounce_buf) {
+		if (mqrq->cmd_type != MMC_PACKED_NONE)
+			return mmc_queue_packed_map_sg(mq, mqrq, mqrq->sg);
 		return blk_rq_map_sg(mq->queue, mqrq->req, mqrq->sg);
+	}
 
 	BUG_ON(!mqrq->bounce_sg);
 
-	sg_len = blk_rq_map_sg(mq->queue, mqrq->req, mqrq->bounce_sg);
+	if (mqrq->cmd_type != MMC_PACKED_NONE)
+		sg_len = mmc_queue_packed_map_sg(mq, mqrq, mqrq->bounce_sg);
+	else
+		sg_len = blk_rq_map_sg(mq->queue, mqrq->req, mqrq->bounce_sg);
 
 	mqrq->bounce_sg_len = sg_len;
 
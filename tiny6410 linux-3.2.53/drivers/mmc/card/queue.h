@@ -12,6 +12,24 @@ struct mmc_blk_request {
 	struct mmc_data		data;
 };
 
+enum mmc_packed_type {
+	MMC_PACKED_NONE = 0,
+	MMC_PACKED_WRITE,	/* eMMC 4.5 packed write, header block first */
+	MMC_PACKED_CONTIG,	/* back-to-back writes in a single CMD25 */
+};
+
+#define MMC_PACKED_HDR_SZ	512
+/* Entry 0 of the header is the packed command itself */
+#define MMC_PACKED_MAX_ENTRIES	(MMC_PACKED_HDR_SZ / 8 - 1)
+
+struct mmc_packed {
+	struct list_head	list;		/* requests, in card order */
+	__le32			*cmd_hdr;
+	unsigned int		nr_entries;
+	unsigned int		blocks;		/* data blocks, no header */
+	int			idx_failure;	/* from PACKED_FAILURE_INDEX */
+};
+
 struct mmc_queue_req {
 	struct request		*req;
 	struct mmc_blk_request	brq;
@@ -20,6 +38,26 @@ struct mmc_queue_req {
 	struct scatterlist	*bounce_sg;
 	unsigned int		bounce_sg_len;
 	struct mmc_async_req	mmc_active;
+	enum mmc_packed_type	cmd_type;
+	struct mmc_packed	packed;
+};
+
+/*
+ * Discards that have been completed towards the block layer but not
+ * yet sent to the card, kept as sorted, non-overlapping sector ranges.
+ */
+struct mmc_discard_queue {
+	struct rb_root		ranges;
+	unsigned int		nr_ranges;
+	sector_t		pending;	/* sectors in ranges */
+	unsigned int		chunk;		/* sectors per erase */
+
+	unsigned long		queued;		/* requests deferred */
+	unsigned long		merged;		/* ... joining a range */
+	unsigned long		issued;		/* erase commands sent */
+	unsigned long		issued_sectors;
+	unsigned long		cancelled_sectors; /* rewritten first */
+	unsigned long		errors;
 };
 
 struct mmc_queue {
@@ -28,6 +66,9 @@ struct mmc_queue {
 	struct semaphore	thread_sem;
 	unsigned int		flags;
 	int			(*issue_fn)(struct mmc_queue *, struct request *);
+	long			(*idle_fn)(struct mmc_queue *);
+	unsigned long		last_busy;	/* jiffies */
+	struct mmc_discard_queue dq;
 	void			*data;
 	struct request_queue	*queue;
 	struct mmc_queue_req	mqrq[2];
@@ -45,5 +86,24 @@ extern unsigned int mmc_queue_map_sg(struct mmc_queue *,
 				     struct mmc_queue_req *);
 extern void mmc_queue_bounce_pre(struct mmc_queue_req *);
 extern void mmc_queue_bounce_post(struct mmc_queue_req *);
+extern int mmc_dq_add(struct mmc_discard_queue *, sector_t, unsigned int);
+extern void mmc_dq_cancel(struct mmc_discard_queue *, sector_t, unsigned int);
+extern unsigned int mmc_dq_pop(struct mmc_discard_queue *, unsigned int,
+			       unsigned int, sector_t *);
+extern unsigned int mmc_queue_pack(struct mmc_queue *,
+				   struct mmc_queue_req *,
+				   enum mmc_packed_type, unsigned int);
+
+
+/*
+ * Only plain writes are packed; anything carrying ordering or
+ * reliability semantics is issued on its own.
+ */
+static inline bool mmc_req_packable(struct request *req)
+{
+	return rq_data_dir(req) == WRITE &&
+		!(req->cmd_flags & (REQ_DISCARD | REQ_FLUSH | REQ_FUA |
+				    REQ_META));
+}
 
 #endif
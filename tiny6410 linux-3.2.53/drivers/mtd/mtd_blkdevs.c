@@ -90,6 +90,9 @@ static int do_blktrans_request(struct mtd_blktrans_ops *tr,
 	if (req->cmd_type != REQ_TYPE_FS)
 		return -EIO;
 
+	if (req->cmd_flags & REQ_FLUSH)
+		return tr->flush(dev);
+
 	if (blk_rq_pos(req) + blk_rq_cur_sectors(req) >
 	    get_capacity(req->rq_disk))
 		return -EIO;
@@ -427,6 +430,10 @@ int add_mtd_blktrans_dev(struct mtd_blktrans_dev *new)
 	new->rq->queuedata = new;
 	blk_queue_logical_block_size(new->rq, tr->blksize);
 
+	/* let write caches be flushed on fsync() and friends */
+	if (tr->flush)
+		blk_queue_flush(new->rq, REQ_FLUSH);
+
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, new->rq);
 
 	if (tr->discard) {
@@ -28,20 +28,45 @@
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/blktrans.h>
 #include <linux/mutex.h>
 
 
+/*
+ * Number of eraseblocks cached per device, and how long dirty eraseblocks
+ * may stay in memory before they are written back.
+ */
+static int caches = 4;
+module_param(caches, int, 0444);
+MODULE_PARM_DESC(caches, "Number of eraseblocks cached per device (default 4)");
+
+static unsigned int writeback_ms = 3000;
+module_param(writeback_ms, uint, 0644);
+MODULE_PARM_DESC(writeback_ms, "Write dirty eraseblocks back after this many "
+		 "milliseconds, 0 to only write back on sync or eviction "
+		 "(default 3000)");
+
+struct mtdblk_cache {
+	struct list_head list;
+	unsigned char *data;
+	unsigned long offset;
+	unsigned long dirtied;
+	enum { STATE_EMPTY, STATE_CLEAN, STATE_DIRTY } state;
+};
+
 struct mtdblk_dev {
 	struct mtd_blktrans_dev mbd;
 	int count;
 	struct mutex cache_mutex;
-	unsigned char *cache_data;
-	unsigned long cache_offset;
 	unsigned int cache_size;
-	enum { STATE_EMPTY, STATE_CLEAN, STATE_DIRTY } cache_state;
+	int nr_caches;
+	struct mtdblk_cache *caches;
+	struct list_head cache_lru;
+	struct delayed_work writeback_work;
+	int writeback_err;	/* last write-back error, for flush/release */
 };
 
 static DEFINE_MUTEX(mtdblks_lock);
@@ -52,8 +77,13 @@ static DEFINE_MUTEX(mtdblks_lock);
  * Since typical flash erasable sectors are much larger than what Linux's
  * buffer cache can handle, we must implement read-modify-write on flash
  * sectors for each block write requests.  To avoid over-erasing flash sectors
- * and to speed things up, we locally cache a whole flash sector while it is
- * being written to until a different sector is required.
+ * and to speed things up, we locally cache a few whole flash sectors while
+ * they are being written to.  The caches are kept in LRU order: when a
+ * sector which is not cached is needed and all caches are in use, the least
+ * recently used one is written back and reused.  Dirty caches are also
+ * written back on sync, on last close and writeback_ms after they were
+ * first dirtied, so that interleaved writers do not each cause an
+ * erase/program cycle for every request.
  */
 
 static void erase_callback(struct erase_info *done)
@@ -111,20 +141,21 @@ static int erase_write (struct mtd_info *mtd, unsigned long pos,
 }
 
 
-static int write_cached_data (struct mtdblk_dev *mtdblk)
+static int write_cached_data (struct mtdblk_dev *mtdblk,
+			      struct mtdblk_cache *cache)
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	int ret;
 
-	if (mtdblk->cache_state != STATE_DIRTY)
+	if (cache->state != STATE_DIRTY)
 		return 0;
 
 	pr_debug("mtdblock: writing cached data for \"%s\" "
 			"at 0x%lx, size 0x%x\n", mtd->name,
-			mtdblk->cache_offset, mtdblk->cache_size);
+			cache->offset, mtdblk->cache_size);
 
-	ret = erase_write (mtd, mtdblk->cache_offset,
-			   mtdblk->cache_size, mtdblk->cache_data);
+	ret = erase_write (mtd, cache->offset,
+			   mtdblk->cache_size, cache->data);
 	if (ret)
 		return ret;
 
@@ -135,16 +166,158 @@ static int write_cached_data (struct mtdblk_dev *mtdblk)
 	 * means.  Let's declare it empty and leave buffering tasks to
 	 * the buffer cache instead.
 	 */
-	mtdblk->cache_state = STATE_EMPTY;
+	cache->state = STATE_EMPTY;
 	return 0;
 }
 
+static int write_all_cached_data (struct mtdblk_dev *mtdblk)
+{
+	int i, ret, err = 0;
+
+	for (i = 0; i < mtdblk->nr_caches; i++) {
+		ret = write_cached_data(mtdblk, &mtdblk->caches[i]);
+		if (ret && !err)
+			err = ret;
+	}
+	return err;
+}
+
+static struct mtdblk_cache *find_cache (struct mtdblk_dev *mtdblk,
+					unsigned long sect_start)
+{
+	struct mtdblk_cache *cache;
+
+	list_for_each_entry(cache, &mtdblk->cache_lru, list)
+		if (cache->state != STATE_EMPTY &&
+		    cache->offset == sect_start)
+			return cache;
+	return NULL;
+}
+
+/*
+ * Return a cache holding the sector at @sect_start, reading it from flash
+ * if needed.  Empty caches are used first, then the least recently used
+ * one is written back and recycled.
+ */
+static struct mtdblk_cache *get_cache (struct mtdblk_dev *mtdblk,
+				       unsigned long sect_start, int *err)
+{
+	struct mtd_info *mtd = mtdblk->mbd.mtd;
+	struct mtdblk_cache *cache, *victim = NULL;
+	size_t retlen;
+	int ret;
+
+	cache = find_cache(mtdblk, sect_start);
+	if (cache)
+		goto found;
+
+	list_for_each_entry(cache, &mtdblk->cache_lru, list) {
+		if (cache->state != STATE_EMPTY)
+			continue;
+		if (!cache->data)
+			cache->data = vmalloc(mtdblk->cache_size);
+		if (cache->data) {
+			victim = cache;
+			break;
+		}
+	}
+	if (!victim) {
+		list_for_each_entry_reverse(cache, &mtdblk->cache_lru, list)
+			if (cache->data) {
+				victim = cache;
+				break;
+			}
+		if (!victim) {
+			/*
+			 * -EINTR is not really correct, but it is the best
+			 * match documented in man 2 write for all cases.
+			 */
+			*err = -EINTR;
+			return NULL;
+		}
+		ret = write_cached_data(mtdblk, victim);
+		if (ret) {
+			*err = ret;
+			return NULL;
+		}
+	}
+
+	/* fill the cache with the current sector */
+	cache = victim;
+	cache->state = STATE_EMPTY;
+	ret = mtd->read(mtd, sect_start, mtdblk->cache_size, &retlen,
+			cache->data);
+	if (!ret && retlen != mtdblk->cache_size)
+		ret = -EIO;
+	if (ret) {
+		*err = ret;
+		return NULL;
+	}
+	cache->offset = sect_start;
+	cache->state = STATE_CLEAN;
+found:
+	list_move(&cache->list, &mtdblk->cache_lru);
+	return cache;
+}
+
+static void mtdblock_writeback_work(struct work_struct *work)
+{
+	struct mtdblk_dev *mtdblk = container_of(to_delayed_work(work),
+						 struct mtdblk_dev,
+						 writeback_work);
+	unsigned long delay = msecs_to_jiffies(writeback_ms);
+	unsigned long next = 0, due;
+	int i, ret, pending = 0;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	for (i = 0; i < mtdblk->nr_caches; i++) {
+		struct mtdblk_cache *cache = &mtdblk->caches[i];
+
+		if (cache->state != STATE_DIRTY)
+			continue;
+		due = cache->dirtied + delay;
+		if (time_after_eq(jiffies, due)) {
+			ret = write_cached_data(mtdblk, cache);
+			if (!ret)
+				continue;
+			/* still dirty: retry later, report on flush/release */
+			printk(KERN_ERR "mtdblock: write-back of 0x%lx on "
+			       "\"%s\" failed (%d)\n", cache->offset,
+			       mtdblk->mbd.mtd->name, ret);
+			mtdblk->writeback_err = ret;
+			due = jiffies + max_t(unsigned long, delay, HZ);
+		}
+		if (!pending || time_before(due, next)) {
+			next = due;
+			pending = 1;
+		}
+	}
+	if (pending)
+		schedule_delayed_work(&mtdblk->writeback_work,
+				      time_after(next, jiffies) ?
+				      next - jiffies : 0);
+	mutex_unlock(&mtdblk->cache_mutex);
+}
+
+static void mark_cache_dirty (struct mtdblk_dev *mtdblk,
+			      struct mtdblk_cache *cache)
+{
+	if (cache->state == STATE_DIRTY)
+		return;
+
+	cache->state = STATE_DIRTY;
+	cache->dirtied = jiffies;
+	if (writeback_ms)
+		schedule_delayed_work(&mtdblk->writeback_work,
+				      msecs_to_jiffies(writeback_ms));
+}
 
 static int do_cached_write (struct mtdblk_dev *mtdblk, unsigned long pos,
 			    int len, const char *buf)
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	unsigned int sect_size = mtdblk->cache_size;
+	struct mtdblk_cache *cache;
 	size_t retlen;
 	int ret;
 
@@ -165,40 +338,24 @@ static int do_cached_write (struct mtdblk_dev *mtdblk, unsigned long pos,
 			/*
 			 * We are covering a whole sector.  Thus there is no
 			 * need to bother with the cache while it may still be
-			 * useful for other partial writes.
+			 * useful for other partial writes.  Just make sure a
+			 * stale copy does not get written back later.
 			 */
+			cache = find_cache(mtdblk, sect_start);
+			if (cache)
+				cache->state = STATE_EMPTY;
 			ret = erase_write (mtd, pos, size, buf);
 			if (ret)
 				return ret;
 		} else {
 			/* Partial sector: need to use the cache */
-
-			if (mtdblk->cache_state == STATE_DIRTY &&
-			    mtdblk->cache_offset != sect_start) {
-				ret = write_cached_data(mtdblk);
-				if (ret)
-					return ret;
-			}
-
-			if (mtdblk->cache_state == STATE_EMPTY ||
-			    mtdblk->cache_offset != sect_start) {
-				/* fill the cache with the current sector */
-				mtdblk->cache_state = STATE_EMPTY;
-				ret = mtd->read(mtd, sect_start, sect_size,
-						&retlen, mtdblk->cache_data);
-				if (ret)
-					return ret;
-				if (retlen != sect_size)
-					return -EIO;
-
-				mtdblk->cache_offset = sect_start;
-				mtdblk->cache_size = sect_size;
-				mtdblk->cache_state = STATE_CLEAN;
-			}
+			cache = get_cache(mtdblk, sect_start, &ret);
+			if (!cache)
+				return ret;
 
 			/* write data to our local cache */
-			memcpy (mtdblk->cache_data + offset, buf, size);
-			mtdblk->cache_state = STATE_DIRTY;
+			memcpy (cache->data + offset, buf, size);
+			mark_cache_dirty(mtdblk, cache);
 		}
 
 		buf += size;
@@ -215,6 +372,7 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 {
 	struct mtd_info *mtd = mtdblk->mbd.mtd;
 	unsigned int sect_size = mtdblk->cache_size;
+	struct mtdblk_cache *cache;
 	size_t retlen;
 	int ret;
 
@@ -237,9 +395,9 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 		 * contains what we want, otherwise we read the data directly
 		 * from flash.
 		 */
-		if (mtdblk->cache_state != STATE_EMPTY &&
-		    mtdblk->cache_offset == sect_start) {
-			memcpy (buf, mtdblk->cache_data + offset, size);
+		cache = find_cache(mtdblk, sect_start);
+		if (cache) {
+			memcpy (buf, cache->data + offset, size);
 		} else {
 			ret = mtd->read(mtd, pos, size, &retlen, buf);
 			if (ret)
@@ -260,28 +418,30 @@ static int mtdblock_readsect(struct mtd_blktrans_dev *dev,
 			      unsigned long block, char *buf)
 {
 	struct mtdblk_dev *mtdblk = container_of(dev, struct mtdblk_dev, mbd);
-	return do_cached_read(mtdblk, block<<9, 512, buf);
+	int ret;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	ret = do_cached_read(mtdblk, block<<9, 512, buf);
+	mutex_unlock(&mtdblk->cache_mutex);
+	return ret;
 }
 
 static int mtdblock_writesect(struct mtd_blktrans_dev *dev,
 			      unsigned long block, char *buf)
 {
 	struct mtdblk_dev *mtdblk = container_of(dev, struct mtdblk_dev, mbd);
-	if (unlikely(!mtdblk->cache_data && mtdblk->cache_size)) {
-		mtdblk->cache_data = vmalloc(mtdblk->mbd.mtd->erasesize);
-		if (!mtdblk->cache_data)
-			return -EINTR;
-		/* -EINTR is not really correct, but it is the best match
-		 * documented in man 2 write for all cases.  We could also
-		 * return -EAGAIN sometimes, but why bother?
-		 */
-	}
-	return do_cached_write(mtdblk, block<<9, 512, buf);
+	int ret;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	ret = do_cached_write(mtdblk, block<<9, 512, buf);
+	mutex_unlock(&mtdblk->cache_mutex);
+	return ret;
 }
 
 static int mtdblock_open(struct mtd_blktrans_dev *mbd)
 {
 	struct mtdblk_dev *mtdblk = container_of(mbd, struct mtdblk_dev, mbd);
+	int i;
 
 	pr_debug("mtdblock_open\n");
 
@@ -293,13 +453,28 @@ static int mtdblock_open(struct mtd_blktrans_dev *mbd)
 	}
 
 	/* OK, it's not open. Create cache info for it */
-	mtdblk->count = 1;
 	mutex_init(&mtdblk->cache_mutex);
-	mtdblk->cache_state = STATE_EMPTY;
+	INIT_LIST_HEAD(&mtdblk->cache_lru);
+	mtdblk->cache_size = 0;
+	mtdblk->nr_caches = 0;
+	mtdblk->writeback_err = 0;
 	if (!(mbd->mtd->flags & MTD_NO_ERASE) && mbd->mtd->erasesize) {
+		int nr = max(caches, 1);
+
+		/* the data buffers are only allocated on first write */
+		mtdblk->caches = kcalloc(nr, sizeof(struct mtdblk_cache),
+					 GFP_KERNEL);
+		if (!mtdblk->caches) {
+			mutex_unlock(&mtdblks_lock);
+			return -ENOMEM;
+		}
+		for (i = 0; i < nr; i++)
+			list_add_tail(&mtdblk->caches[i].list,
+				      &mtdblk->cache_lru);
+		mtdblk->nr_caches = nr;
 		mtdblk->cache_size = mbd->mtd->erasesize;
-		mtdblk->cache_data = NULL;
 	}
+	mtdblk->count = 1;
 
 	mutex_unlock(&mtdblks_lock);
 
@@ -311,40 +486,53 @@ static int mtdblock_open(struct mtd_blktrans_dev *mbd)
 static int mtdblock_release(struct mtd_blktrans_dev *mbd)
 {
 	struct mtdblk_dev *mtdblk = container_of(mbd, struct mtdblk_dev, mbd);
+	int i, ret;
 
 	pr_debug("mtdblock_release\n");
 
 	mutex_lock(&mtdblks_lock);
 
 	mutex_lock(&mtdblk->cache_mutex);
-	write_cached_data(mtdblk);
+	ret = write_all_cached_data(mtdblk);
+	if (!ret)
+		ret = mtdblk->writeback_err;
+	mtdblk->writeback_err = 0;
 	mutex_unlock(&mtdblk->cache_mutex);
 
 	if (!--mtdblk->count) {
 		/* It was the last usage. Free the cache */
+		cancel_delayed_work_sync(&mtdblk->writeback_work);
 		if (mbd->mtd->sync)
 			mbd->mtd->sync(mbd->mtd);
-		vfree(mtdblk->cache_data);
+		for (i = 0; i < mtdblk->nr_caches; i++)
+			vfree(mtdblk->caches[i].data);
+		kfree(mtdblk->caches);
+		mtdblk->caches = NULL;
+		mtdblk->nr_caches = 0;
 	}
 
 	mutex_unlock(&mtdblks_lock);
 
 	pr_debug("ok\n");
 
-	return 0;
+	return ret;
 }
 
 static int mtdblock_flush(struct mtd_blktrans_dev *dev)
 {
 	struct mtdblk_dev *mtdblk = container_of(dev, struct mtdblk_dev, mbd);
+	int ret;
 
 	mutex_lock(&mtdblk->cache_mutex);
-	write_cached_data(mtdblk);
+	ret = write_all_cached_data(mtdblk);
+	if (!ret)
+		ret = mtdblk->writeback_err;
+	mtdblk->writeback_err = 0;
 	mutex_unlock(&mtdblk->cache_mutex);
 
 	if (dev->mtd->sync)
 		dev->mtd->sync(dev->mtd);
-	return 0;
+	return ret;
 }
 
 static void mtdblock_add_mtd(struct mtd_blktrans_ops *tr, struct mtd_info *mtd)
@@ -356,6 +544,7 @@ static void mtdblock_add_mtd(struct mtd_blktrans_ops *tr, struct mtd_info *mtd)
 
 	dev->mbd.mtd = mtd;
 	dev->mbd.devnum = mtd->index;
+	INIT_DELAYED_WORK(&dev->writeback_work, mtdblock_writeback_work);
 
 	dev->mbd.size = mtd->size >> 9;
 	dev->mbd.tr = tr;
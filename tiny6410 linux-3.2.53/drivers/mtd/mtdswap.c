@@ -38,6 +38,8 @@
 #include <linux/seq_file.h>
 #include <linux/device.h>
 #include <linux/math64.h>
+#include <linux/lzo.h>
+#include <asm/unaligned.h>
 
 #define MTDSWAP_PREFIX "mtdswap"
 
@@ -68,9 +70,24 @@
 #define COLLECT_NONDIRTY_FREQ2	4
 
 #define PAGE_UNDEF		UINT_MAX
+#define PAGE_PACKED		(UINT_MAX - 1)
 #define BLOCK_UNDEF		UINT_MAX
 #define BLOCK_ERROR		(UINT_MAX - 1)
-#define BLOCK_MAX		(UINT_MAX - 2)
+#define BLOCK_PENDING		(UINT_MAX - 2)
+#define BLOCK_GC_PENDING	(UINT_MAX - 3)
+#define BLOCK_MAX		(UINT_MAX - 4)
+
+/*
+ * With compression enabled a block may hold several compressed pages.
+ * Each fragment is preceded by a small header naming the swap page it
+ * belongs to, so that GC can walk a packed block without any further
+ * on-flash metadata. The end of the fragment list is marked by an
+ * invalid length (the remainder of the block is filled with 0xff).
+ * Pages which do not compress below MTDSWAP_PACK_LIMIT are stored raw,
+ * one per block, exactly as without compression.
+ */
+#define MTDSWAP_FRAG_HDR	6	/* __le32 page, __le16 length */
+#define MTDSWAP_PACK_LIMIT	(PAGE_SIZE * 3 / 4)
 
 #define EBLOCK_BAD		(1 << 0)
 #define EBLOCK_NOMAGIC		(1 << 1)
@@ -99,6 +116,22 @@ struct mtdswap_tree {
 	unsigned int count;
 };
 
+/* Location of a compressed page inside its block */
+struct mtdswap_frag {
+	u16 offset;
+	u16 len;
+};
+
+/*
+ * RAM staging buffer where compressed pages are collected until a full
+ * block can be written. Pages held in it are mapped to @marker.
+ */
+struct mtdswap_pack {
+	char *buf;
+	unsigned int pos;
+	unsigned int marker;
+};
+
 enum {
 	MTDSWAP_CLEAN,
 	MTDSWAP_USED,
@@ -117,6 +150,8 @@ struct mtdswap_dev {
 
 	unsigned int *page_data;
 	unsigned int *revmap;
+	struct mtdswap_frag *frags;
+	u16 *live_frags;
 
 	unsigned int eblks;
 	unsigned int spare_eblks;
@@ -133,12 +168,24 @@ struct mtdswap_dev {
 	unsigned long long discard_count;
 	unsigned long long discard_page_count;
 
+	unsigned long long block_write_count;
+	unsigned long long gc_write_count;
+	unsigned long long packed_page_count;
+	unsigned long long raw_page_count;
+	unsigned long long packed_bytes;
+
 	unsigned int curr_write_pos;
 	struct swap_eb *curr_write;
 
 	char *page_buf;
 	char *oob_buf;
 
+	int compress;
+	void *lzo_wrkmem;
+	char *lzo_buf;
+	struct mtdswap_pack pack;
+	struct mtdswap_pack gc_pack;
+
 	struct dentry *debugfs_root;
 };
 
@@ -194,6 +241,16 @@ module_param(header, bool, 0444);
 MODULE_PARM_DESC(header,
 		"Include builtin swap header (default 0, without header)");
 
+static bool compress = 1;
+module_param(compress, bool, 0444);
+MODULE_PARM_DESC(compress,
+		"Compress swap pages with LZO and pack them (default 1)");
+
+static unsigned int overcommit = 100;
+module_param(overcommit, uint, 0444);
+MODULE_PARM_DESC(overcommit, "Swap size advertised as percentage of the "
+		"usable flash when compressing (default 100%, max 400%)");
+
 static int mtdswap_gc(struct mtdswap_dev *d, unsigned int background);
 
 static loff_t mtdswap_eb_offset(struct mtdswap_dev *d, struct swap_eb *eb)
@@ -711,6 +768,10 @@ retry:
 		goto err;
 	}
 
+	d->block_write_count++;
+	if (gc_context)
+		d->gc_write_count++;
+
 	return ret;
 
 err:
@@ -721,6 +782,168 @@ err:
 	return ret;
 }
 
+static int mtdswap_frag_live(struct mtdswap_dev *d, unsigned int page,
+			unsigned int block, unsigned int offset)
+{
+	return page < d->mbd_dev->size && d->page_data[page] == block &&
+		d->frags[page].offset == offset;
+}
+
+/*
+ * Parse the fragment header at @pos of a packed block. Returns the offset
+ * of the fragment data, or 0 at the end of the fragment list.
+ */
+static unsigned int mtdswap_next_frag(const char *buf, unsigned int pos,
+				unsigned int *page, unsigned int *len)
+{
+	if (pos + MTDSWAP_FRAG_HDR > PAGE_SIZE)
+		return 0;
+
+	*len = get_unaligned_le16(buf + pos + 4);
+	if (!*len || *len > PAGE_SIZE - pos - MTDSWAP_FRAG_HDR)
+		return 0;
+
+	*page = get_unaligned_le32(buf + pos);
+	return pos + MTDSWAP_FRAG_HDR;
+}
+
+#define mtdswap_for_each_frag(buf, pos, off, page, len)			\
+	for (pos = 0; (off = mtdswap_next_frag(buf, pos, &page, &len));	\
+	     pos = off + len)
+
+/*
+ * Write out the staging buffer as one block. Fragments whose pages have
+ * been rewritten or discarded in the meantime are dropped; if nothing is
+ * left the buffer is simply reset. On error the buffer is kept so that
+ * the pages in it stay readable.
+ */
+static int mtdswap_pack_flush(struct mtdswap_dev *d, struct mtdswap_pack *pack,
+			int gc_context)
+{
+	unsigned int pos, off, page, len, block, live = 0;
+	int ret;
+
+	if (!pack->pos)
+		return 0;
+
+	mtdswap_for_each_frag(pack->buf, pos, off, page, len)
+		if (mtdswap_frag_live(d, page, pack->marker, off))
+			live++;
+
+	if (live) {
+		ret = mtdswap_write_block(d, pack->buf, PAGE_PACKED, &block,
+					gc_context);
+		if (ret < 0)
+			return ret;
+
+		mtdswap_for_each_frag(pack->buf, pos, off, page, len)
+			if (mtdswap_frag_live(d, page, pack->marker, off))
+				d->page_data[page] = block;
+
+		d->live_frags[block] = live;
+	}
+
+	memset(pack->buf, 0xff, PAGE_SIZE);
+	pack->pos = 0;
+
+	return 0;
+}
+
+static int mtdswap_pack_add(struct mtdswap_dev *d, struct mtdswap_pack *pack,
+			unsigned int page, const char *data, unsigned int len,
+			int gc_context)
+{
+	int ret;
+
+	if (pack->pos + MTDSWAP_FRAG_HDR + len > PAGE_SIZE) {
+		ret = mtdswap_pack_flush(d, pack, gc_context);
+		if (ret < 0)
+			return ret;
+	}
+
+	put_unaligned_le32(page, pack->buf + pack->pos);
+	put_unaligned_le16(len, pack->buf + pack->pos + 4);
+	pack->pos += MTDSWAP_FRAG_HDR;
+	memcpy(pack->buf + pack->pos, data, len);
+
+	d->page_data[page] = pack->marker;
+	d->frags[page].offset = pack->pos;
+	d->frags[page].len = len;
+	pack->pos += len;
+
+	return 0;
+}
+
+/*
+ * GC of a packed block: the live fragments are copied, still compressed,
+ * into the GC staging buffer. Dead fragments are left behind, so partly
+ * stale packed blocks get compacted as a side effect.
+ */
+static int mtdswap_move_packed(struct mtdswap_dev *d, unsigned int oldblock)
+{
+	struct mtd_info *mtd = d->mtd;
+	struct swap_eb *oldeb;
+	unsigned int pos, off, page, len, retries;
+	size_t retlen;
+	loff_t readpos;
+	int ret, errcode;
+
+	oldeb = d->eb_data + oldblock / d->pages_per_eblk;
+	readpos = (loff_t) oldblock << PAGE_SHIFT;
+	retries = 0;
+
+retry:
+	ret = mtd->read(mtd, readpos, PAGE_SIZE, &retlen, d->page_buf);
+
+	if (ret < 0 && !mtd_is_bitflip(ret)) {
+		oldeb->flags |= EBLOCK_READERR;
+
+		dev_err(d->dev, "Read Error: %d (block %u)\n", ret,
+			oldblock);
+		retries++;
+		if (retries < MTDSWAP_IO_RETRIES)
+			goto retry;
+
+		goto read_error;
+	}
+
+	if (retlen != PAGE_SIZE) {
+		dev_err(d->dev, "Short read: %zd (block %u)\n", retlen,
+		       oldblock);
+		ret = -EIO;
+		goto read_error;
+	}
+
+	errcode = 0;
+	mtdswap_for_each_frag(d->page_buf, pos, off, page, len) {
+		if (!mtdswap_frag_live(d, page, oldblock, off))
+			continue;
+
+		ret = mtdswap_pack_add(d, &d->gc_pack, page, d->page_buf + off,
+				len, 1);
+		if (ret < 0) {
+			d->page_data[page] = BLOCK_ERROR;
+			dev_err(d->dev, "Write error: %d\n", ret);
+			if (!errcode)
+				errcode = ret;
+		}
+	}
+
+	d->live_frags[oldblock] = 0;
+	d->revmap[oldblock] = PAGE_UNDEF;
+	oldeb->active_count--;
+
+	return errcode;
+
+read_error:
+	for (page = 0; page < d->mbd_dev->size; page++)
+		if (d->page_data[page] == oldblock)
+			d->page_data[page] = BLOCK_ERROR;
+	d->live_frags[oldblock] = 0;
+	d->revmap[oldblock] = PAGE_UNDEF;
+	return ret;
+}
+
 static int mtdswap_move_block(struct mtdswap_dev *d, unsigned int oldblock,
 		unsigned int *newblock)
 {
@@ -788,18 +1011,28 @@ static int mtdswap_gc_eblock(struct mtdswap_dev *d, struct swap_eb *eb)
 	eblk_base = (eb - d->eb_data) * d->pages_per_eblk;
 
 	for (i = 0; i < d->pages_per_eblk; i++) {
-		if (d->spare_eblks < MIN_SPARE_EBLOCKS)
-			return -ENOSPC;
+		if (d->spare_eblks < MIN_SPARE_EBLOCKS) {
+			errcode = -ENOSPC;
+			break;
+		}
 
 		block = eblk_base + i;
 		if (d->revmap[block] == PAGE_UNDEF)
 			continue;
 
-		ret = mtdswap_move_block(d, block, &newblock);
+		if (d->revmap[block] == PAGE_PACKED)
+			ret = mtdswap_move_packed(d, block);
+		else
+			ret = mtdswap_move_block(d, block, &newblock);
 		if (ret < 0 && !errcode)
 			errcode = ret;
 	}
 
+	/* Moved fragments must reach the flash before the eraseblock goes */
+	ret = mtdswap_pack_flush(d, &d->gc_pack, 1);
+	if (ret < 0 && !errcode)
+		errcode = ret;
+
 	return errcode;
 }
 
@@ -1039,6 +1272,12 @@ static void mtdswap_cleanup(struct mtdswap_dev *d)
 	vfree(d->eb_data);
 	vfree(d->revmap);
 	vfree(d->page_data);
+	vfree(d->frags);
+	vfree(d->live_frags);
+	vfree(d->lzo_wrkmem);
+	kfree(d->lzo_buf);
+	kfree(d->pack.buf);
+	kfree(d->gc_pack.buf);
 	kfree(d->oob_buf);
 	kfree(d->page_buf);
 }
@@ -1046,10 +1285,14 @@ static void mtdswap_cleanup(struct mtdswap_dev *d)
 static int mtdswap_flush(struct mtd_blktrans_dev *dev)
 {
 	struct mtdswap_dev *d = MTDSWAP_MBD_TO_MTDSWAP(dev);
+	int ret = 0;
+
+	if (d->compress)
+		ret = mtdswap_pack_flush(d, &d->pack, 0);
 
 	if (d->mtd->sync)
 		d->mtd->sync(d->mtd);
-	return 0;
+	return ret;
 }
 
 static unsigned int mtdswap_badblocks(struct mtd_info *mtd, uint64_t size)
@@ -1067,11 +1310,51 @@ static unsigned int mtdswap_badblocks(struct mtd_info *mtd, uint64_t size)
 	return badcnt;
 }
 
+static void mtdswap_unmap_page(struct mtdswap_dev *d, unsigned int page)
+{
+	unsigned int mapped = d->page_data[page];
+	struct swap_eb *eb;
+
+	d->page_data[page] = BLOCK_UNDEF;
+	if (mapped > BLOCK_MAX)
+		return;
+
+	/* A packed block stays in use until its last fragment is gone */
+	if (d->revmap[mapped] == PAGE_PACKED && --d->live_frags[mapped])
+		return;
+
+	eb = d->eb_data + (mapped / d->pages_per_eblk);
+	eb->active_count--;
+	mtdswap_store_eb(d, eb);
+	d->revmap[mapped] = PAGE_UNDEF;
+}
+
+static int mtdswap_write_packed(struct mtdswap_dev *d, unsigned int page,
+				char *buf)
+{
+	size_t clen;
+	int ret;
+
+	ret = lzo1x_1_compress(buf, PAGE_SIZE, d->lzo_buf, &clen,
+			d->lzo_wrkmem);
+	if (ret != LZO_E_OK || clen + MTDSWAP_FRAG_HDR > MTDSWAP_PACK_LIMIT)
+		return 1;
+
+	ret = mtdswap_pack_add(d, &d->pack, page, d->lzo_buf, clen, 0);
+	if (ret < 0)
+		return ret;
+
+	d->packed_page_count++;
+	d->packed_bytes += clen;
+
+	return 0;
+}
+
 static int mtdswap_writesect(struct mtd_blktrans_dev *dev,
 			unsigned long page, char *buf)
 {
 	struct mtdswap_dev *d = MTDSWAP_MBD_TO_MTDSWAP(dev);
-	unsigned int newblock, mapped;
+	unsigned int newblock;
 	struct swap_eb *eb;
 	int ret;
 
@@ -1088,13 +1371,15 @@ static int mtdswap_writesect(struct mtd_blktrans_dev *dev,
 		page--;
 	}
 
-	mapped = d->page_data[page];
-	if (mapped <= BLOCK_MAX) {
-		eb = d->eb_data + (mapped / d->pages_per_eblk);
-		eb->active_count--;
-		mtdswap_store_eb(d, eb);
-		d->page_data[page] = BLOCK_UNDEF;
-		d->revmap[mapped] = PAGE_UNDEF;
+	mtdswap_unmap_page(d, page);
+
+	if (d->compress) {
+		ret = mtdswap_write_packed(d, page, buf);
+		if (ret <= 0)
+			return ret;
+
+		/* Incompressible, store it as is */
+		d->raw_page_count++;
 	}
 
 	ret = mtdswap_write_block(d, buf, page, &newblock, 0);
@@ -1125,15 +1410,33 @@ static int mtdswap_auto_header(struct mtdswap_dev *d, char *buf)
 	return 0;
 }
 
+static int mtdswap_decompress(struct mtdswap_dev *d, const char *src,
+			unsigned int len, char *buf)
+{
+	size_t dlen = PAGE_SIZE;
+	int ret;
+
+	ret = lzo1x_decompress_safe(src, len, buf, &dlen);
+	if (ret != LZO_E_OK || dlen != PAGE_SIZE) {
+		dev_err(d->dev, "Decompression failed: %d (%zd bytes)\n",
+			ret, dlen);
+		return -EIO;
+	}
+
+	return 0;
+}
+
 static int mtdswap_readsect(struct mtd_blktrans_dev *dev,
 			unsigned long page, char *buf)
 {
 	struct mtdswap_dev *d = MTDSWAP_MBD_TO_MTDSWAP(dev);
 	struct mtd_info *mtd = d->mtd;
 	unsigned int realblock, retries;
+	struct mtdswap_frag *frag;
+	size_t readlen, retlen;
 	loff_t readpos;
 	struct swap_eb *eb;
-	size_t retlen;
+	char *readbuf;
 	int ret;
 
 	d->sect_read_count++;
@@ -1146,6 +1449,15 @@ static int mtdswap_readsect(struct mtd_blktrans_dev *dev,
 	}
 
 	realblock = d->page_data[page];
+	frag = d->frags ? &d->frags[page] : NULL;
+
+	if (realblock == BLOCK_PENDING)
+		return mtdswap_decompress(d, d->pack.buf + frag->offset,
+					frag->len, buf);
+	if (realblock == BLOCK_GC_PENDING)
+		return mtdswap_decompress(d, d->gc_pack.buf + frag->offset,
+					frag->len, buf);
+
 	if (realblock > BLOCK_MAX) {
 		memset(buf, 0x0, PAGE_SIZE);
 		if (realblock == BLOCK_UNDEF)
@@ -1158,10 +1470,20 @@ static int mtdswap_readsect(struct mtd_blktrans_dev *dev,
 	BUG_ON(d->revmap[realblock] == PAGE_UNDEF);
 
 	readpos = (loff_t)realblock << PAGE_SHIFT;
+	readlen = PAGE_SIZE;
+	readbuf = buf;
+
+	/* Only the compressed fragment has to be read from a packed block */
+	if (d->revmap[realblock] == PAGE_PACKED) {
+		readpos += frag->offset;
+		readlen = frag->len;
+		readbuf = d->page_buf;
+	}
+
 	retries = 0;
 
 retry:
-	ret = mtd->read(mtd, readpos, PAGE_SIZE, &retlen, buf);
+	ret = mtd->read(mtd, readpos, readlen, &retlen, readbuf);
 
 	d->mtd_read_count++;
 	if (mtd_is_bitflip(ret)) {
@@ -1181,11 +1503,14 @@ retry:
 		return ret;
 	}
 
-	if (retlen != PAGE_SIZE) {
+	if (retlen != readlen) {
 		dev_err(d->dev, "Short read %zd\n", retlen);
 		return -EIO;
 	}
 
+	if (readbuf != buf)
+		return mtdswap_decompress(d, readbuf, readlen, buf);
+
 	return 0;
 }
 
@@ -1194,22 +1519,12 @@ static int mtdswap_discard(struct mtd_blktrans_dev *dev, unsigned long first,
 {
 	struct mtdswap_dev *d = MTDSWAP_MBD_TO_MTDSWAP(dev);
 	unsigned long page;
-	struct swap_eb *eb;
-	unsigned int mapped;
 
 	d->discard_count++;
 
 	for (page = first; page < first + nr_pages; page++) {
-		mapped = d->page_data[page];
-		if (mapped <= BLOCK_MAX) {
-			eb = d->eb_data + (mapped / d->pages_per_eblk);
-			eb->active_count--;
-			mtdswap_store_eb(d, eb);
-			d->page_data[page] = BLOCK_UNDEF;
-			d->revmap[mapped] = PAGE_UNDEF;
-			d->discard_page_count++;
-		} else if (mapped == BLOCK_ERROR) {
-			d->page_data[page] = BLOCK_UNDEF;
+		if (d->page_data[page] != BLOCK_UNDEF) {
+			mtdswap_unmap_page(d, page);
 			d->discard_page_count++;
 		}
 	}
@@ -1225,7 +1540,8 @@ static int mtdswap_show(struct seq_file *s, void *data)
 	unsigned int min[MTDSWAP_TREE_CNT];
 	unsigned int max[MTDSWAP_TREE_CNT];
 	unsigned int i, cw = 0, cwp = 0, cwecount = 0, bb_cnt, mapped, pages;
-	uint64_t use_size;
+	unsigned int blocks, used;
+	uint64_t use_size, ratio, wamp;
 	char *name[] = {"clean", "used", "low", "high", "dirty", "bitflip",
 			"failing"};
 
@@ -1263,6 +1579,12 @@ static int mtdswap_show(struct seq_file *s, void *data)
 		if (d->page_data[i] != BLOCK_UNDEF)
 			mapped++;
 
+	used = 0;
+	blocks = d->eblks * d->pages_per_eblk;
+	for (i = 0; i < blocks; i++)
+		if (d->revmap[i] != PAGE_UNDEF)
+			used++;
+
 	mutex_unlock(&d->mbd_dev->lock);
 
 	for (i = 0; i < MTDSWAP_TREE_CNT; i++) {
@@ -1300,6 +1622,32 @@ static int mtdswap_show(struct seq_file *s, void *data)
 	seq_printf(s, "\n");
 	seq_printf(s, "total pages: %u\n", pages);
 	seq_printf(s, "pages mapped: %u\n", mapped);
+	seq_printf(s, "blocks used: %u\n", used);
+
+	/* Ratios are printed with two decimals */
+	wamp = d->sect_write_count ?
+		div64_u64(d->block_write_count * 100, d->sect_write_count) : 0;
+
+	seq_printf(s, "\n");
+	seq_printf(s, "flash block writes: %llu (%llu by gc)\n",
+		d->block_write_count, d->gc_write_count);
+	seq_printf(s, "write amplification: %llu.%02llu\n",
+		wamp / 100, wamp % 100);
+
+	if (!d->compress)
+		return 0;
+
+	ratio = d->packed_bytes ? div64_u64(d->packed_page_count *
+				PAGE_SIZE * 100, d->packed_bytes) : 0;
+
+	seq_printf(s, "compressed pages: %llu\n", d->packed_page_count);
+	seq_printf(s, "incompressible pages: %llu\n", d->raw_page_count);
+	seq_printf(s, "compression ratio: %llu.%02llu\n",
+		ratio / 100, ratio % 100);
+
+	ratio = used ? div64_u64((uint64_t)mapped * 100, used) : 0;
+	seq_printf(s, "pages per flash block: %llu.%02llu\n",
+		ratio / 100, ratio % 100);
 
 	return 0;
 }
@@ -1347,6 +1695,42 @@ static int mtdswap_add_debugfs(struct mtdswap_dev *d)
 	return 0;
 }
 
+static int mtdswap_init_pack(struct mtdswap_pack *pack, unsigned int marker)
+{
+	pack->buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!pack->buf)
+		return -ENOMEM;
+
+	memset(pack->buf, 0xff, PAGE_SIZE);
+	pack->pos = 0;
+	pack->marker = marker;
+
+	return 0;
+}
+
+static int mtdswap_init_compress(struct mtdswap_dev *d, unsigned int pages,
+				unsigned int blocks)
+{
+	d->frags = vmalloc(sizeof(struct mtdswap_frag) * pages);
+	d->live_frags = vzalloc(sizeof(u16) * blocks);
+	d->lzo_wrkmem = vmalloc(LZO1X_1_MEM_COMPRESS);
+	d->lzo_buf = kmalloc(lzo1x_worst_compress(PAGE_SIZE), GFP_KERNEL);
+
+	if (!d->frags || !d->live_frags || !d->lzo_wrkmem || !d->lzo_buf ||
+	    mtdswap_init_pack(&d->pack, BLOCK_PENDING) < 0 ||
+	    mtdswap_init_pack(&d->gc_pack, BLOCK_GC_PENDING) < 0) {
+		vfree(d->frags);
+		vfree(d->live_frags);
+		vfree(d->lzo_wrkmem);
+		kfree(d->lzo_buf);
+		kfree(d->pack.buf);
+		kfree(d->gc_pack.buf);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 static int mtdswap_init(struct mtdswap_dev *d, unsigned int eblocks,
 			unsigned int spare_cnt)
 {
@@ -1392,10 +1776,18 @@ static int mtdswap_init(struct mtdswap_dev *d, unsigned int eblocks,
 	if (!d->oob_buf)
 		goto oob_buf_fail;
 
+	if (d->compress) {
+		ret = mtdswap_init_compress(d, pages, blocks);
+		if (ret < 0)
+			goto compress_fail;
+	}
+
 	mtdswap_scan_eblks(d);
 
 	return 0;
 
+compress_fail:
+	kfree(d->oob_buf);
 oob_buf_fail:
 	kfree(d->page_buf);
 page_buf_fail:
@@ -1494,8 +1886,21 @@ static void mtdswap_add_mtd(struct mtd_blktrans_ops *tr, struct mtd_info *mtd)
 	if (spare_cnt > eavailable - 1)
 		spare_cnt = eavailable - 1;
 
-	swap_size = (uint64_t)(eavailable - spare_cnt) * mtd->erasesize +
-		(header ? PAGE_SIZE : 0);
+	swap_size = (uint64_t)(eavailable - spare_cnt) * mtd->erasesize;
+
+	/*
+	 * Compressed pages take less room, so more swap than flash can be
+	 * offered. If the data turns out to compress worse than assumed,
+	 * writes fail with -ENOSPC once the flash is full.
+	 */
+	if (compress && overcommit > 100) {
+		if (overcommit > 400)
+			overcommit = 400;
+		swap_size = div_u64(swap_size * overcommit, 100);
+		swap_size &= ~((uint64_t)PAGE_SIZE - 1);
+	}
+
+	swap_size += header ? PAGE_SIZE : 0;
 
 	printk(KERN_INFO "%s: Enabling MTD swap on device %lu, size %llu KB, "
 		"%u spare, %u bad blocks\n",
@@ -1512,6 +1917,7 @@ static void mtdswap_add_mtd(struct mtd_blktrans_ops *tr, struct mtd_info *mtd)
 	}
 
 	d->mbd_dev = mbd_dev;
+	d->compress = compress;
 	mbd_dev->priv = d;
 
 	mbd_dev->mtd = mtd;
@@ -42,6 +42,9 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/pagemap.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
 
 /* Default simulator parameters values */
 #if !defined(CONFIG_NANDSIM_FIRST_ID_BYTE)  || \
@@ -110,6 +113,11 @@ static unsigned int overridesize = 0;
 static char *cache_file = NULL;
 static unsigned int bbt;
 static unsigned int bch;
+static unsigned int bus_bw;
+static unsigned int endurance;
+static unsigned int wear_bitflips = 1;
+static unsigned int seed;
+static unsigned int trace_size;
 
 module_param(first_id_byte,  uint, 0400);
 module_param(second_id_byte, uint, 0400);
@@ -135,6 +143,11 @@ module_param(overridesize,   uint, 0400);
 module_param(cache_file,     charp, 0400);
 module_param(bbt,	     uint, 0400);
 module_param(bch,	     uint, 0400);
+module_param(bus_bw,	     uint, 0400);
+module_param(endurance,	     uint, 0400);
+module_param(wear_bitflips,  uint, 0400);
+module_param(seed,	     uint, 0400);
+module_param(trace_size,     uint, 0400);
 
 MODULE_PARM_DESC(first_id_byte,  "The first byte returned by NAND Flash 'read ID' command (manufacturer ID)");
 MODULE_PARM_DESC(second_id_byte, "The second byte returned by NAND Flash 'read ID' command (chip ID)");
@@ -146,7 +159,7 @@ MODULE_PARM_DESC(erase_delay,    "Sector erase delay (milliseconds)");
 MODULE_PARM_DESC(output_cycle,   "Word output (from flash) time (nanoseconds)");
 MODULE_PARM_DESC(input_cycle,    "Word input (to flash) time (nanoseconds)");
 MODULE_PARM_DESC(bus_width,      "Chip's bus width (8- or 16-bit)");
-MODULE_PARM_DESC(do_delays,      "Simulate NAND delays using busy-waits if not zero");
+MODULE_PARM_DESC(do_delays,      "Simulate NAND delays: 0 - none, 1 - busy-wait, 2 - sleep");
 MODULE_PARM_DESC(log,            "Perform logging if not zero");
 MODULE_PARM_DESC(dbg,            "Output debug information if not zero");
 MODULE_PARM_DESC(parts,          "Partition sizes (in erase blocks) separated by commas");
@@ -170,6 +183,13 @@ MODULE_PARM_DESC(cache_file,     "File to use to cache nand pages instead of mem
 MODULE_PARM_DESC(bbt,		 "0 OOB, 1 BBT with marker in OOB, 2 BBT with marker in data area");
 MODULE_PARM_DESC(bch,		 "Enable BCH ecc and set how many bits should "
 				 "be correctable in 512-byte blocks");
+MODULE_PARM_DESC(bus_bw,	 "Limit the bus transfer rate (KiB/s), zero for no limit");
+MODULE_PARM_DESC(endurance,	 "Rated erase cycles; if not zero, bit flips are injected"
+				 " at a rate growing with the erase count of the block");
+MODULE_PARM_DESC(wear_bitflips,  "Average bit flips per page read at the rated endurance"
+				 " (1 by default)");
+MODULE_PARM_DESC(seed,		 "Seed for reproducible bit flips and read errors, zero for random");
+MODULE_PARM_DESC(trace_size,	 "Number of recent operations kept in debugfs 'trace', zero to disable");
 
 /* The largest possible page size */
 #define NS_LARGEST_PAGE_SIZE	4096
@@ -189,12 +209,6 @@ MODULE_PARM_DESC(bch,		 "Enable BCH ecc and set how many bits should "
 #define NS_INFO(args...) \
 	do { printk(KERN_INFO NS_OUTPUT_PREFIX " " args); } while(0)
 
-/* Busy-wait delay macros (microseconds, milliseconds) */
-#define NS_UDELAY(us) \
-        do { if (do_delays) udelay(us); } while(0)
-#define NS_MDELAY(us) \
-        do { if (do_delays) mdelay(us); } while(0)
-
 /* Is the nandsim structure initialized ? */
 #define NS_IS_INITIALIZED(ns) ((ns)->geom.totsz != 0)
 
@@ -366,6 +380,46 @@ struct nandsim {
 	void *file_buf;
 	struct page *held_pages[NS_MAX_HELD_PAGES];
 	int held_cnt;
+
+	/* Bit flips injected by the last page read */
+	unsigned int flips;
+
+	/* A panic write is in progress, never sleep */
+	int in_panic;
+
+	/* Operation statistics, times are simulated microseconds */
+	struct {
+		unsigned long long reads, progs, erases;
+		unsigned long long bytes_read, bytes_written;
+		unsigned long long read_us, prog_us, erase_us;
+		unsigned long long bitflips, wear_bitflips;
+	} stats;
+
+	/* Ring of the last trace_size operations */
+	struct ns_trace_entry *trace;
+	unsigned int trace_head;
+	unsigned int trace_cnt;
+	spinlock_t trace_lock;
+
+	struct dentry *dbg_dir;
+};
+
+/*
+ * Operation trace record.
+ */
+struct ns_trace_entry {
+	u64 time;	/* local_clock() at completion, ns */
+	uint32_t row;	/* page, or erase block for erases */
+	uint32_t us;	/* simulated busy time */
+	uint16_t bytes;	/* bytes transferred */
+	uint8_t op;
+	uint8_t flips;
+};
+
+enum {
+	NS_OP_READ,
+	NS_OP_PROG,
+	NS_OP_ERASE,
 };
 
 /*
@@ -448,8 +502,20 @@ static unsigned int rptwear_cnt = 0;
 /* MTD structure for NAND controller */
 static struct mtd_info *nsmtd;
 
+/* nand_base's panic_write, wrapped by ns_panic_write() */
+static int (*ns_nand_panic_write)(struct mtd_info *mtd, loff_t to, size_t len,
+				  size_t *retlen, const u_char *buf);
+
 static u_char ns_verify_buf[NS_LARGEST_PAGE_SIZE];
 
+/* Generator used for injected errors when 'seed' is given */
+static struct rnd_state ns_rnd;
+
+static u32 ns_random(void)
+{
+	return seed ? prandom32(&ns_rnd) : random32();
+}
+
 /*
  * Allocate array of page pointers, create slab allocation for an array
  * and initialize the array by NULL pointers.
@@ -694,6 +760,19 @@ static int init_nandsim(struct mtd_info *mtd)
 	}
 	memset(ns->buf.byte, 0xFF, ns->geom.pgszoob);
 
+	if (trace_size) {
+		ns->trace = vzalloc(trace_size * sizeof(struct ns_trace_entry));
+		if (!ns->trace) {
+			NS_ERR("init_nandsim: unable to allocate the trace buffer\n");
+			ret = -ENOMEM;
+			goto error;
+		}
+		spin_lock_init(&ns->trace_lock);
+	}
+
+	if (seed)
+		prandom32_seed(&ns_rnd, seed);
+
 	return 0;
 
 error:
@@ -707,6 +786,7 @@ error:
  */
 static void free_nandsim(struct nandsim *ns)
 {
+	vfree(ns->trace);
 	kfree(ns->buf.byte);
 	free_device(ns);
 
@@ -916,7 +996,7 @@ static int setup_wear_reporting(struct mtd_info *mtd)
 {
 	size_t mem;
 
-	if (!rptwear)
+	if (!rptwear && !endurance)
 		return 0;
 	wear_eb_count = div_u64(mtd->size, mtd->erasesize);
 	mem = wear_eb_count * sizeof(unsigned long);
@@ -946,6 +1026,8 @@ static void update_wear(unsigned int erase_block_no)
 	erase_block_wear[erase_block_no] += 1;
 	if (erase_block_wear[erase_block_no] == 0)
 		NS_ERR("Erase counter overflow for erase block %u\n", erase_block_no);
+	if (!rptwear)
+		return;
 	rptwear_cnt += 1;
 	if (rptwear_cnt < rptwear)
 		return;
@@ -1405,21 +1487,47 @@ int do_read_error(struct nandsim *ns, int num)
 		int i;
 		memset(ns->buf.byte, 0xFF, num);
 		for (i = 0; i < num; ++i)
-			ns->buf.byte[i] = random32();
+			ns->buf.byte[i] = ns_random();
 		NS_WARN("simulating read error in page %u\n", page_no);
 		return 1;
 	}
 	return 0;
 }
 
+/*
+ * Number of bit flips caused by wear. The expected value grows linearly
+ * with the erase count of the block and reaches 'wear_bitflips' at the
+ * rated endurance; the fractional part is applied with the matching
+ * probability.
+ */
+static unsigned int wear_flips(struct nandsim *ns)
+{
+	unsigned int erase_block_no;
+	uint64_t n;
+
+	if (!endurance || !erase_block_wear)
+		return 0;
+
+	erase_block_no = ns->regs.row >> (ns->geom.secshift - ns->geom.pgshift);
+	n = div_u64((uint64_t)erase_block_wear[erase_block_no] *
+		    wear_bitflips * 1024, endurance);
+
+	return (n >> 10) + ((ns_random() & 1023) < (n & 1023));
+}
+
 void do_bit_flips(struct nandsim *ns, int num)
 {
-	if (bitflips && random32() < (1 << 22)) {
+	unsigned int worn;
+
+	ns->flips = 0;
+
+	if (bitflips && ns_random() < (1 << 22)) {
 		int flips = 1;
 		if (bitflips > 1)
-			flips = (random32() % (int) bitflips) + 1;
+			flips = (ns_random() % (int) bitflips) + 1;
+		ns->flips += flips;
 		while (flips--) {
-			int pos = random32() % (num * 8);
+			int pos = ns_random() % (num * 8);
 			ns->buf.byte[pos / 8] ^= (1 << (pos % 8));
 			NS_WARN("read_page: flipping bit %d in page %d "
 				"reading from %d ecc: corrected=%u failed=%u\n",
@@ -1427,6 +1535,17 @@ void do_bit_flips(struct nandsim *ns, int num)
 				nsmtd->ecc_stats.corrected, nsmtd->ecc_stats.failed);
 		}
 	}
+
+	worn = wear_flips(ns);
+	ns->flips += worn;
+	ns->stats.wear_bitflips += worn;
+	ns->stats.bitflips += ns->flips;
+	while (worn--) {
+		int pos = ns_random() % (num * 8);
+		ns->buf.byte[pos / 8] ^= (1 << (pos % 8));
+		NS_DBG("read_page: wear flips bit %d in page %d\n",
+			pos, ns->regs.row);
+	}
 }
 
 /*
@@ -1575,6 +1694,72 @@ static int prog_page(struct nandsim *ns, int num)
 	return 0;
 }
 
+/*
+ * Time to move 'num' bytes over the bus, in microseconds. 'cycle' is the
+ * word cycle time in nanoseconds; 'bus_bw' caps the overall rate.
+ */
+static unsigned long xfer_time(struct nandsim *ns, uint cycle, int num)
+{
+	int busdiv = ns->busw == 8 ? 1 : 2;
+	unsigned long us, bw_us;
+
+	us = cycle * num / 1000 / busdiv;
+	if (bus_bw) {
+		bw_us = div64_u64((uint64_t)num * 1000000,
+				  (uint64_t)bus_bw * 1024);
+		us = max(us, bw_us);
+	}
+
+	return us;
+}
+
+/*
+ * Simulate the chip being busy for 'us' microseconds. nand_base calls us
+ * in process context without spinlocks held, except for panic writes
+ * (mtdoops), which are flagged by ns_panic_write(). in_atomic() cannot
+ * be used to tell them apart as it does not see spinlocks on !PREEMPT.
+ */
+static void ns_delay(struct nandsim *ns, unsigned long us)
+{
+	if (!do_delays || !us)
+		return;
+
+	if (do_delays == 2 && !ns->in_panic && !oops_in_progress) {
+		if (us < 20000)
+			usleep_range(us, us + us / 8 + 1);
+		else
+			msleep(DIV_ROUND_UP(us, 1000));
+		return;
+	}
+
+	if (us >= 1000)
+		mdelay(us / 1000);
+	udelay(us % 1000);
+}
+
+static void trace_op(struct nandsim *ns, int op, uint32_t row, int bytes,
+		     unsigned long us)
+{
+	struct ns_trace_entry *te;
+
+	if (!ns->trace)
+		return;
+
+	spin_lock(&ns->trace_lock);
+	te = &ns->trace[ns->trace_head];
+	te->time = local_clock();
+	te->row = row;
+	te->us = us;
+	te->bytes = bytes;
+	te->op = op;
+	te->flips = min(ns->flips, 255U);
+	if (++ns->trace_head == trace_size)
+		ns->trace_head = 0;
+	if (ns->trace_cnt < trace_size)
+		ns->trace_cnt += 1;
+	spin_unlock(&ns->trace_lock);
+}
+
 /*
  * If state has any action bit, perform this action.
  *
@@ -1583,8 +1768,8 @@ static int prog_page(struct nandsim *ns, int num)
 static int do_state_action(struct nandsim *ns, uint32_t action)
 {
 	int num;
-	int busdiv = ns->busw == 8 ? 1 : 2;
 	unsigned int erase_block_no, page_no;
+	unsigned long us;
 
 	action &= ACTION_MASK;
 
@@ -1607,6 +1792,7 @@ static int do_state_action(struct nandsim *ns, uint32_t action)
 			break;
 		}
 		num = ns->geom.pgszoob - ns->regs.off - ns->regs.column;
+		ns->flips = 0;
 		read_page(ns, num);
 
 		NS_DBG("do_state_action: (ACTION_CPY:) copy %d bytes to int buf, raw offset %d\n",
@@ -1619,8 +1805,13 @@ static int do_state_action(struct nandsim *ns, uint32_t action)
 		else
 			NS_LOG("read OOB of page %d\n", ns->regs.row);
 
-		NS_UDELAY(access_delay);
-		NS_UDELAY(input_cycle * ns->geom.pgsz / 1000 / busdiv);
+		us = access_delay + xfer_time(ns, output_cycle, num);
+		ns_delay(ns, us);
+
+		ns->stats.reads += 1;
+		ns->stats.bytes_read += num;
+		ns->stats.read_us += us;
+		trace_op(ns, NS_OP_READ, ns->regs.row, num, us);
 
 		break;
 
@@ -1652,7 +1843,13 @@ static int do_state_action(struct nandsim *ns, uint32_t action)
 
 		erase_sector(ns);
 
-		NS_MDELAY(erase_delay);
+		us = erase_delay * 1000;
+		ns_delay(ns, us);
+
+		ns->stats.erases += 1;
+		ns->stats.erase_us += us;
+		ns->flips = 0;
+		trace_op(ns, NS_OP_ERASE, erase_block_no, 0, us);
 
 		if (erase_block_wear)
 			update_wear(erase_block_no);
@@ -1690,8 +1887,14 @@ static int do_state_action(struct nandsim *ns, uint32_t action)
 			num, ns->regs.row, ns->regs.column, NS_RAW_OFFSET(ns) + ns->regs.off);
 		NS_LOG("programm page %d\n", ns->regs.row);
 
-		NS_UDELAY(programm_delay);
-		NS_UDELAY(output_cycle * ns->geom.pgsz / 1000 / busdiv);
+		us = programm_delay + xfer_time(ns, input_cycle, num);
+		ns_delay(ns, us);
+
+		ns->stats.progs += 1;
+		ns->stats.bytes_written += num;
+		ns->stats.prog_us += us;
+		ns->flips = 0;
+		trace_op(ns, NS_OP_PROG, page_no, num, us);
 
 		if (write_error(page_no)) {
 			NS_WARN("simulating write failure in page %u\n", page_no);
@@ -2224,6 +2427,146 @@ static int ns_nand_verify_buf(struct mtd_info *mtd, const u_char *buf, int len)
 	}
 }
 
+static int ns_stats_show(struct seq_file *m, void *private)
+{
+	struct nandsim *ns = m->private;
+
+	seq_printf(m, "reads:            %llu\n", ns->stats.reads);
+	seq_printf(m, "programs:         %llu\n", ns->stats.progs);
+	seq_printf(m, "erases:           %llu\n", ns->stats.erases);
+	seq_printf(m, "bytes read:       %llu\n", ns->stats.bytes_read);
+	seq_printf(m, "bytes written:    %llu\n", ns->stats.bytes_written);
+	seq_printf(m, "read time us:     %llu\n", ns->stats.read_us);
+	seq_printf(m, "program time us:  %llu\n", ns->stats.prog_us);
+	seq_printf(m, "erase time us:    %llu\n", ns->stats.erase_us);
+	seq_printf(m, "bit flips:        %llu\n", ns->stats.bitflips);
+	seq_printf(m, "wear bit flips:   %llu\n", ns->stats.wear_bitflips);
+	seq_printf(m, "ecc corrected:    %u\n", nsmtd->ecc_stats.corrected);
+	seq_printf(m, "ecc failed:       %u\n", nsmtd->ecc_stats.failed);
+
+	return 0;
+}
+
+static int ns_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ns_stats_show, inode->i_private);
+}
+
+static const struct file_operations ns_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ns_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * One line per operation, oldest first:
+ * <time ns> <op> <page or erase block> <bytes> <busy us> <bit flips>
+ *
+ * The trace lock is held from start to stop so that the ring does not
+ * move under the reader.
+ */
+static void *ns_trace_start(struct seq_file *m, loff_t *pos)
+{
+	struct nandsim *ns = m->private;
+
+	spin_lock(&ns->trace_lock);
+	if (*pos >= ns->trace_cnt)
+		return NULL;
+
+	return &ns->trace[(ns->trace_head + trace_size - ns->trace_cnt +
+			   *pos) % trace_size];
+}
+
+static void *ns_trace_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	struct nandsim *ns = m->private;
+
+	*pos += 1;
+	if (*pos >= ns->trace_cnt)
+		return NULL;
+
+	return &ns->trace[(ns->trace_head + trace_size - ns->trace_cnt +
+			   *pos) % trace_size];
+}
+
+static void ns_trace_stop(struct seq_file *m, void *v)
+{
+	struct nandsim *ns = m->private;
+
+	spin_unlock(&ns->trace_lock);
+}
+
+static int ns_trace_show(struct seq_file *m, void *v)
+{
+	static const char * const op_names[] = { "read", "prog", "erase" };
+	struct ns_trace_entry *te = v;
+
+	seq_printf(m, "%llu %s %u %u %u %u\n", te->time, op_names[te->op],
+		   te->row, te->bytes, te->us, te->flips);
+
+	return 0;
+}
+
+static const struct seq_operations ns_trace_sops = {
+	.start	= ns_trace_start,
+	.next	= ns_trace_next,
+	.stop	= ns_trace_stop,
+	.show	= ns_trace_show,
+};
+
+static int ns_trace_open(struct inode *inode, struct file *file)
+{
+	int err;
+
+	err = seq_open(file, &ns_trace_sops);
+	if (!err)
+		((struct seq_file *)file->private_data)->private =
+			inode->i_private;
+
+	return err;
+}
+
+static const struct file_operations ns_trace_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ns_trace_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+/*
+ * The debugfs files are only a convenience, failing to create them is
+ * not fatal.
+ */
+static void ns_debugfs_create(struct nandsim *ns)
+{
+	ns->dbg_dir = debugfs_create_dir("nandsim", NULL);
+	if (IS_ERR_OR_NULL(ns->dbg_dir)) {
+		ns->dbg_dir = NULL;
+		return;
+	}
+
+	debugfs_create_file("stats", S_IRUSR, ns->dbg_dir, ns, &ns_stats_fops);
+	if (ns->trace)
+		debugfs_create_file("trace", S_IRUSR, ns->dbg_dir, ns,
+				    &ns_trace_fops);
+}
+
+/*
+ * mtdoops calls panic_write from atomic context. Mark the chip so that
+ * ns_delay() busy-waits from now on; the system is going down anyway.
+ */
+static int ns_panic_write(struct mtd_info *mtd, loff_t to, size_t len,
+			  size_t *retlen, const u_char *buf)
+{
+	struct nandsim *ns = ((struct nand_chip *)mtd->priv)->priv;
+
+	ns->in_panic = 1;
+	return ns_nand_panic_write(mtd, to, len, retlen, buf);
+}
+
 /*
  * Module initialization function
  */
@@ -2351,6 +2694,9 @@ static int __init ns_init_module(void)
 		goto error;
 	}
 
+	ns_nand_panic_write = nsmtd->panic_write;
+	nsmtd->panic_write = ns_panic_write;
+
 	if (overridesize) {
 		uint64_t new_size = (uint64_t)nsmtd->erasesize << overridesize;
 		if (new_size >> overridesize != nsmtd->erasesize) {
@@ -2383,6 +2729,8 @@ static int __init ns_init_module(void)
 	if (retval != 0)
 		goto err_exit;
 
+	ns_debugfs_create(nand);
+
         return 0;
 
 err_exit:
@@ -2407,6 +2755,7 @@ static void __exit ns_cleanup_module(void)
 	struct nandsim *ns = ((struct nand_chip *)nsmtd->priv)->priv;
 	int i;
 
+	debugfs_remove_recursive(ns->dbg_dir);
 	free_nandsim(ns);    /* Free nandsim private resources */
 	nand_release(nsmtd); /* Unregister driver */
 	for (i = 0;i < ARRAY_SIZE(ns->partitions); ++i)
@@ -0,0 +1,738 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file COPYING. If not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * Benchmark the flash stack layer by layer: raw MTD, an UBI volume and a
+ * file-system (normally UBIFS) directory on top of it. Every test prints
+ * one "result" line of key=value pairs, see Documentation/mtd/mtd_benchtest.txt.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/err.h>
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/ubi.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/sort.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/namei.h>
+#include <linux/mount.h>
+#include <linux/uaccess.h>
+
+#define PRINT_PREF KERN_INFO "mtd_benchtest: "
+
+/* Latency samples kept per test, more operations are reservoir-sampled */
+#define MAX_SAMPLES	65536
+
+#define FS_IO_SIZE	4096
+#define FS_META_SIZE	512
+#define FS_DATA_FILE	"mtd_benchtest.dat"
+
+/* Must hold an eraseblock or LEB */
+#define IOBUF_SIZE	(1024 * 1024)
+
+static int dev = -1;
+module_param(dev, int, S_IRUGO);
+MODULE_PARM_DESC(dev, "MTD device number to benchmark (-1 to skip, "
+		      "the device is erased)");
+
+static int ubi = -1;
+module_param(ubi, int, S_IRUGO);
+MODULE_PARM_DESC(ubi, "UBI device number (-1 to skip UBI tests)");
+
+static int vol = -1;
+module_param(vol, int, S_IRUGO);
+MODULE_PARM_DESC(vol, "Dynamic UBI volume ID to benchmark (-1 to skip, its "
+		      "contents are destroyed)");
+
+static char *fs_dir;
+module_param(fs_dir, charp, S_IRUGO);
+MODULE_PARM_DESC(fs_dir, "Directory on a mounted file-system to benchmark, "
+			 "normally UBIFS on UBI device 'ubi'");
+
+static int count;
+module_param(count, int, S_IRUGO);
+MODULE_PARM_DESC(count, "Maximum number of eraseblocks or LEBs to use "
+			"(0 means use all)");
+
+static int ops = 1000;
+module_param(ops, int, S_IRUGO);
+MODULE_PARM_DESC(ops, "Number of operations in random and metadata tests");
+
+static int fs_size = 4096;
+module_param(fs_size, int, S_IRUGO);
+MODULE_PARM_DESC(fs_size, "Size of the file-system test file in KiB");
+
+static int seed = 1;
+module_param(seed, int, S_IRUGO);
+MODULE_PARM_DESC(seed, "Seed for the random offsets and data");
+
+struct bench {
+	const char *layer;
+	const char *test;
+	u32 *lat;		/* latency samples, microseconds */
+	unsigned int nlat;
+	unsigned long long ops;
+	unsigned long long bytes;
+	u32 lat_max;
+	ktime_t start;
+	ktime_t op_start;
+	u64 cpu_start;
+	long long flash_start;	/* UBI bytes written, -1 if not tracked */
+};
+
+static u32 *samples;
+static unsigned char *iobuf;
+static unsigned long next = 1;
+
+static inline unsigned int simple_rand(void)
+{
+	next = next * 1103515245 + 12345;
+	return (unsigned int)((next / 65536) % 32768);
+}
+
+static inline unsigned int big_rand(void)
+{
+	return (simple_rand() << 15) | simple_rand();
+}
+
+static inline void simple_srand(unsigned long seed)
+{
+	next = seed;
+}
+
+static void set_random_data(unsigned char *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		buf[i] = simple_rand();
+}
+
+static long long ubi_flash_written(void)
+{
+#if IS_ENABLED(CONFIG_MTD_UBI)
+	struct ubi_device_info di;
+
+	if (ubi >= 0 && !ubi_get_device_info(ubi, &di))
+		return di.bytes_written;
+#endif
+	return -1;
+}
+
+static void bench_start(struct bench *b, const char *layer, const char *test,
+			int track_flash)
+{
+	memset(b, 0, sizeof(*b));
+	b->layer = layer;
+	b->test = test;
+	b->lat = samples;
+	b->flash_start = track_flash ? ubi_flash_written() : -1;
+	b->cpu_start = current->se.sum_exec_runtime;
+	b->start = ktime_get();
+}
+
+static inline void op_start(struct bench *b)
+{
+	b->op_start = ktime_get();
+}
+
+static void op_end(struct bench *b, size_t bytes)
+{
+	u32 us = ktime_to_us(ktime_sub(ktime_get(), b->op_start));
+	u32 j;
+
+	if (b->nlat < MAX_SAMPLES)
+		b->lat[b->nlat++] = us;
+	else {
+		j = big_rand() % (u32)min_t(u64, b->ops + 1, 1 << 30);
+		if (j < MAX_SAMPLES)
+			b->lat[j] = us;
+	}
+
+	if (us > b->lat_max)
+		b->lat_max = us;
+	b->ops += 1;
+	b->bytes += bytes;
+	cond_resched();
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u32 percentile(struct bench *b, unsigned int pct)
+{
+	if (!b->nlat)
+		return 0;
+	return b->lat[(b->nlat - 1) * pct / 100];
+}
+
+/*
+ * Print the result line. Write amplification is the number of bytes UBI
+ * wrote to the flash per byte written by the test, in hundredths.
+ */
+static void bench_end(struct bench *b)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), b->start));
+	u64 cpu = current->se.sum_exec_runtime - b->cpu_start;
+	u64 us = div_u64(ns, 1000), kib_s = 0, wa = 0;
+	long long flash;
+
+	if (us)
+		kib_s = div64_u64(b->bytes * 1000000, us * 1024);
+
+	if (b->flash_start >= 0 && b->bytes) {
+		flash = ubi_flash_written() - b->flash_start;
+		if (flash > 0)
+			wa = div64_u64((u64)flash * 100, b->bytes);
+	}
+
+	sort(b->lat, b->nlat, sizeof(u32), cmp_u32, NULL);
+
+	printk(PRINT_PREF "result layer=%s test=%s ops=%llu bytes=%llu "
+	       "time_us=%llu kib_s=%llu lat_p50_us=%u lat_p90_us=%u "
+	       "lat_p99_us=%u lat_max_us=%u cpu_us=%llu wa=%llu.%02llu\n",
+	       b->layer, b->test, b->ops, b->bytes, us, kib_s,
+	       percentile(b, 50), percentile(b, 90), percentile(b, 99),
+	       b->lat_max, div_u64(cpu, 1000), div_u64(wa, 100),
+	       wa - div_u64(wa, 100) * 100);
+}
+
+/*
+ * Raw MTD tests.
+ */
+static int mtd_erase_eb(struct mtd_info *mtd, int ebnum)
+{
+	struct erase_info ei;
+	int err;
+
+	memset(&ei, 0, sizeof(struct erase_info));
+	ei.mtd  = mtd;
+	ei.addr = (loff_t)ebnum * mtd->erasesize;
+	ei.len  = mtd->erasesize;
+
+	err = mtd->erase(mtd, &ei);
+	if (err) {
+		printk(PRINT_PREF "error %d while erasing EB %d\n", err, ebnum);
+		return err;
+	}
+
+	if (ei.state == MTD_ERASE_FAILED) {
+		printk(PRINT_PREF "some erase error occurred at EB %d\n",
+		       ebnum);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int mtd_bench(void)
+{
+	struct mtd_info *mtd;
+	struct bench b;
+	unsigned char *bbt = NULL;
+	int err, i, j, ebcnt, pgsize, pgcnt, good = 0;
+	size_t retlen;
+	loff_t addr;
+	uint64_t tmp;
+
+	mtd = get_mtd_device(NULL, dev);
+	if (IS_ERR(mtd)) {
+		printk(PRINT_PREF "error: cannot get MTD device %d\n", dev);
+		return PTR_ERR(mtd);
+	}
+
+	pgsize = mtd->writesize == 1 ? 512 : mtd->writesize;
+	pgcnt = mtd->erasesize / pgsize;
+	tmp = mtd->size;
+	do_div(tmp, mtd->erasesize);
+	ebcnt = tmp;
+	if (count > 0 && count < ebcnt)
+		ebcnt = count;
+
+	err = -EINVAL;
+	if (mtd->erasesize > IOBUF_SIZE) {
+		printk(PRINT_PREF "error: eraseblock too large\n");
+		goto out;
+	}
+
+	err = -ENOMEM;
+	bbt = kzalloc(ebcnt, GFP_KERNEL);
+	if (!bbt)
+		goto out;
+
+	for (i = 0; i < ebcnt; i++) {
+		if (mtd->block_isbad)
+			bbt[i] = mtd->block_isbad(mtd,
+					(loff_t)i * mtd->erasesize) ? 1 : 0;
+		good += !bbt[i];
+	}
+
+	err = -ENODEV;
+	if (!good)
+		goto out;
+
+	bench_start(&b, "mtd", "erase", 0);
+	for (i = 0; i < ebcnt; i++) {
+		if (bbt[i])
+			continue;
+		op_start(&b);
+		err = mtd_erase_eb(mtd, i);
+		if (err)
+			goto out;
+		op_end(&b, mtd->erasesize);
+	}
+	bench_end(&b);
+
+	bench_start(&b, "mtd", "seq_write", 0);
+	for (i = 0; i < ebcnt; i++) {
+		if (bbt[i])
+			continue;
+		for (j = 0; j < pgcnt; j++) {
+			addr = (loff_t)i * mtd->erasesize + j * pgsize;
+			op_start(&b);
+			err = mtd->write(mtd, addr, pgsize, &retlen,
+					 iobuf + j * pgsize);
+			if (!err && retlen != pgsize)
+				err = -EIO;
+			if (err) {
+				printk(PRINT_PREF "error %d writing %#llx\n",
+				       err, (long long)addr);
+				goto out;
+			}
+			op_end(&b, pgsize);
+		}
+	}
+	bench_end(&b);
+
+	bench_start(&b, "mtd", "seq_read", 0);
+	for (i = 0; i < ebcnt; i++) {
+		if (bbt[i])
+			continue;
+		for (j = 0; j < pgcnt; j++) {
+			addr = (loff_t)i * mtd->erasesize + j * pgsize;
+			op_start(&b);
+			err = mtd->read(mtd, addr, pgsize, &retlen, iobuf);
+			if (mtd_is_bitflip(err))
+				err = 0;
+			if (err) {
+				printk(PRINT_PREF "error %d reading %#llx\n",
+				       err, (long long)addr);
+				goto out;
+			}
+			op_end(&b, pgsize);
+		}
+	}
+	bench_end(&b);
+
+	bench_start(&b, "mtd", "rand_read", 0);
+	for (i = 0; i < ops; i++) {
+		j = big_rand() % ebcnt;
+		if (bbt[j])
+			continue;
+		addr = (loff_t)j * mtd->erasesize +
+		       (big_rand() % pgcnt) * pgsize;
+		op_start(&b);
+		err = mtd->read(mtd, addr, pgsize, &retlen, iobuf);
+		if (mtd_is_bitflip(err))
+			err = 0;
+		if (err) {
+			printk(PRINT_PREF "error %d reading %#llx\n",
+			       err, (long long)addr);
+			goto out;
+		}
+		op_end(&b, pgsize);
+	}
+	bench_end(&b);
+
+	err = 0;
+out:
+	kfree(bbt);
+	put_mtd_device(mtd);
+	return err;
+}
+
+/*
+ * UBI volume tests, through the kernel API.
+ */
+#if IS_ENABLED(CONFIG_MTD_UBI)
+static int ubi_bench(void)
+{
+	struct ubi_volume_desc *desc;
+	struct ubi_volume_info vi;
+	struct ubi_device_info di;
+	struct bench b;
+	int err, i, lnum = 0, offs, lebs, io;
+
+	err = ubi_get_device_info(ubi, &di);
+	if (err)
+		return err;
+
+	desc = ubi_open_volume(ubi, vol, UBI_EXCLUSIVE);
+	if (IS_ERR(desc)) {
+		printk(PRINT_PREF "error: cannot open UBI volume %d:%d\n",
+		       ubi, vol);
+		return PTR_ERR(desc);
+	}
+
+	ubi_get_volume_info(desc, &vi);
+	err = -EINVAL;
+	if (vi.vol_type != UBI_DYNAMIC_VOLUME) {
+		printk(PRINT_PREF "error: volume %d:%d is not dynamic\n",
+		       ubi, vol);
+		goto out;
+	}
+
+	if (vi.usable_leb_size > IOBUF_SIZE) {
+		printk(PRINT_PREF "error: LEB too large\n");
+		goto out;
+	}
+
+	lebs = vi.size;
+	if (count > 0 && count < lebs)
+		lebs = count;
+	io = di.min_io_size;
+
+	for (lnum = 0; lnum < lebs; lnum++) {
+		err = ubi_leb_unmap(desc, lnum);
+		if (err)
+			goto out;
+	}
+	err = ubi_sync(ubi);
+	if (err)
+		goto out;
+
+	bench_start(&b, "ubi", "seq_write", 1);
+	for (lnum = 0; lnum < lebs; lnum++) {
+		op_start(&b);
+		err = ubi_leb_write(desc, lnum, iobuf, 0, vi.usable_leb_size,
+				    UBI_UNKNOWN);
+		if (err)
+			goto out_err;
+		op_end(&b, vi.usable_leb_size);
+	}
+	bench_end(&b);
+
+	bench_start(&b, "ubi", "seq_read", 0);
+	for (lnum = 0; lnum < lebs; lnum++) {
+		op_start(&b);
+		err = ubi_leb_read(desc, lnum, iobuf, 0, vi.usable_leb_size,
+				   0);
+		if (err)
+			goto out_err;
+		op_end(&b, vi.usable_leb_size);
+	}
+	bench_end(&b);
+
+	bench_start(&b, "ubi", "rand_read", 0);
+	for (i = 0; i < ops; i++) {
+		lnum = big_rand() % lebs;
+		offs = (big_rand() % (vi.usable_leb_size / io)) * io;
+		op_start(&b);
+		err = ubi_leb_read(desc, lnum, iobuf, offs, io, 0);
+		if (err)
+			goto out_err;
+		op_end(&b, io);
+	}
+	bench_end(&b);
+
+	/* Small atomic updates, as used for file-system metadata */
+	bench_start(&b, "ubi", "atomic_change", 1);
+	for (i = 0; i < ops; i++) {
+		lnum = big_rand() % lebs;
+		op_start(&b);
+		err = ubi_leb_change(desc, lnum, iobuf, io, UBI_UNKNOWN);
+		if (err)
+			goto out_err;
+		op_end(&b, io);
+	}
+	bench_end(&b);
+
+	err = 0;
+	goto out;
+
+out_err:
+	printk(PRINT_PREF "error %d in UBI %s test, LEB %d\n", err, b.test,
+	       lnum);
+out:
+	ubi_close_volume(desc);
+	return err;
+}
+#else
+static int ubi_bench(void)
+{
+	printk(PRINT_PREF "UBI support is not enabled\n");
+	return -ENODEV;
+}
+#endif
+
+/*
+ * File-system tests, done with the VFS from this module's context.
+ */
+static struct file *fs_open(const char *name, int flags)
+{
+	char *path;
+	struct file *file;
+
+	path = kasprintf(GFP_KERNEL, "%s/%s", fs_dir, name);
+	if (!path)
+		return ERR_PTR(-ENOMEM);
+
+	file = filp_open(path, flags | O_LARGEFILE, 0600);
+	kfree(path);
+
+	return file;
+}
+
+static int fs_unlink(const char *name)
+{
+	struct path dir;
+	struct dentry *dentry;
+	struct inode *inode;
+	int err;
+
+	err = kern_path(fs_dir, LOOKUP_FOLLOW | LOOKUP_DIRECTORY, &dir);
+	if (err)
+		return err;
+
+	err = mnt_want_write(dir.mnt);
+	if (err)
+		goto out_path;
+
+	inode = dir.dentry->d_inode;
+	mutex_lock_nested(&inode->i_mutex, I_MUTEX_PARENT);
+	dentry = lookup_one_len(name, dir.dentry, strlen(name));
+	if (IS_ERR(dentry)) {
+		err = PTR_ERR(dentry);
+	} else {
+		err = dentry->d_inode ? vfs_unlink(inode, dentry) : -ENOENT;
+		dput(dentry);
+	}
+	mutex_unlock(&inode->i_mutex);
+
+	mnt_drop_write(dir.mnt);
+out_path:
+	path_put(&dir);
+	return err;
+}
+
+static ssize_t fs_rw(struct file *file, void *buf, size_t len, loff_t pos,
+		     int write)
+{
+	mm_segment_t old_fs = get_fs();
+	ssize_t ret;
+
+	set_fs(KERNEL_DS);
+	if (write)
+		ret = vfs_write(file, (const char __user *)buf, len, &pos);
+	else
+		ret = vfs_read(file, (char __user *)buf, len, &pos);
+	set_fs(old_fs);
+
+	if (ret >= 0 && ret != len)
+		ret = -EIO;
+	return ret;
+}
+
+static int fs_bench(void)
+{
+	struct file *file;
+	struct bench b;
+	char name[32];
+	loff_t size = (loff_t)fs_size * 1024, pos;
+	unsigned int pages = size / FS_IO_SIZE;
+	int err, i;
+
+	if (!pages)
+		return -EINVAL;
+
+	file = fs_open(FS_DATA_FILE, O_CREAT | O_TRUNC | O_RDWR);
+	if (IS_ERR(file)) {
+		printk(PRINT_PREF "error: cannot create a file in %s\n",
+		       fs_dir);
+		return PTR_ERR(file);
+	}
+
+	/* Time includes the final fsync, latencies are per write() */
+	bench_start(&b, "fs", "seq_write", 1);
+	for (pos = 0; pos < size; pos += FS_IO_SIZE) {
+		op_start(&b);
+		err = fs_rw(file, iobuf, FS_IO_SIZE, pos, 1);
+		if (err < 0)
+			goto out_err;
+		op_end(&b, FS_IO_SIZE);
+	}
+	err = vfs_fsync(file, 0);
+	if (err)
+		goto out_err;
+	bench_end(&b);
+
+	invalidate_mapping_pages(file->f_mapping, 0, -1);
+	bench_start(&b, "fs", "seq_read", 0);
+	for (pos = 0; pos < size; pos += FS_IO_SIZE) {
+		op_start(&b);
+		err = fs_rw(file, iobuf, FS_IO_SIZE, pos, 0);
+		if (err < 0)
+			goto out_err;
+		op_end(&b, FS_IO_SIZE);
+	}
+	bench_end(&b);
+
+	/* Every write is made durable, like a database would do */
+	bench_start(&b, "fs", "rand_write_sync", 1);
+	for (i = 0; i < ops; i++) {
+		pos = (loff_t)(big_rand() % pages) * FS_IO_SIZE;
+		op_start(&b);
+		err = fs_rw(file, iobuf, FS_IO_SIZE, pos, 1);
+		if (err >= 0)
+			err = vfs_fsync(file, 1);
+		if (err < 0)
+			goto out_err;
+		op_end(&b, FS_IO_SIZE);
+	}
+	bench_end(&b);
+
+	invalidate_mapping_pages(file->f_mapping, 0, -1);
+	bench_start(&b, "fs", "rand_read", 0);
+	for (i = 0; i < ops; i++) {
+		pos = (loff_t)(big_rand() % pages) * FS_IO_SIZE;
+		op_start(&b);
+		err = fs_rw(file, iobuf, FS_IO_SIZE, pos, 0);
+		if (err < 0)
+			goto out_err;
+		op_end(&b, FS_IO_SIZE);
+	}
+	bench_end(&b);
+
+	filp_close(file, NULL);
+	file = NULL;
+	err = fs_unlink(FS_DATA_FILE);
+	if (err)
+		goto out_err;
+
+	/* Metadata heavy: create, write a little, fsync and close */
+	bench_start(&b, "fs", "create_sync", 1);
+	for (i = 0; i < ops; i++) {
+		snprintf(name, sizeof(name), "mtd_benchtest.%d", i);
+		op_start(&b);
+		file = fs_open(name, O_CREAT | O_TRUNC | O_WRONLY);
+		if (IS_ERR(file)) {
+			err = PTR_ERR(file);
+			file = NULL;
+			goto out_err;
+		}
+		err = fs_rw(file, iobuf, FS_META_SIZE, 0, 1);
+		if (err >= 0)
+			err = vfs_fsync(file, 0);
+		filp_close(file, NULL);
+		file = NULL;
+		if (err < 0)
+			goto out_err;
+		op_end(&b, FS_META_SIZE);
+	}
+	bench_end(&b);
+
+	bench_start(&b, "fs", "unlink", 1);
+	for (i = 0; i < ops; i++) {
+		snprintf(name, sizeof(name), "mtd_benchtest.%d", i);
+		op_start(&b);
+		err = fs_unlink(name);
+		if (err)
+			goto out_err;
+		op_end(&b, 0);
+	}
+	bench_end(&b);
+
+	return 0;
+
+out_err:
+	printk(PRINT_PREF "error %d in file-system %s test\n", err, b.test);
+	if (file)
+		filp_close(file, NULL);
+	return err;
+}
+
+static int __init mtd_benchtest_init(void)
+{
+	int err = 0;
+
+	printk(KERN_INFO "\n");
+	printk(KERN_INFO "=================================================\n");
+
+	if (dev < 0 && ubi < 0 && !fs_dir) {
+		printk(PRINT_PREF "Please specify dev, ubi and/or fs_dir via "
+		       "module parameters\n");
+		printk(KERN_CRIT "CAREFUL: This test wipes all data on the "
+		       "specified MTD device and UBI volume!\n");
+		return -EINVAL;
+	}
+
+	if (ops <= 0 || fs_size <= 0) {
+		printk(PRINT_PREF "ops and fs_size must be positive\n");
+		return -EINVAL;
+	}
+
+	samples = vmalloc(MAX_SAMPLES * sizeof(u32));
+	iobuf = vmalloc(IOBUF_SIZE);
+	if (!samples || !iobuf) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	simple_srand(seed);
+	set_random_data(iobuf, IOBUF_SIZE);
+
+	if (dev >= 0) {
+		err = mtd_bench();
+		if (err)
+			goto out;
+	}
+
+	if (ubi >= 0 && vol >= 0) {
+		err = ubi_bench();
+		if (err)
+			goto out;
+	}
+
+	if (fs_dir)
+		err = fs_bench();
+
+	if (!err)
+		printk(PRINT_PREF "finished\n");
+out:
+	vfree(iobuf);
+	vfree(samples);
+	if (err)
+		printk(PRINT_PREF "error %d occurred\n", err);
+	printk(KERN_INFO "=================================================\n");
+	return err;
+}
+module_init(mtd_benchtest_init);
+
+static void __exit mtd_benchtest_exit(void)
+{
+	return;
+}
+module_exit(mtd_benchtest_exit);
+
+MODULE_DESCRIPTION("Flash stack benchmark module");
+MODULE_LICENSE("GPL");
@@ -131,6 +131,18 @@ static struct device_attribute dev_bgt_enabled =
 	__ATTR(bgt_enabled, S_IRUGO, dev_attribute_show, NULL);
 static struct device_attribute dev_mtd_num =
 	__ATTR(mtd_num, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_wl_debt =
+	__ATTR(wl_debt, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_wl_copied_bytes =
+	__ATTR(wl_copied_bytes, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_wl_yields =
+	__ATTR(wl_yields, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_wl_throttle_ms =
+	__ATTR(wl_throttle_ms, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_read_latency_us =
+	__ATTR(read_latency_us, S_IRUGO, dev_attribute_show, NULL);
+static struct device_attribute dev_wl_read_latency_us =
+	__ATTR(wl_read_latency_us, S_IRUGO, dev_attribute_show, NULL);
 
 /**
  * ubi_volume_notify - send a volume change notification.
@@ -311,6 +323,16 @@ int ubi_major2num(int major)
 	return ubi_num;
 }
 
+/* Average of @total nanoseconds over @count events, in microseconds */
+static long long avg_us(atomic64_t *total, atomic64_t *count)
+{
+	u64 n = atomic64_read(count);
+
+	if (!n)
+		return 0;
+	return div64_u64(atomic64_read(total), n * NSEC_PER_USEC);
+}
+
 /* "Show" method for files in '/<sysfs>/class/ubi/ubiX/' */
 static ssize_t dev_attribute_show(struct device *dev,
 				  struct device_attribute *attr, char *buf)
@@ -355,6 +377,25 @@ static ssize_t dev_attribute_show(struct device *dev,
 		ret = sprintf(buf, "%d\n", ubi->thread_enabled);
 	else if (attr == &dev_mtd_num)
 		ret = sprintf(buf, "%d\n", ubi->mtd->index);
+	else if (attr == &dev_wl_debt)
+		ret = sprintf(buf, "%d\n", ubi_wl_debt(ubi));
+	else if (attr == &dev_wl_copied_bytes)
+		ret = sprintf(buf, "%lld\n",
+			      (long long)atomic64_read(&ubi->wl_stats.copy_bytes));
+	else if (attr == &dev_wl_yields)
+		ret = sprintf(buf, "%lld\n",
+			      (long long)atomic64_read(&ubi->wl_stats.yields));
+	else if (attr == &dev_wl_throttle_ms) {
+		u64 ns = atomic64_read(&ubi->wl_stats.throttle_ns);
+
+		ret = sprintf(buf, "%llu\n", div_u64(ns, NSEC_PER_MSEC));
+	}
+	else if (attr == &dev_read_latency_us)
+		ret = sprintf(buf, "%lld\n", avg_us(&ubi->wl_stats.read_ns,
+						   &ubi->wl_stats.reads));
+	else if (attr == &dev_wl_read_latency_us)
+		ret = sprintf(buf, "%lld\n", avg_us(&ubi->wl_stats.wl_read_ns,
+						   &ubi->wl_stats.wl_reads));
 	else
 		ret = -EINVAL;
 
@@ -422,6 +463,24 @@ static int ubi_sysfs_init(struct ubi_device *ubi, int *ref)
 	if (err)
 		return err;
 	err = device_create_file(&ubi->dev, &dev_mtd_num);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_wl_debt);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_wl_copied_bytes);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_wl_yields);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_wl_throttle_ms);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_read_latency_us);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_wl_read_latency_us);
 	return err;
 }
 
@@ -431,6 +490,12 @@ static int ubi_sysfs_init(struct ubi_device *ubi, int *ref)
  */
 static void ubi_sysfs_close(struct ubi_device *ubi)
 {
+	device_remove_file(&ubi->dev, &dev_wl_read_latency_us);
+	device_remove_file(&ubi->dev, &dev_read_latency_us);
+	device_remove_file(&ubi->dev, &dev_wl_throttle_ms);
+	device_remove_file(&ubi->dev, &dev_wl_yields);
+	device_remove_file(&ubi->dev, &dev_wl_copied_bytes);
+	device_remove_file(&ubi->dev, &dev_wl_debt);
 	device_remove_file(&ubi->dev, &dev_mtd_num);
 	device_remove_file(&ubi->dev, &dev_bgt_enabled);
 	device_remove_file(&ubi->dev, &dev_min_io_size);
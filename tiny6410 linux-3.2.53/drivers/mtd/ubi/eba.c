@@ -348,6 +348,41 @@ out_unlock:
 	return err;
 }
 
+/**
+ * fg_read_data - read data on behalf of an UBI user.
+ * @ubi: UBI device description object
+ * @buf: buffer to store the read data
+ * @pnum: physical eraseblock number to read from
+ * @offset: offset within the logical eraseblock to read from
+ * @len: how many bytes to read
+ *
+ * This is a wrapper over 'ubi_io_read_data()' which lets the wear-leveling
+ * worker know that a foreground read is in progress (see
+ * 'ubi_wl_yield()') and accounts the read latency.
+ */
+static int fg_read_data(struct ubi_device *ubi, void *buf, int pnum,
+			int offset, int len)
+{
+	int err, wl = ubi->wl_copying;
+	ktime_t start = ktime_get();
+	s64 ns;
+
+	atomic_inc(&ubi->fg_reads);
+	err = ubi_io_read_data(ubi, buf, pnum, offset, len);
+	if (atomic_dec_and_test(&ubi->fg_reads) &&
+	    waitqueue_active(&ubi->fg_wait))
+		wake_up(&ubi->fg_wait);
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	atomic64_inc(&ubi->wl_stats.reads);
+	atomic64_add(ns, &ubi->wl_stats.read_ns);
+	if (wl || ubi->wl_copying) {
+		atomic64_inc(&ubi->wl_stats.wl_reads);
+		atomic64_add(ns, &ubi->wl_stats.wl_read_ns);
+	}
+	return err;
+}
+
 /**
  * ubi_eba_read_leb - read data.
  * @ubi: UBI device description object
@@ -438,7 +473,7 @@ retry:
 		ubi_free_vid_hdr(ubi, vid_hdr);
 	}
 
-	err = ubi_io_read_data(ubi, buf, pnum, offset, len);
+	err = fg_read_data(ubi, buf, pnum, offset, len);
 	if (err) {
 		if (err == UBI_IO_BITFLIPS) {
 			scrub = 1;
@@ -968,6 +1003,44 @@ static int is_error_sane(int err)
 	return 1;
 }
 
+/**
+ * copy_data - read or write data of a logical eraseblock being moved.
+ * @ubi: UBI device description object
+ * @buf: data buffer
+ * @pnum: physical eraseblock number
+ * @len: how many bytes to read or write, aligned to the minimal I/O unit
+ * @write: non-zero to write, zero to read
+ *
+ * This is a helper for 'ubi_eba_copy_leb()' which does the I/O in chunks of
+ * the flash write buffer size (but not less than a page) and calls
+ * 'ubi_wl_yield()' after each chunk, so that a LEB move does not hold off
+ * foreground reads for the whole eraseblock. Returns zero, %UBI_IO_BITFLIPS
+ * if any chunk had bit-flips when reading, or a negative error code.
+ */
+static int copy_data(struct ubi_device *ubi, void *buf, int pnum, int len,
+		     int write)
+{
+	int err, offs, chunk, bitflips = 0;
+
+	chunk = max_t(int, ubi->max_write_size, PAGE_SIZE);
+	for (offs = 0; offs < len; offs += chunk) {
+		int n = min(len - offs, chunk);
+
+		if (write)
+			err = ubi_io_write_data(ubi, buf + offs, pnum, offs, n);
+		else
+			err = ubi_io_read_data(ubi, buf + offs, pnum, offs, n);
+		if (err == UBI_IO_BITFLIPS)
+			bitflips = 1;
+		else if (err)
+			return err;
+
+		ubi_wl_yield(ubi, n);
+	}
+
+	return bitflips ? UBI_IO_BITFLIPS : 0;
+}
+
 /**
  * ubi_eba_copy_leb - copy logical eraseblock.
  * @ubi: UBI device description object
@@ -1058,8 +1131,9 @@ int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to,
 	 * @ubi->buf_mutex.
 	 */
 	mutex_lock(&ubi->buf_mutex);
+	ubi->wl_copying = 1;
 	dbg_wl("read %d bytes of data", aldata_size);
-	err = ubi_io_read_data(ubi, ubi->peb_buf1, from, 0, aldata_size);
+	err = copy_data(ubi, ubi->peb_buf1, from, aldata_size, 0);
 	if (err && err != UBI_IO_BITFLIPS) {
 		ubi_warn("error %d while reading data from PEB %d",
 			 err, from);
@@ -1121,7 +1195,7 @@ int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to,
 	}
 
 	if (data_size > 0) {
-		err = ubi_io_write_data(ubi, ubi->peb_buf1, to, 0, aldata_size);
+		err = copy_data(ubi, ubi->peb_buf1, to, aldata_size, 1);
 		if (err) {
 			if (err == -EIO)
 				err = MOVE_TARGET_WR_ERR;
@@ -1135,7 +1209,7 @@ int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to,
 		 * sure it was written correctly.
 		 */
 
-		err = ubi_io_read_data(ubi, ubi->peb_buf2, to, 0, aldata_size);
+		err = copy_data(ubi, ubi->peb_buf2, to, aldata_size, 0);
 		if (err) {
 			if (err != UBI_IO_BITFLIPS) {
 				ubi_warn("error %d while reading data back "
@@ -1159,8 +1233,10 @@ int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to,
 
 	ubi_assert(vol->eba_tbl[lnum] == from);
 	vol->eba_tbl[lnum] = to;
+	atomic64_add(data_size, &ubi->wl_stats.copy_bytes);
 
 out_unlock_buf:
+	ubi->wl_copying = 0;
 	mutex_unlock(&ubi->buf_mutex);
 out_unlock_leb:
 	leb_write_unlock(ubi, vol_id, lnum);
@@ -298,6 +298,8 @@ int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum, int offset,
 	} else
 		ubi_assert(written == len);
 
+	atomic64_add(written, &ubi->bytes_written);
+
 	if (!err) {
 		err = ubi_dbg_check_write(ubi, buf, pnum, offset, len);
 		if (err)
@@ -45,6 +45,7 @@ void ubi_do_get_device_info(struct ubi_device *ubi, struct ubi_device_info *di)
 	di->max_write_size = ubi->max_write_size;
 	di->ro_mode = ubi->ro_mode;
 	di->cdev = ubi->cdev.dev;
+	di->bytes_written = atomic64_read(&ubi->bytes_written);
 }
 EXPORT_SYMBOL_GPL(ubi_do_get_device_info);
 
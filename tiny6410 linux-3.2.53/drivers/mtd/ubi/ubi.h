@@ -196,6 +196,26 @@ struct ubi_rename_entry {
 
 struct ubi_volume_desc;
 
+/**
+ * struct ubi_wl_stats - wear-leveling impact statistics.
+ * @copy_bytes: bytes copied by the wear-leveling worker
+ * @yields: how many times the worker yielded to foreground reads
+ * @throttle_ns: time the worker spent yielding or rate-limited
+ * @reads: count of foreground LEB reads
+ * @read_ns: total time of foreground LEB reads
+ * @wl_reads: count of foreground LEB reads done while a LEB was being moved
+ * @wl_read_ns: total time of those reads
+ */
+struct ubi_wl_stats {
+	atomic64_t copy_bytes;
+	atomic64_t yields;
+	atomic64_t throttle_ns;
+	atomic64_t reads;
+	atomic64_t read_ns;
+	atomic64_t wl_reads;
+	atomic64_t wl_read_ns;
+};
+
 /**
  * struct ubi_volume - UBI volume description data structure.
  * @dev: device object to make use of the the Linux device model
@@ -357,6 +377,14 @@ struct ubi_wl_entry;
  * @bgt_thread: background thread description object
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
+ * @fg_reads: count of foreground LEB reads in progress
+ * @fg_wait: the wear-leveling worker waits here for @fg_reads to drop to zero
+ * @wl_copying: non-zero while the wear-leveling worker copies a LEB
+ * @wl_next: earliest time the worker may copy more data (rate limiting)
+ * @wl_copied: bytes read and written by the current LEB move
+ * @wl_yield_end: until when (in jiffies) the current LEB move may yield to
+ *                foreground reads
+ * @wl_stats: wear-leveling impact statistics
  *
  * @flash_size: underlying MTD device size (in bytes)
  * @peb_count: count of physical eraseblocks on the MTD device
@@ -386,6 +414,7 @@ struct ubi_wl_entry;
  * @max_write_size: maximum amount of bytes the underlying flash can write at a
  *                  time (MTD write buffer size)
  * @mtd: MTD device descriptor
+ * @bytes_written: bytes written to the flash since the device was attached
  *
  * @peb_buf1: a buffer of PEB size used for different purposes
  * @peb_buf2: another buffer of PEB size used for different purposes
@@ -446,6 +475,13 @@ struct ubi_device {
 	struct task_struct *bgt_thread;
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
+	atomic_t fg_reads;
+	wait_queue_head_t fg_wait;
+	int wl_copying;
+	ktime_t wl_next;
+	int wl_copied;
+	unsigned long wl_yield_end;
+	struct ubi_wl_stats wl_stats;
 
 	/* I/O sub-system's stuff */
 	long long flash_size;
@@ -470,6 +506,7 @@ struct ubi_device {
 	unsigned int nor_flash:1;
 	int max_write_size;
 	struct mtd_info *mtd;
+	atomic64_t bytes_written;
 
 	void *peb_buf1;
 	void *peb_buf2;
@@ -544,6 +581,8 @@ int ubi_wl_flush(struct ubi_device *ubi);
 int ubi_wl_scrub_peb(struct ubi_device *ubi, int pnum);
 int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
 void ubi_wl_close(struct ubi_device *ubi);
+void ubi_wl_yield(struct ubi_device *ubi, int len);
+int ubi_wl_debt(struct ubi_device *ubi);
 int ubi_thread(void *u);
 
 /* io.c */
@@ -0,0 +1,581 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * This is a small driver which implements read-only block devices on top of
+ * UBI volumes, so that block-oriented read-only file systems like squashfs or
+ * cramfs can live on UBI and benefit from its wear-levelling and bad eraseblock
+ * handling without stacking gluebi and mtdblock.
+ *
+ * For each UBI volume a "ubiblockX_Y" disk is created, X being the UBI device
+ * number and Y the volume ID. Bios are handed to a small pool of workers which
+ * read straight from the volume into the bio pages, so several reads may be
+ * outstanding at a time. Sequential readers (such as a file system being read
+ * at boot) go through a one-LEB cache instead: the whole logical eraseblock is
+ * read at once and the following requests are served from memory.
+ *
+ * Like gluebi, the UBI volume is only opened while the block device is open,
+ * so volumes may still be removed or re-sized while their block devices are
+ * unused.
+ */
+
+#include <linux/err.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/highmem.h>
+#include <linux/idr.h>
+#include <linux/workqueue.h>
+#include <linux/math64.h>
+#include <linux/mtd/ubi.h>
+
+/* Maximum number of bios being read from a volume at the same time */
+#define UBIBLOCK_MAX_INFLIGHT 4
+
+#define ubiblock_err(fmt, ...)                                    \
+	printk(KERN_ERR "ubiblock error: %s: " fmt "\n", __func__, \
+	       ##__VA_ARGS__)
+
+struct ubiblock;
+
+/**
+ * struct ubiblock_worker - a bio reading worker.
+ * @work: work queued on the device workqueue
+ * @dev: the ubiblock device this worker reads for
+ */
+struct ubiblock_worker {
+	struct work_struct work;
+	struct ubiblock *dev;
+};
+
+/**
+ * struct ubiblock_cache - a one-LEB read cache.
+ * @mutex: serializes cache look-ups and fills
+ * @buf: LEB-sized buffer, only allocated while the device is open
+ * @lnum: number of the cached LEB, %-1 if the cache is empty
+ */
+struct ubiblock_cache {
+	struct mutex mutex;
+	void *buf;
+	int lnum;
+};
+
+/**
+ * struct ubiblock - a UBI block device description data structure.
+ * @desc: UBI volume descriptor, valid while @refcnt is not zero
+ * @ubi_num: UBI device number this block device works on
+ * @vol_id: ID of UBI volume this block device works on
+ * @leb_size: usable logical eraseblock size of the volume
+ * @size: volume size in bytes
+ * @refcnt: block device open count
+ * @dev_mutex: protects @desc, @refcnt and the cache buffer
+ * @gd: the gendisk
+ * @queue: bio queue of the gendisk
+ * @wq: workqueue the workers run on
+ * @bio_lock: protects @bios
+ * @bios: bios waiting for a worker
+ * @workers: the bio reading workers
+ * @next_sector: sector following the last bio, to spot sequential readers
+ * @cache: read cache
+ * @list: link in the list of ubiblock devices
+ */
+struct ubiblock {
+	struct ubi_volume_desc *desc;
+	int ubi_num;
+	int vol_id;
+	int leb_size;
+	u64 size;
+	int refcnt;
+	struct mutex dev_mutex;
+
+	struct gendisk *gd;
+	struct request_queue *queue;
+	struct workqueue_struct *wq;
+	spinlock_t bio_lock;
+	struct bio_list bios;
+	struct ubiblock_worker workers[UBIBLOCK_MAX_INFLIGHT];
+	sector_t next_sector;
+	struct ubiblock_cache cache;
+
+	struct list_head list;
+};
+
+static int ubiblock_major;
+
+/* List of all ubiblock devices */
+static LIST_HEAD(ubiblock_devices);
+static DEFINE_MUTEX(devices_mutex);
+static DEFINE_IDA(ubiblock_minor_ida);
+
+/**
+ * find_dev_nolock - find a ubiblock device.
+ * @ubi_num: UBI device number
+ * @vol_id: volume ID
+ *
+ * Returns the ubiblock device corresponding to UBI device @ubi_num and volume
+ * @vol_id, or %NULL if there is none. The caller has to hold @devices_mutex.
+ */
+static struct ubiblock *find_dev_nolock(int ubi_num, int vol_id)
+{
+	struct ubiblock *dev;
+
+	list_for_each_entry(dev, &ubiblock_devices, list)
+		if (dev->ubi_num == ubi_num && dev->vol_id == vol_id)
+			return dev;
+	return NULL;
+}
+
+/**
+ * leb_data_len - amount of data a LEB may hold.
+ * @dev: ubiblock device
+ * @lnum: logical eraseblock number
+ *
+ * Only differs from the LEB size for the last LEB of a static volume.
+ */
+static int leb_data_len(const struct ubiblock *dev, int lnum)
+{
+	u64 start = (u64)lnum * dev->leb_size;
+
+	if (start + dev->leb_size > dev->size)
+		return dev->size - start;
+	return dev->leb_size;
+}
+
+/**
+ * ubiblock_read_leb - read data from a logical eraseblock.
+ * @dev: ubiblock device
+ * @buf: buffer to read to
+ * @lnum: logical eraseblock number
+ * @offset: offset within the logical eraseblock
+ * @len: how many bytes to read
+ * @seq: the read continues the previous one
+ *
+ * Data of the cached LEB is copied from the cache. Otherwise sequential
+ * reads load the whole LEB into the cache first, while random reads go to
+ * the volume directly and only read what they need. Returns zero in case of
+ * success and a negative error code in case of failure.
+ */
+static int ubiblock_read_leb(struct ubiblock *dev, char *buf, int lnum,
+			     int offset, int len, int seq)
+{
+	struct ubiblock_cache *cache = &dev->cache;
+	int err = 0;
+
+	mutex_lock(&cache->mutex);
+	if (cache->lnum == lnum)
+		goto copy;
+
+	if (!seq) {
+		mutex_unlock(&cache->mutex);
+		return ubi_read(dev->desc, lnum, buf, offset, len);
+	}
+
+	cache->lnum = -1;
+	err = ubi_read(dev->desc, lnum, cache->buf, 0,
+		       leb_data_len(dev, lnum));
+	if (err)
+		goto out_unlock;
+	cache->lnum = lnum;
+copy:
+	memcpy(buf, cache->buf + offset, len);
+out_unlock:
+	mutex_unlock(&cache->mutex);
+	return err;
+}
+
+/**
+ * ubiblock_read_bio - read the data of a bio.
+ * @dev: ubiblock device
+ * @bio: the bio to fill
+ *
+ * Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+static int ubiblock_read_bio(struct ubiblock *dev, struct bio *bio)
+{
+	u64 pos = (u64)bio->bi_sector << 9;
+	struct bio_vec *bvec;
+	int i, seq;
+
+	/* Racy, but it only steers the use of the cache */
+	seq = (bio->bi_sector == dev->next_sector);
+	dev->next_sector = bio->bi_sector + bio_sectors(bio);
+
+	bio_for_each_segment(bvec, bio, i) {
+		char *buf = kmap(bvec->bv_page) + bvec->bv_offset;
+		int len = bvec->bv_len;
+		int err = 0;
+
+		while (len) {
+			u32 offset;
+			int lnum, count;
+
+			lnum = div_u64_rem(pos, dev->leb_size, &offset);
+			count = min_t(int, len, dev->leb_size - offset);
+			err = ubiblock_read_leb(dev, buf, lnum, offset, count,
+						seq);
+			if (err)
+				break;
+			buf += count;
+			pos += count;
+			len -= count;
+		}
+		kunmap(bvec->bv_page);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static void ubiblock_do_work(struct work_struct *work)
+{
+	struct ubiblock_worker *worker;
+	struct ubiblock *dev;
+	struct bio *bio;
+
+	worker = container_of(work, struct ubiblock_worker, work);
+	dev = worker->dev;
+	for (;;) {
+		spin_lock(&dev->bio_lock);
+		bio = bio_list_pop(&dev->bios);
+		spin_unlock(&dev->bio_lock);
+		if (!bio)
+			break;
+		bio_endio(bio, ubiblock_read_bio(dev, bio));
+	}
+}
+
+static void ubiblock_make_request(struct request_queue *q, struct bio *bio)
+{
+	struct ubiblock *dev = q->queuedata;
+	int i;
+
+	if (bio_data_dir(bio) == WRITE) {
+		bio_endio(bio, -EROFS);
+		return;
+	}
+	if (bio->bi_sector + bio_sectors(bio) > get_capacity(dev->gd)) {
+		bio_endio(bio, -EIO);
+		return;
+	}
+
+	spin_lock(&dev->bio_lock);
+	bio_list_add(&dev->bios, bio);
+	spin_unlock(&dev->bio_lock);
+
+	/*
+	 * Wake up one idle worker. If they all are already pending, one of
+	 * them will pick the bio up anyway.
+	 */
+	for (i = 0; i < UBIBLOCK_MAX_INFLIGHT; i++)
+		if (queue_work(dev->wq, &dev->workers[i].work))
+			break;
+}
+
+static int ubiblock_open(struct block_device *bdev, fmode_t mode)
+{
+	struct ubiblock *dev = bdev->bd_disk->private_data;
+	int err = 0;
+
+	if (mode & FMODE_WRITE)
+		return -EROFS;
+
+	mutex_lock(&dev->dev_mutex);
+	if (dev->refcnt > 0) {
+		dev->refcnt += 1;
+		goto out_unlock;
+	}
+
+	dev->cache.buf = vmalloc(dev->leb_size);
+	if (!dev->cache.buf) {
+		err = -ENOMEM;
+		goto out_unlock;
+	}
+	dev->cache.lnum = -1;
+
+	dev->desc = ubi_open_volume(dev->ubi_num, dev->vol_id, UBI_READONLY);
+	if (IS_ERR(dev->desc)) {
+		err = PTR_ERR(dev->desc);
+		dev->desc = NULL;
+		vfree(dev->cache.buf);
+		dev->cache.buf = NULL;
+		goto out_unlock;
+	}
+	dev->refcnt = 1;
+
+out_unlock:
+	mutex_unlock(&dev->dev_mutex);
+	return err;
+}
+
+static int ubiblock_release(struct gendisk *gd, fmode_t mode)
+{
+	struct ubiblock *dev = gd->private_data;
+
+	mutex_lock(&dev->dev_mutex);
+	dev->refcnt -= 1;
+	if (dev->refcnt == 0) {
+		flush_workqueue(dev->wq);
+		ubi_close_volume(dev->desc);
+		dev->desc = NULL;
+		vfree(dev->cache.buf);
+		dev->cache.buf = NULL;
+	}
+	mutex_unlock(&dev->dev_mutex);
+	return 0;
+}
+
+static const struct block_device_operations ubiblock_ops = {
+	.owner		= THIS_MODULE,
+	.open		= ubiblock_open,
+	.release	= ubiblock_release,
+};
+
+static u64 ubiblock_vol_size(const struct ubi_volume_info *vi)
+{
+	/* Static volumes cannot be read past the data they contain */
+	if (vi->vol_type == UBI_DYNAMIC_VOLUME)
+		return (u64)vi->usable_leb_size * vi->size;
+	return vi->used_bytes;
+}
+
+/**
+ * ubiblock_create - create a block device for an UBI volume.
+ * @vi: UBI volume description object
+ *
+ * Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+static int ubiblock_create(struct ubi_volume_info *vi)
+{
+	struct ubiblock *dev;
+	struct gendisk *gd;
+	int i, err;
+
+	mutex_lock(&devices_mutex);
+	if (find_dev_nolock(vi->ubi_num, vi->vol_id)) {
+		err = -EEXIST;
+		goto out_unlock;
+	}
+
+	err = -ENOMEM;
+	dev = kzalloc(sizeof(struct ubiblock), GFP_KERNEL);
+	if (!dev)
+		goto out_unlock;
+
+	dev->ubi_num = vi->ubi_num;
+	dev->vol_id = vi->vol_id;
+	dev->leb_size = vi->usable_leb_size;
+	dev->size = ubiblock_vol_size(vi);
+	mutex_init(&dev->dev_mutex);
+	mutex_init(&dev->cache.mutex);
+	dev->cache.lnum = -1;
+	spin_lock_init(&dev->bio_lock);
+	bio_list_init(&dev->bios);
+	for (i = 0; i < UBIBLOCK_MAX_INFLIGHT; i++) {
+		INIT_WORK(&dev->workers[i].work, ubiblock_do_work);
+		dev->workers[i].dev = dev;
+	}
+
+	gd = alloc_disk(1);
+	if (!gd)
+		goto out_free_dev;
+
+	err = ida_simple_get(&ubiblock_minor_ida, 0, 0, GFP_KERNEL);
+	if (err < 0)
+		goto out_put_disk;
+	gd->first_minor = err;
+	gd->major = ubiblock_major;
+	gd->fops = &ubiblock_ops;
+	gd->private_data = dev;
+	gd->flags |= GENHD_FL_EXT_DEVT | GENHD_FL_NO_PART_SCAN;
+	sprintf(gd->disk_name, "ubiblock%d_%d", dev->ubi_num, dev->vol_id);
+	set_capacity(gd, dev->size >> 9);
+	set_disk_ro(gd, 1);
+	dev->gd = gd;
+
+	err = -ENOMEM;
+	dev->queue = blk_alloc_queue(GFP_KERNEL);
+	if (!dev->queue)
+		goto out_free_minor;
+	blk_queue_make_request(dev->queue, ubiblock_make_request);
+	dev->queue->queuedata = dev;
+	gd->queue = dev->queue;
+
+	dev->wq = alloc_workqueue(gd->disk_name, WQ_MEM_RECLAIM | WQ_UNBOUND,
+				  UBIBLOCK_MAX_INFLIGHT);
+	if (!dev->wq)
+		goto out_free_queue;
+
+	list_add_tail(&dev->list, &ubiblock_devices);
+	add_disk(gd);
+	mutex_unlock(&devices_mutex);
+
+	printk(KERN_INFO "ubiblock: created %s from UBI device %d volume "
+	       "%d (\"%s\")\n", gd->disk_name, dev->ubi_num, dev->vol_id,
+	       vi->name);
+	return 0;
+
+out_free_queue:
+	blk_cleanup_queue(dev->queue);
+out_free_minor:
+	ida_simple_remove(&ubiblock_minor_ida, gd->first_minor);
+out_put_disk:
+	put_disk(gd);
+out_free_dev:
+	kfree(dev);
+out_unlock:
+	mutex_unlock(&devices_mutex);
+	ubiblock_err("cannot create block device for UBI device %d volume %d, "
+		     "error %d", vi->ubi_num, vi->vol_id, err);
+	return err;
+}
+
+static void ubiblock_destroy(struct ubiblock *dev)
+{
+	int minor = dev->gd->first_minor;
+
+	del_gendisk(dev->gd);
+	blk_cleanup_queue(dev->queue);
+	destroy_workqueue(dev->wq);
+	put_disk(dev->gd);
+	ida_simple_remove(&ubiblock_minor_ida, minor);
+	kfree(dev);
+}
+
+/**
+ * ubiblock_remove - remove the block device of an UBI volume.
+ * @vi: UBI volume description object
+ *
+ * Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+static int ubiblock_remove(struct ubi_volume_info *vi)
+{
+	struct ubiblock *dev;
+
+	mutex_lock(&devices_mutex);
+	dev = find_dev_nolock(vi->ubi_num, vi->vol_id);
+	if (!dev) {
+		mutex_unlock(&devices_mutex);
+		return -ENOENT;
+	}
+
+	/* UBI does not remove volumes which are open, so this can't race */
+	mutex_lock(&dev->dev_mutex);
+	if (dev->refcnt) {
+		mutex_unlock(&dev->dev_mutex);
+		mutex_unlock(&devices_mutex);
+		return -EBUSY;
+	}
+	mutex_unlock(&dev->dev_mutex);
+
+	list_del(&dev->list);
+	mutex_unlock(&devices_mutex);
+
+	ubiblock_destroy(dev);
+	return 0;
+}
+
+/**
+ * ubiblock_resize - update the capacity of a block device.
+ * @vi: UBI volume description object
+ *
+ * Called when a volume is re-sized, or when a static volume is updated.
+ */
+static int ubiblock_resize(struct ubi_volume_info *vi)
+{
+	struct ubiblock *dev;
+
+	mutex_lock(&devices_mutex);
+	dev = find_dev_nolock(vi->ubi_num, vi->vol_id);
+	if (!dev) {
+		mutex_unlock(&devices_mutex);
+		return -ENOENT;
+	}
+
+	mutex_lock(&dev->dev_mutex);
+	dev->size = ubiblock_vol_size(vi);
+	set_capacity(dev->gd, dev->size >> 9);
+	mutex_lock(&dev->cache.mutex);
+	dev->cache.lnum = -1;
+	mutex_unlock(&dev->cache.mutex);
+	mutex_unlock(&dev->dev_mutex);
+	mutex_unlock(&devices_mutex);
+	return 0;
+}
+
+static int ubiblock_notify(struct notifier_block *nb, unsigned long l,
+			   void *ns_ptr)
+{
+	struct ubi_notification *nt = ns_ptr;
+
+	switch (l) {
+	case UBI_VOLUME_ADDED:
+		ubiblock_create(&nt->vi);
+		break;
+	case UBI_VOLUME_REMOVED:
+		ubiblock_remove(&nt->vi);
+		break;
+	case UBI_VOLUME_RESIZED:
+	case UBI_VOLUME_UPDATED:
+		ubiblock_resize(&nt->vi);
+		break;
+	default:
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block ubiblock_notifier = {
+	.notifier_call	= ubiblock_notify,
+};
+
+static int __init ubiblock_init(void)
+{
+	int err;
+
+	ubiblock_major = register_blkdev(0, "ubiblock");
+	if (ubiblock_major < 0)
+		return ubiblock_major;
+
+	err = ubi_register_volume_notifier(&ubiblock_notifier, 0);
+	if (err)
+		unregister_blkdev(ubiblock_major, "ubiblock");
+	return err;
+}
+
+static void __exit ubiblock_exit(void)
+{
+	struct ubiblock *dev, *next;
+
+	ubi_unregister_volume_notifier(&ubiblock_notifier);
+	list_for_each_entry_safe(dev, next, &ubiblock_devices, list) {
+		list_del(&dev->list);
+		ubiblock_destroy(dev);
+	}
+	unregister_blkdev(ubiblock_major, "ubiblock");
+}
+
+module_init(ubiblock_init);
+module_exit(ubiblock_exit);
+MODULE_DESCRIPTION("Read-only block devices on top of UBI volumes");
+MODULE_LICENSE("GPL");
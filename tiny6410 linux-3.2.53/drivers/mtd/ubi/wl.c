@@ -110,6 +110,8 @@
 #include <linux/crc32.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/moduleparam.h>
 #include "ubi.h"
 
 /* Number of physical eraseblocks reserved for wear-leveling purposes */
@@ -142,6 +144,22 @@
  */
 #define WL_MAX_FAILURES 32
 
+/*
+ * Longest time the wear-leveling worker waits for foreground reads to finish
+ * during the move of one logical eraseblock, in total. The worker holds the
+ * LEB write lock while it waits, so this must stay short.
+ */
+#define WL_YIELD_MAX_MS 10
+
+/*
+ * Bandwidth cap of the wear-leveling worker in KiB/s, 0 means unlimited. Both
+ * the read and the write of a copied LEB are counted.
+ */
+static unsigned int wl_max_rate;
+module_param(wl_max_rate, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(wl_max_rate, "Wear-leveling bandwidth limit in KiB/s "
+			      "(default: 0 - unlimited)");
+
 /**
  * struct ubi_work - UBI work description data structure.
  * @list: a link in the list of pending works
@@ -651,6 +669,40 @@ static int schedule_erase(struct ubi_device *ubi, struct ubi_wl_entry *e,
 	return 0;
 }
 
+/**
+ * ubi_wl_throttle - keep the wear-leveling worker within its bandwidth cap.
+ * @ubi: UBI device description object
+ * @len: how many bytes the last LEB move read and wrote
+ *
+ * This function is called by 'wear_leveling_worker()' after a LEB move, once
+ * it does not hold any locks. It sleeps as long as needed to keep the copying
+ * within the @wl_max_rate bandwidth. Moves done on behalf of 'ubi_wl_flush()'
+ * are not throttled.
+ */
+static void ubi_wl_throttle(struct ubi_device *ubi, int len)
+{
+	unsigned int rate = ACCESS_ONCE(wl_max_rate);
+	ktime_t start;
+	s64 delay;
+
+	if (!rate || !len || current != ubi->bgt_thread)
+		return;
+
+	start = ktime_get();
+	if (ktime_to_ns(ubi->wl_next) < ktime_to_ns(start))
+		ubi->wl_next = start;
+	ubi->wl_next = ktime_add_ns(ubi->wl_next,
+			div64_u64((u64)len * NSEC_PER_SEC, (u64)rate << 10));
+	delay = ktime_us_delta(ubi->wl_next, start);
+	if (delay > 20000)
+		msleep(div_s64(delay, 1000));
+	else if (delay > 0)
+		usleep_range(delay, delay + delay / 4);
+
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &ubi->wl_stats.throttle_ns);
+}
+
 /**
  * wear_leveling_worker - wear-leveling worker function.
  * @ubi: UBI device description object
@@ -665,7 +717,7 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 				int cancel)
 {
 	int err, scrubbing = 0, torture = 0, protect = 0, erroneous = 0;
-	int vol_id = -1, uninitialized_var(lnum);
+	int vol_id = -1, uninitialized_var(lnum), copied = 0;
 	struct ubi_wl_entry *e1, *e2;
 	struct ubi_vid_hdr *vid_hdr;
 
@@ -780,7 +832,10 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 	vol_id = be32_to_cpu(vid_hdr->vol_id);
 	lnum = be32_to_cpu(vid_hdr->lnum);
 
+	ubi->wl_copied = 0;
+	ubi->wl_yield_end = jiffies + msecs_to_jiffies(WL_YIELD_MAX_MS);
 	err = ubi_eba_copy_leb(ubi, e1->pnum, e2->pnum, vid_hdr);
+	copied = ubi->wl_copied;
 	if (err) {
 		if (err == MOVE_CANCEL_RACE) {
 			/*
@@ -869,6 +924,7 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 
 	dbg_wl("done");
 	mutex_unlock(&ubi->move_mutex);
+	ubi_wl_throttle(ubi, copied);
 	return 0;
 
 	/*
@@ -905,6 +961,7 @@ out_not_moved:
 		goto out_ro;
 	}
 	mutex_unlock(&ubi->move_mutex);
+	ubi_wl_throttle(ubi, copied);
 	return 0;
 
 out_error:
@@ -1002,6 +1059,61 @@ out_unlock:
 	return err;
 }
 
+/**
+ * ubi_wl_debt - get the wear-leveling debt.
+ * @ubi: UBI device description object
+ *
+ * This function returns the difference between the erase counter of the free
+ * physical eraseblock the WL sub-system would move data to and the lowest
+ * erase counter of used physical eraseblocks. Wear-leveling is scheduled when
+ * this reaches %UBI_WL_THRESHOLD, see 'ensure_wear_leveling()'.
+ */
+int ubi_wl_debt(struct ubi_device *ubi)
+{
+	struct ubi_wl_entry *e1, *e2;
+	int debt = 0;
+
+	spin_lock(&ubi->wl_lock);
+	if (ubi->used.rb_node && ubi->free.rb_node) {
+		e1 = rb_entry(rb_first(&ubi->used), struct ubi_wl_entry, u.rb);
+		e2 = find_wl_entry(&ubi->free, WL_FREE_MAX_DIFF);
+		debt = max(e2->ec - e1->ec, 0);
+	}
+	spin_unlock(&ubi->wl_lock);
+	return debt;
+}
+
+/**
+ * ubi_wl_yield - let foreground reads go first during a LEB move.
+ * @ubi: UBI device description object
+ * @len: how many bytes were copied since the last call
+ *
+ * This function is called by 'ubi_eba_copy_leb()' after each chunk of a moved
+ * logical eraseblock, with the LEB write lock and @ubi->buf_mutex held. It
+ * counts the copied bytes for 'ubi_wl_throttle()' and, when called from the
+ * UBI background thread, waits for foreground reads in progress to finish.
+ * All the waits of one move take at most %WL_YIELD_MAX_MS together.
+ */
+void ubi_wl_yield(struct ubi_device *ubi, int len)
+{
+	ktime_t start;
+	long left;
+
+	ubi->wl_copied += len;
+	if (current != ubi->bgt_thread || !atomic_read(&ubi->fg_reads))
+		return;
+
+	left = (long)(ubi->wl_yield_end - jiffies);
+	if (left <= 0)
+		return;
+
+	start = ktime_get();
+	atomic64_inc(&ubi->wl_stats.yields);
+	wait_event_timeout(ubi->fg_wait, !atomic_read(&ubi->fg_reads), left);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &ubi->wl_stats.throttle_ns);
+}
+
 /**
  * erase_worker - physical eraseblock erase worker function.
  * @ubi: UBI device description object
@@ -1437,6 +1549,7 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 
 	ubi->used = ubi->erroneous = ubi->free = ubi->scrub = RB_ROOT;
 	spin_lock_init(&ubi->wl_lock);
+	init_waitqueue_head(&ubi->fg_wait);
 	mutex_init(&ubi->move_mutex);
 	init_rwsem(&ubi->work_sem);
 	ubi->max_ec = si->max_ec;
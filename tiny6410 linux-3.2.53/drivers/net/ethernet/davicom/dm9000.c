@@ -35,6 +35,7 @@
 #include <linux/platform_device.h>
 #include <linux/irq.h>
 #include <linux/slab.h>
+#include <linux/highmem.h>
 
 #include <asm/delay.h>
 #include <asm/irq.h>
@@ -104,6 +105,7 @@ typedef struct board_info {
 	u16		queue_ip_summed;
 	u16		dbug_cnt;
 	u8		io_mode;		/* 0:word, 2:byte */
+	u8		io_width;		/* bytes per data port access */
 	u8		phy_addr;
 	u8		imr_all;
 
@@ -372,6 +374,7 @@ static void dm9000_set_io(struct board_info *db, int byte_width)
 
 	switch (byte_width) {
 	case 1:
+		db->io_width = 1;
 		db->dumpblk = dm9000_dumpblk_8bit;
 		db->outblk  = dm9000_outblk_8bit;
 		db->inblk   = dm9000_inblk_8bit;
@@ -381,6 +384,7 @@ static void dm9000_set_io(struct board_info *db, int byte_width)
 	case 3:
 		dev_dbg(db->dev, ": 3 byte IO, falling back to 16bit\n");
 	case 2:
+		db->io_width = 2;
 		db->dumpblk = dm9000_dumpblk_16bit;
 		db->outblk  = dm9000_outblk_16bit;
 		db->inblk   = dm9000_inblk_16bit;
@@ -388,6 +392,7 @@ static void dm9000_set_io(struct board_info *db, int byte_width)
 
 	case 4:
 	default:
+		db->io_width = 4;
 		db->dumpblk = dm9000_dumpblk_32bit;
 		db->outblk  = dm9000_outblk_32bit;
 		db->inblk   = dm9000_inblk_32bit;
@@ -980,6 +985,65 @@ static void dm9000_send_packet(struct net_device *dev,
 	iow(dm, DM9000_TCR, TCR_TXREQ);	/* Cleared after TX complete */
 }
 
+/*
+ * Move part of a packet to the TX SRAM. The data port only takes whole
+ * words, so bytes at the end that do not fill one are kept in @carry
+ * and sent with the start of the next part.
+ */
+static void dm9000_outblk_part(board_info_t *db, u8 *data, unsigned int len,
+			       u8 *carry, unsigned int *ncarry)
+{
+	unsigned int width = db->io_width;
+	unsigned int n;
+
+	if (*ncarry) {
+		n = min(len, width - *ncarry);
+		memcpy(carry + *ncarry, data, n);
+		*ncarry += n;
+		data += n;
+		len -= n;
+
+		if (*ncarry < width)
+			return;
+
+		(db->outblk)(db->io_data, carry, width);
+		*ncarry = 0;
+	}
+
+	n = len & ~(width - 1);
+	if (n)
+		(db->outblk)(db->io_data, data, n);
+
+	*ncarry = len - n;
+	memcpy(carry, data + n, *ncarry);
+}
+
+/*
+ * Move a fragmented packet to the TX SRAM straight from its pages. With
+ * NETIF_F_SG the stack hands us page cache pages from sendfile() and
+ * splice() this way instead of copying them into the skb first.
+ */
+static void dm9000_outblk_skb(board_info_t *db, struct sk_buff *skb)
+{
+	u8 carry[4] __aligned(4);
+	unsigned int ncarry = 0;
+	int i;
+
+	dm9000_outblk_part(db, skb->data, skb_headlen(skb), carry, &ncarry);
+
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+		const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+		u8 *vaddr = kmap_atomic(skb_frag_page(frag));
+
+		dm9000_outblk_part(db, vaddr + frag->page_offset,
+				   skb_frag_size(frag), carry, &ncarry);
+		kunmap_atomic(vaddr);
+	}
+
+	if (ncarry)
+		(db->outblk)(db->io_data, carry, ncarry);
+}
+
 /*
  *  Hardware start transmission.
  *  Send a packet to media from the upper layer.
@@ -1000,7 +1064,10 @@ dm9000_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	/* Move data to DM9000 TX RAM */
 	writeb(DM9000_MWCMD, db->io_addr);
 
-	(db->outblk)(db->io_data, skb->data, skb->len);
+	if (skb_is_nonlinear(skb))
+		dm9000_outblk_skb(db, skb);
+	else
+		(db->outblk)(db->io_data, skb->data, skb->len);
 	dev->stats.tx_bytes += skb->len;
 
 	db->tx_pkt_cnt++;
@@ -1545,9 +1612,11 @@ dm9000_probe(struct platform_device *pdev)
 		db->type = TYPE_DM9000E;
 	}
 
-	/* dm9000a/b are capable of hardware checksum offload */
+	/* dm9000a/b are capable of hardware checksum offload, which also
+	 * lets TCP hand us page fragments for zero-copy sendpage() */
 	if (db->type == TYPE_DM9000A || db->type == TYPE_DM9000B) {
-		ndev->hw_features = NETIF_F_RXCSUM | NETIF_F_IP_CSUM;
+		ndev->hw_features = NETIF_F_RXCSUM | NETIF_F_IP_CSUM |
+				    NETIF_F_SG;
 		ndev->features |= ndev->hw_features;
 	}
 
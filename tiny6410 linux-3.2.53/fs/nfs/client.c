@@ -901,6 +901,11 @@ error:
 	return error;
 }
 
+/*
+ * Readahead window of new mounts, in units of rsize (fs.nfs.nfs_max_readahead)
+ */
+int nfs_max_readahead = NFS_MAX_READAHEAD;
+
 /*
  * Load up the server record from information gained in an fsinfo record
  */
@@ -913,6 +918,18 @@ static void nfs_server_set_fsinfo(struct nfs_server *server,
 	/* Work out a lot of parameters */
 	if (server->rsize == 0)
 		server->rsize = nfs_block_size(fsinfo->rtpref, NULL);
+	/*
+	 * With "adaptive_rsize", reads start at the mount (or preferred)
+	 * rsize and may grow up to the server's maximum, which becomes the
+	 * rsize of the mount.
+	 */
+	if (server->flags & NFS_MOUNT_ADAPTIVE_RSIZE) {
+		if (server->rsize_cur == 0)
+			server->rsize_cur = server->rsize;
+		if (fsinfo->rtmax >= 512)
+			server->rsize = nfs_block_size(fsinfo->rtmax, NULL);
+	} else
+		server->rsize_cur = 0;
 	if (server->wsize == 0)
 		server->wsize = nfs_block_size(fsinfo->wtpref, NULL);
 
@@ -927,9 +944,12 @@ static void nfs_server_set_fsinfo(struct nfs_server *server,
 	if (server->rsize > NFS_MAX_FILE_IO_SIZE)
 		server->rsize = NFS_MAX_FILE_IO_SIZE;
 	server->rpages = (server->rsize + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+	if (server->rsize_cur > server->rsize)
+		server->rsize_cur = server->rsize;
 
 	server->backing_dev_info.name = "nfs";
-	server->backing_dev_info.ra_pages = server->rpages * NFS_MAX_READAHEAD;
+	server->backing_dev_info.ra_pages = server->rpages *
+		clamp_t(int, nfs_max_readahead, 1, RPC_MAX_SLOT_TABLE);
 
 	if (server->wsize > max_rpc_payload)
 		server->wsize = max_rpc_payload;
@@ -1011,6 +1031,7 @@ static void nfs_server_copy_userdata(struct nfs_server *target, struct nfs_serve
 {
 	target->flags = source->flags;
 	target->rsize = source->rsize;
+	target->rsize_cur = source->rsize_cur;
 	target->wsize = source->wsize;
 	target->acregmin = source->acregmin;
 	target->acregmax = source->acregmax;
@@ -1066,6 +1087,7 @@ static struct nfs_server *nfs_alloc_server(void)
 	INIT_LIST_HEAD(&server->layouts);
 
 	atomic_set(&server->active, 0);
+	spin_lock_init(&server->rsize_lock);
 
 	server->io_stats = nfs_alloc_iostats();
 	if (!server->io_stats) {
@@ -2008,3 +2030,6 @@ void nfs_fs_proc_exit(void)
 module_param(nfs4_disable_idmapping, bool, 0644);
 MODULE_PARM_DESC(nfs4_disable_idmapping,
 		"Turn off NFSv4 idmapping when using 'sec=sys'");
+module_param_named(max_readahead, nfs_max_readahead, int, 0644);
+MODULE_PARM_DESC(max_readahead,
+		"Readahead window of new mounts, in units of rsize");
@@ -1037,7 +1037,8 @@ static int nfs_is_exclusive_create(struct inode *dir, struct nameidata *nd)
  *
  * We force revalidation in the cases where the VFS sets LOOKUP_REVAL,
  * or if the intent information indicates that we're about to open this
- * particular file and the "nocto" mount flag is not set.
+ * particular file and the "nocto" mount flag is not set. On read-only
+ * mounts with fs.nfs.nfs_ro_attrtimeo set, opens use the attribute cache.
  *
  */
 static inline
@@ -1054,6 +1055,7 @@ int nfs_lookup_verify_inode(struct inode *inode, struct nameidata *nd)
 		/* This is an open(2) */
 		if (nfs_lookup_check_intent(nd, LOOKUP_OPEN) != 0 &&
 				!(server->flags & NFS_MOUNT_NOCTO) &&
+				!nfs_ro_attrcache(inode) &&
 				(S_ISREG(inode->i_mode) ||
 				 S_ISDIR(inode->i_mode)))
 			goto out_force;
@@ -58,6 +58,9 @@
 /* Default is to see 64-bit inode numbers */
 static int enable_ino64 = NFS_64_BIT_INODE_NUMBERS_ENABLED;
 
+/* Minimum attribute cache timeout on read-only mounts, 0 is off */
+int nfs_ro_attrtimeo;
+
 static void nfs_invalidate_inode(struct inode *);
 static int nfs_update_inode(struct inode *, struct nfs_fattr *);
 
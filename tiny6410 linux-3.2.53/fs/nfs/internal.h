@@ -10,11 +10,10 @@
 
 struct nfs_string;
 
-/* Maximum number of readahead requests
- * FIXME: this should really be a sysctl so that users may tune it to suit
- *        their needs. People that do NFS over a slow network, might for
- *        instance want to reduce it to something closer to 1 for improved
- *        interactive response.
+/* Default maximum number of readahead requests, tunable through
+ * fs.nfs.nfs_max_readahead. People that do NFS over a slow network
+ * might want to reduce it to something closer to 1 for improved
+ * interactive response, or raise it to keep more READs in flight.
  */
 #define NFS_MAX_READAHEAD	(RPC_DEF_SLOT_TABLE - 1)
 
@@ -411,6 +410,20 @@ unsigned long nfs_block_size(unsigned long bsize, unsigned char *nrbitsp)
 	return nfs_block_bits(bsize, nrbitsp);
 }
 
+/*
+ * Size of the READs to send: the rsize, or less while "adaptive_rsize"
+ * is working out the best size
+ */
+static inline
+unsigned int nfs_read_size(struct nfs_server *server)
+{
+	unsigned int rsize = ACCESS_ONCE(server->rsize_cur);
+
+	if (rsize == 0 || rsize > server->rsize)
+		return server->rsize;
+	return rsize;
+}
+
 /*
  * Determine the maximum file size for a superblock
  */
@@ -19,6 +19,7 @@
 #include <linux/nfs_fs.h>
 #include <linux/nfs_page.h>
 #include <linux/module.h>
+#include <linux/math64.h>
 
 #include <asm/system.h>
 #include "pnfs.h"
@@ -113,13 +114,13 @@ void nfs_pageio_init_read_mds(struct nfs_pageio_descriptor *pgio,
 		struct inode *inode)
 {
 	nfs_pageio_init(pgio, inode, &nfs_pageio_read_ops,
-			NFS_SERVER(inode)->rsize, 0);
+			nfs_read_size(NFS_SERVER(inode)), 0);
 }
 
 void nfs_pageio_reset_read_mds(struct nfs_pageio_descriptor *pgio)
 {
 	pgio->pg_ops = &nfs_pageio_read_ops;
-	pgio->pg_bsize = NFS_SERVER(pgio->pg_inode)->rsize;
+	pgio->pg_bsize = nfs_read_size(NFS_SERVER(pgio->pg_inode));
 }
 EXPORT_SYMBOL_GPL(nfs_pageio_reset_read_mds);
 
@@ -385,6 +386,77 @@ static const struct nfs_pageio_ops nfs_pageio_read_ops = {
 	.pg_doio = nfs_generic_pg_readpages,
 };
 
+/* Full-size READs per "adaptive_rsize" decision, windows to hold a size */
+#define NFS_RSIZE_WINDOW	32
+#define NFS_RSIZE_HOLD		16
+
+/*
+ * "adaptive_rsize" picks the read size from how READs perform on this
+ * mount. A retransmitted READ of about the current size means the network
+ * loses them (often whole UDP datagrams, because one IP fragment was
+ * dropped), so the size is halved right away. Otherwise, after every
+ * NFS_RSIZE_WINDOW full-size READs the mean round-trip time per KiB is
+ * computed: the size is doubled as long as that keeps getting cheaper,
+ * up to the rsize of the mount. When doubling did not help, the previous
+ * size is kept for NFS_RSIZE_HOLD windows before trying again.
+ */
+static void nfs_adapt_rsize(struct rpc_task *task, struct nfs_read_data *data)
+{
+	struct nfs_server *server = NFS_SERVER(data->inode);
+	struct rpc_rqst *req = task->tk_rqstp;
+	unsigned int cur, rsize;
+	unsigned long cost;
+
+	if (!(server->flags & NFS_MOUNT_ADAPTIVE_RSIZE) ||
+	    data->ds_clp != NULL || req == NULL || task->tk_status < 0)
+		return;
+
+	spin_lock(&server->rsize_lock);
+	cur = rsize = nfs_read_size(server);
+
+	if (req->rq_ntrans > 1 || task->tk_timeouts != 0) {
+		if (data->args.count <= cur / 2)
+			goto out;
+		rsize = max_t(unsigned int, cur / 2, PAGE_CACHE_SIZE);
+		server->rsize_cost = 0;
+		server->rsize_hold = NFS_RSIZE_HOLD;
+		goto new_window;
+	}
+
+	/* Short READs (small files, EOF) say little about the size */
+	if (data->args.count < cur)
+		goto out;
+	server->rsize_bytes += data->args.count;
+	server->rsize_rtt_ns += ktime_to_ns(req->rq_rtt);
+	if (++server->rsize_reads < NFS_RSIZE_WINDOW)
+		goto out;
+
+	cost = div64_u64(server->rsize_rtt_ns << 10, server->rsize_bytes);
+	if (server->rsize_hold != 0) {
+		server->rsize_hold--;
+	} else if (server->rsize_cost != 0 && cost >= server->rsize_cost) {
+		/* the last doubling did not help */
+		rsize = max_t(unsigned int, cur / 2, PAGE_CACHE_SIZE);
+		server->rsize_cost = 0;
+		server->rsize_hold = NFS_RSIZE_HOLD;
+	} else if (cur < server->rsize) {
+		rsize = min(cur * 2, server->rsize);
+		server->rsize_cost = cost;
+	} else
+		server->rsize_cost = 0;
+
+new_window:
+	server->rsize_reads = 0;
+	server->rsize_bytes = 0;
+	server->rsize_rtt_ns = 0;
+	if (rsize != cur) {
+		dprintk("NFS: %s: rsize %u -> %u\n", __func__, cur, rsize);
+		server->rsize_cur = rsize;
+	}
+out:
+	spin_unlock(&server->rsize_lock);
+}
+
 /*
  * This is the callback from RPC telling us whether a reply was
  * received or some error occurred (timeout or socket shutdown).
@@ -401,6 +473,7 @@ int nfs_readpage_result(struct rpc_task *task, struct nfs_read_data *data)
 		return status;
 
 	nfs_add_stats(data->inode, NFSIOS_SERVERREADBYTES, data->res.count);
+	nfs_adapt_rsize(task, data);
 
 	if (task->tk_status == -ESTALE) {
 		set_bit(NFS_INO_STALE, &NFS_I(data->inode)->flags);
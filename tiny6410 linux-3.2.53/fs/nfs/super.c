@@ -87,6 +87,7 @@ enum {
 	Opt_sharecache, Opt_nosharecache,
 	Opt_resvport, Opt_noresvport,
 	Opt_fscache, Opt_nofscache,
+	Opt_adaptive_rsize, Opt_noadaptive_rsize,
 
 	/* Mount options that take integer arguments */
 	Opt_port,
@@ -147,6 +148,8 @@ static const match_table_t nfs_mount_option_tokens = {
 	{ Opt_nosharecache, "nosharecache" },
 	{ Opt_resvport, "resvport" },
 	{ Opt_noresvport, "noresvport" },
+	{ Opt_adaptive_rsize, "adaptive_rsize" },
+	{ Opt_noadaptive_rsize, "noadaptive_rsize" },
 	{ Opt_fscache, "fsc" },
 	{ Opt_nofscache, "nofsc" },
 
@@ -650,6 +653,7 @@ static void nfs_show_mount_options(struct seq_file *m, struct nfs_server *nfss,
 		{ NFS_MOUNT_NORDIRPLUS, ",nordirplus", "" },
 		{ NFS_MOUNT_UNSHARED, ",nosharecache", "" },
 		{ NFS_MOUNT_NORESVPORT, ",noresvport", "" },
+		{ NFS_MOUNT_ADAPTIVE_RSIZE, ",adaptive_rsize", "" },
 		{ 0, NULL, NULL }
 	};
 	const struct proc_nfs_info *nfs_infop;
@@ -831,6 +835,8 @@ static int nfs_show_stats(struct seq_file *m, struct vfsmount *mnt)
 	seq_printf(m, "\n\tsec:\tflavor=%u", auth->au_ops->au_flavor);
 	if (auth->au_flavor)
 		seq_printf(m, ",pseudoflavor=%u", auth->au_flavor);
+	if (nfss->flags & NFS_MOUNT_ADAPTIVE_RSIZE)
+		seq_printf(m, "\n\tadaptive_rsize:\t%u", nfs_read_size(nfss));
 
 	/*
 	 * Display superblock I/O counters
@@ -868,6 +874,7 @@ static int nfs_show_stats(struct seq_file *m, struct vfsmount *mnt)
 #endif
 	seq_printf(m, "\n");
 
+	rpc_print_rtt_hist(m, nfss->client);
 	rpc_print_iostats(m, nfss->client);
 
 	return 0;
@@ -1207,6 +1214,12 @@ static int nfs_parse_mount_options(char *raw,
 		case Opt_noresvport:
 			mnt->flags |= NFS_MOUNT_NORESVPORT;
 			break;
+		case Opt_adaptive_rsize:
+			mnt->flags |= NFS_MOUNT_ADAPTIVE_RSIZE;
+			break;
+		case Opt_noadaptive_rsize:
+			mnt->flags &= ~NFS_MOUNT_ADAPTIVE_RSIZE;
+			break;
 		case Opt_fscache:
 			mnt->options |= NFS_OPTION_FSCACHE;
 			kfree(mnt->fscache_uniq);
@@ -19,6 +19,8 @@
 static const int nfs_set_port_min = 0;
 static const int nfs_set_port_max = 65535;
 #endif
+static const int nfs_readahead_min = 1;
+static const int nfs_readahead_max = RPC_MAX_SLOT_TABLE;
 static struct ctl_table_header *nfs_callback_sysctl_table;
 
 static ctl_table nfs_cb_sysctls[] = {
@@ -56,6 +58,22 @@ static ctl_table nfs_cb_sysctls[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		.procname	= "nfs_max_readahead",
+		.data		= &nfs_max_readahead,
+		.maxlen		= sizeof(nfs_max_readahead),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= (int *)&nfs_readahead_min,
+		.extra2		= (int *)&nfs_readahead_max,
+	},
+	{
+		.procname	= "nfs_ro_attrtimeo",
+		.data		= &nfs_ro_attrtimeo,
+		.maxlen		= sizeof(nfs_ro_attrtimeo),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_jiffies,
+	},
 	{ }
 };
 
@@ -2899,6 +2899,51 @@ static const struct file_operations dfs_fops = {
 	.llseek = no_llseek,
 };
 
+/*
+ * The "sync_stats" file shows how well 'fsync()' calls share write-buffer
+ * flushes, and how much flash space goes to padding.
+ */
+static ssize_t dfs_sync_stats_read(struct file *file, char __user *u,
+				   size_t count, loff_t *ppos)
+{
+	struct ubifs_info *c = file->private_data;
+	struct ubifs_sync_stats *st = &c->sync_stats;
+	unsigned long secs;
+	u64 pad;
+	char buf[384];
+	int len;
+
+	secs = (jiffies - st->start) / HZ;
+	pad = atomic64_read(&st->pad_bytes);
+	len = snprintf(buf, sizeof(buf),
+		       "fsync_batch_us       %u\n"
+		       "fsyncs               %lld\n"
+		       "fsync_flushes        %lld\n"
+		       "fsync_shared         %lld\n"
+		       "fsync_wait_us        %lld\n"
+		       "wbuf_flushes         %lld\n"
+		       "pad_bytes            %llu\n"
+		       "pad_bytes_per_hour   %llu\n"
+		       "seconds              %lu\n",
+		       c->fsync_batch,
+		       (long long)atomic64_read(&st->fsyncs),
+		       (long long)atomic64_read(&st->fsync_flushes),
+		       (long long)atomic64_read(&st->fsync_shared),
+		       (long long)div_u64(atomic64_read(&st->fsync_wait_ns),
+					  NSEC_PER_USEC),
+		       (long long)atomic64_read(&st->wbuf_syncs),
+		       pad, div_u64(pad * 3600, max(secs, 1UL)), secs);
+
+	return simple_read_from_buffer(u, count, ppos, buf, len);
+}
+
+static const struct file_operations dfs_sync_stats_fops = {
+	.open = dfs_file_open,
+	.read = dfs_sync_stats_read,
+	.owner = THIS_MODULE,
+	.llseek = no_llseek,
+};
+
 /**
  * dbg_debugfs_init_fs - initialize debugfs for UBIFS instance.
  * @c: UBIFS file-system description object
@@ -2993,6 +3038,12 @@ int dbg_debugfs_init_fs(struct ubifs_info *c)
 		goto out_remove;
 	d->dfs_tst_rcvry = dent;
 
+	fname = "sync_stats";
+	dent = debugfs_create_file(fname, S_IRUSR, d->dfs_dir, c,
+				   &dfs_sync_stats_fops);
+	if (IS_ERR_OR_NULL(dent))
+		goto out_remove;
+
 	return 0;
 
 out_remove:
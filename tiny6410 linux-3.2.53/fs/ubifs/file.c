@@ -1319,6 +1319,7 @@ int ubifs_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 		 */
 		return 0;
 
+	atomic64_inc(&c->sync_stats.fsyncs);
 	err = filemap_write_and_wait_range(inode->i_mapping, start, end);
 	if (err)
 		return err;
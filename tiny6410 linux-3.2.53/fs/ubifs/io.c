@@ -66,12 +66,21 @@
  * UBIFS uses padding when it pads to the next min. I/O unit. In this case it
  * uses padding nodes or padding bytes, if the padding node does not fit.
  *
+ * Every 'fsync()' has to flush the write-buffers holding nodes of the inode,
+ * and each flush pads up to the next min. I/O unit. When several tasks call
+ * 'fsync()' at the same time (e.g., several loggers), they may share one
+ * flush: the nodes of all inodes which were written before the flush go to
+ * the flash together, and the other 'fsync()' callers find that there is
+ * nothing left to flush. To make this more likely, 'fsync()' may wait a little
+ * before flushing, see 'fsync_batch_wait()'.
+ *
  * All UBIFS nodes are protected by CRC checksums and UBIFS checks CRC when
  * they are read from the flash media.
  */
 
 #include <linux/crc32.h>
 #include <linux/slab.h>
+#include <linux/delay.h>
 #include "ubifs.h"
 
 /**
@@ -495,6 +504,8 @@ int ubifs_wbuf_sync_nolock(struct ubifs_wbuf *wbuf)
 {
 	struct ubifs_info *c = wbuf->c;
 	int err, dirt, sync_len;
+	ktime_t start;
+	s64 ns;
 
 	cancel_wbuf_timer_nolock(wbuf);
 	if (!wbuf->used || wbuf->lnum == -1)
@@ -523,11 +534,18 @@ int ubifs_wbuf_sync_nolock(struct ubifs_wbuf *wbuf)
 	dirt = sync_len - wbuf->used;
 	if (dirt)
 		ubifs_pad(c, wbuf->buf + wbuf->used, dirt);
+	start = ktime_get();
 	err = ubifs_leb_write(c, wbuf->lnum, wbuf->buf, wbuf->offs, sync_len,
 			      wbuf->dtype);
 	if (err)
 		return err;
 
+	ns = min_t(s64, ktime_to_ns(ktime_sub(ktime_get(), start)), UINT_MAX);
+	wbuf->avg_sync_ns += ((u32)ns >> 3) - (wbuf->avg_sync_ns >> 3);
+	atomic64_inc(&c->sync_stats.wbuf_syncs);
+	atomic64_add(dirt, &c->sync_stats.pad_bytes);
+	wbuf->last_fsync_pid = 0;
+
 	spin_lock(&wbuf->lock);
 	wbuf->offs += sync_len;
 	/*
@@ -1114,14 +1132,47 @@ static int wbuf_has_ino(struct ubifs_wbuf *wbuf, ino_t inum)
 	return ret;
 }
 
+/**
+ * fsync_batch_wait - give concurrent 'fsync()' calls a chance to share a flush.
+ * @c: UBIFS file-system description object
+ * @wbuf: the write-buffer which is going to be flushed
+ *
+ * If the write-buffer was last flushed from 'fsync()' by another task, there
+ * are probably several tasks calling 'fsync()', and it is worth waiting a
+ * little for them to add their nodes to the write-buffer, so that one flush
+ * (and one portion of padding) serves all of them. A task which keeps calling
+ * 'fsync()' alone never waits. The wait is the average flush time of the
+ * write-buffer, but not longer than @c->fsync_batch microseconds.
+ */
+static void fsync_batch_wait(struct ubifs_info *c, struct ubifs_wbuf *wbuf)
+{
+	unsigned int max = c->fsync_batch;
+	unsigned long us;
+	ktime_t start;
+
+	if (!max || !wbuf->last_fsync_pid ||
+	    wbuf->last_fsync_pid == current->pid)
+		return;
+
+	us = min_t(unsigned long, wbuf->avg_sync_ns / NSEC_PER_USEC, max);
+	if (!us)
+		return;
+
+	start = ktime_get();
+	usleep_range(us, us + us / 4);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &c->sync_stats.fsync_wait_ns);
+}
+
 /**
  * ubifs_sync_wbufs_by_inode - synchronize write-buffers for an inode.
  * @c: UBIFS file-system description object
  * @inode: inode to synchronize
  *
  * This function synchronizes write-buffers which contain nodes belonging to
- * @inode. Returns zero in case of success and a negative error code in case of
- * failure.
+ * @inode. If another task flushed the write-buffer meanwhile, nothing has to
+ * be done. Returns zero in case of success and a negative error code in case
+ * of failure.
  */
 int ubifs_sync_wbufs_by_inode(struct ubifs_info *c, struct inode *inode)
 {
@@ -1142,9 +1193,16 @@ int ubifs_sync_wbufs_by_inode(struct ubifs_info *c, struct inode *inode)
 		if (!wbuf_has_ino(wbuf, inode->i_ino))
 			continue;
 
+		fsync_batch_wait(c, wbuf);
+
 		mutex_lock_nested(&wbuf->io_mutex, wbuf->jhead);
-		if (wbuf_has_ino(wbuf, inode->i_ino))
+		if (wbuf_has_ino(wbuf, inode->i_ino)) {
 			err = ubifs_wbuf_sync_nolock(wbuf);
+			if (!err)
+				wbuf->last_fsync_pid = current->pid;
+			atomic64_inc(&c->sync_stats.fsync_flushes);
+		} else
+			atomic64_inc(&c->sync_stats.fsync_shared);
 		mutex_unlock(&wbuf->io_mutex);
 
 		if (err) {
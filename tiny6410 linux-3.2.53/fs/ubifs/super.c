@@ -444,6 +444,9 @@ static int ubifs_show_options(struct seq_file *s, struct vfsmount *mnt)
 			   ubifs_compr_name(c->mount_opts.compr_type));
 	}
 
+	if (c->fsync_batch != UBIFS_DEFAULT_FSYNC_BATCH)
+		seq_printf(s, ",fsync_batch=%u", c->fsync_batch);
+
 	return 0;
 }
 
@@ -938,6 +941,7 @@ static int check_volume_empty(struct ubifs_info *c)
  * Opt_chk_data_crc: check CRCs when reading data nodes
  * Opt_no_chk_data_crc: do not check CRCs when reading data nodes
  * Opt_override_compr: override default compressor
+ * Opt_fsync_batch: maximum 'fsync()' batching wait in microseconds
  * Opt_err: just end of array marker
  */
 enum {
@@ -948,6 +952,7 @@ enum {
 	Opt_chk_data_crc,
 	Opt_no_chk_data_crc,
 	Opt_override_compr,
+	Opt_fsync_batch,
 	Opt_err,
 };
 
@@ -959,6 +964,7 @@ static const match_table_t tokens = {
 	{Opt_chk_data_crc, "chk_data_crc"},
 	{Opt_no_chk_data_crc, "no_chk_data_crc"},
 	{Opt_override_compr, "compr=%s"},
+	{Opt_fsync_batch, "fsync_batch=%u"},
 	{Opt_err, NULL},
 };
 
@@ -1058,6 +1064,18 @@ static int ubifs_parse_options(struct ubifs_info *c, char *options,
 			c->default_compr = c->mount_opts.compr_type;
 			break;
 		}
+		case Opt_fsync_batch:
+		{
+			int us;
+
+			if (match_int(&args[0], &us) || us < 0 ||
+			    us > UBIFS_MAX_FSYNC_BATCH) {
+				ubifs_err("bad fsync_batch value \"%s\"", p);
+				return -EINVAL;
+			}
+			c->fsync_batch = us;
+			break;
+		}
 		default:
 		{
 			unsigned long flag;
@@ -2007,6 +2025,8 @@ static struct ubifs_info *alloc_ubifs_info(struct ubi_volume_desc *ubi)
 		INIT_LIST_HEAD(&c->orph_list);
 		INIT_LIST_HEAD(&c->orph_new);
 		c->no_chk_data_crc = 1;
+		c->fsync_batch = UBIFS_DEFAULT_FSYNC_BATCH;
+		c->sync_stats.start = jiffies;
 
 		c->highest_inum = UBIFS_FIRST_INO;
 		c->lhead_lnum = c->ltail_lnum = UBIFS_LOG_LNUM;
@@ -100,6 +100,14 @@
 #define WBUF_TIMEOUT_SOFTLIMIT 3
 #define WBUF_TIMEOUT_HARDLIMIT 5
 
+/*
+ * Default and maximum time in microseconds 'fsync()' may wait for concurrent
+ * 'fsync()' calls to share a write-buffer flush (the "fsync_batch" mount
+ * option)
+ */
+#define UBIFS_DEFAULT_FSYNC_BATCH 1000
+#define UBIFS_MAX_FSYNC_BATCH 100000
+
 /* Maximum possible inode number (only 32-bit inodes are supported now) */
 #define MAX_INUM 0xFFFFFFFF
 
@@ -669,6 +677,9 @@ typedef int (*ubifs_lpt_scan_callback)(struct ubifs_info *c,
  * @need_sync: non-zero if the timer expired and the wbuf needs sync'ing
  * @next_ino: points to the next position of the following inode number
  * @inodes: stores the inode numbers of the nodes which are in wbuf
+ * @last_fsync_pid: PID of the task which last flushed the write-buffer from
+ *                  'fsync()', zero if the last flush was not from 'fsync()'
+ * @avg_sync_ns: running average of the write-buffer flush time
  *
  * The write-buffer synchronization callback is called when the write-buffer is
  * synchronized in order to notify how much space was wasted due to
@@ -700,6 +711,8 @@ struct ubifs_wbuf {
 	unsigned int need_sync:1;
 	int next_ino;
 	ino_t *inodes;
+	pid_t last_fsync_pid;
+	unsigned int avg_sync_ns;
 };
 
 /**
@@ -941,6 +954,27 @@ struct ubifs_mount_opts {
 	unsigned int compr_type:2;
 };
 
+/**
+ * struct ubifs_sync_stats - write-buffer synchronization statistics.
+ * @wbuf_syncs: count of write-buffer flushes
+ * @pad_bytes: bytes of padding written by write-buffer flushes
+ * @fsyncs: count of 'fsync()' calls
+ * @fsync_flushes: count of write-buffer flushes done by 'fsync()'
+ * @fsync_shared: how many times 'fsync()' found that its nodes were already
+ *                flushed by a concurrent write-buffer flush
+ * @fsync_wait_ns: total time 'fsync()' waited for other 'fsync()' calls
+ * @start: when the statistics were started (jiffies)
+ */
+struct ubifs_sync_stats {
+	atomic64_t wbuf_syncs;
+	atomic64_t pad_bytes;
+	atomic64_t fsyncs;
+	atomic64_t fsync_flushes;
+	atomic64_t fsync_shared;
+	atomic64_t fsync_wait_ns;
+	unsigned long start;
+};
+
 /**
  * struct ubifs_budg_info - UBIFS budgeting information.
  * @idx_growth: amount of bytes budgeted for index growth
@@ -1011,6 +1045,10 @@ struct ubifs_debug_info;
  * @bg_bud_bytes: number of bud bytes when background commit is initiated
  * @old_buds: buds to be released after commit ends
  * @max_bud_cnt: maximum number of buds
+ * @fsync_batch: longest time in microseconds 'fsync()' waits for concurrent
+ *               'fsync()' calls to share a write-buffer flush (%0 - do not
+ *               wait)
+ * @sync_stats: write-buffer synchronization statistics
  *
  * @commit_sem: synchronizes committer with other processes
  * @cmt_state: commit state
@@ -1253,6 +1291,8 @@ struct ubifs_info {
 	long long bg_bud_bytes;
 	struct list_head old_buds;
 	int max_bud_cnt;
+	unsigned int fsync_batch;
+	struct ubifs_sync_stats sync_stats;
 
 	struct rw_semaphore commit_sem;
 	int cmt_state;
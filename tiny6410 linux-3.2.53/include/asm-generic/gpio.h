@@ -60,6 +60,12 @@ struct device_node;
  *	returns either the value actually sensed, or zero
  * @direction_output: configures signal "offset" as output, or returns error
  * @set: assigns output value for signal "offset"
+ * @get_multiple: optional; returns the values of the signals selected by
+ *	"mask" (bit N is signal N) in one access, for chips with at most
+ *	BITS_PER_LONG signals
+ * @set_multiple: optional; assigns the values in "bits" to the output
+ *	signals selected by "mask" atomically, for chips with at most
+ *	BITS_PER_LONG signals
  * @to_irq: optional hook supporting non-static gpio_to_irq() mappings;
  *	implementation may not sleep
  * @dbg_show: optional routine to show contents in debugfs; default code
@@ -109,6 +115,11 @@ struct gpio_chip {
 
 	void			(*set)(struct gpio_chip *chip,
 						unsigned offset, int value);
+	unsigned long		(*get_multiple)(struct gpio_chip *chip,
+						unsigned long mask);
+	void			(*set_multiple)(struct gpio_chip *chip,
+						unsigned long mask,
+						unsigned long bits);
 
 	int			(*to_irq)(struct gpio_chip *chip,
 						unsigned offset);
@@ -159,6 +170,10 @@ extern int gpio_set_debounce(unsigned gpio, unsigned debounce);
 extern int gpio_get_value_cansleep(unsigned gpio);
 extern void gpio_set_value_cansleep(unsigned gpio, int value);
 
+extern unsigned long gpio_get_multiple(unsigned base, unsigned long mask);
+extern void gpio_set_multiple(unsigned base, unsigned long mask,
+			      unsigned long bits);
+
 
 /* A platform's <asm/gpio.h> code may want to inline the I/O calls when
  * the GPIO is constant and refers to some always-present controller,
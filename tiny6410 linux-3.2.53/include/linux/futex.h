@@ -185,6 +185,19 @@ static inline void exit_pi_state_list(struct task_struct *curr)
 {
 }
 #endif
+
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+extern int futex_mm_share(struct mm_struct *mm);
+extern void futex_mm_free(struct mm_struct *mm);
+#else
+static inline int futex_mm_share(struct mm_struct *mm)
+{
+	return 0;
+}
+static inline void futex_mm_free(struct mm_struct *mm)
+{
+}
+#endif
 #endif /* __KERNEL__ */
 
 #define FUTEX_OP_SET		0	/* *(int *)UADDR2 = OPARG; */
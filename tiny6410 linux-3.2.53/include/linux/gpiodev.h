@@ -0,0 +1,64 @@
+#ifndef _LINUX_GPIODEV_H
+#define _LINUX_GPIODEV_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Userspace interface of /dev/gpio, see Documentation/gpio.txt.
+ */
+
+/**
+ * struct gpio_multiple - values of several GPIOs
+ * @base: GPIO number corresponding to bit 0 of @mask and @bits
+ * @mask: bit N selects GPIO @base + N
+ * @bits: bit N holds the value of GPIO @base + N
+ */
+struct gpio_multiple {
+	__u32	base;
+	__u32	mask;
+	__u32	bits;
+};
+
+/**
+ * struct gpio_claim - claim GPIOs of one controller for an open file
+ * @base: GPIO number corresponding to bit 0 of @mask, @output and @bits
+ * @mask: bit N selects GPIO @base + N; all must be on the same controller
+ * @output: GPIOs to set up as outputs; the others become inputs
+ * @bits: initial values of the outputs
+ */
+struct gpio_claim {
+	__u32	base;
+	__u32	mask;
+	__u32	output;
+	__u32	bits;
+};
+
+/**
+ * struct gpio_batch - sequence of values for claimed outputs
+ * @values: user pointer to an array of @count __u32 values
+ * @count: number of values
+ * @mask: outputs to drive, relative to the claimed base
+ * @delay_ns: delay between two values (at most 1ms), 0 for none
+ * @padding: reserved, set to zero
+ */
+struct gpio_batch {
+	__u64	values;
+	__u32	count;
+	__u32	mask;
+	__u32	delay_ns;
+	__u32	padding;
+};
+
+#define GPIO_IOC_MAGIC		0xB4
+
+/* Read the selected GPIOs into @bits */
+#define GPIO_GET_MULTIPLE	_IOWR(GPIO_IOC_MAGIC, 0x01, struct gpio_multiple)
+/* Write @bits to the selected GPIOs; GPIOs of one bank change together */
+#define GPIO_SET_MULTIPLE	_IOW(GPIO_IOC_MAGIC, 0x02, struct gpio_multiple)
+/* Claim GPIOs for this file; they are released when it is closed */
+#define GPIO_CLAIM		_IOW(GPIO_IOC_MAGIC, 0x03, struct gpio_claim)
+/* Write a sequence of values to claimed outputs; returns values written */
+#define GPIO_WRITE_BATCH	_IOW(GPIO_IOC_MAGIC, 0x04, struct gpio_batch)
+
+#endif /* _LINUX_GPIODEV_H */
@@ -106,6 +106,9 @@ extern void brioctl_set(int (*ioctl_hook)(struct net *, unsigned int, void __use
 typedef int br_should_route_hook_t(struct sk_buff *skb);
 extern br_should_route_hook_t __rcu *br_should_route_hook;
 
+/* number of ebtables tables that can affect bridged frames */
+extern atomic_t br_ebt_tables_active;
+
 #endif
 
 #endif
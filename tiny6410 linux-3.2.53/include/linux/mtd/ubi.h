@@ -123,6 +123,8 @@ struct ubi_volume_info {
  *                  time (MTD write buffer size)
  * @ro_mode: if this device is in read-only mode
  * @cdev: UBI character device major and minor numbers
+ * @bytes_written: bytes written to the flash since the device was attached,
+ *                 including headers and wear-leveling copies
  *
  * Note, @leb_size is the logical eraseblock size offered by the UBI device.
  * Volumes of this UBI device may have smaller logical eraseblock size if their
@@ -152,6 +154,7 @@ struct ubi_device_info {
 	int max_write_size;
 	int ro_mode;
 	dev_t cdev;
+	long long bytes_written;
 };
 
 /*
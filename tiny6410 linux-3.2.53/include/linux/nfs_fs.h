@@ -55,6 +55,7 @@
 #include <linux/nfs4.h>
 #include <linux/nfs_xdr.h>
 #include <linux/nfs_fs_sb.h>
+#include <linux/nfs_mount.h>
 
 #include <linux/mempool.h>
 
@@ -261,16 +262,40 @@ static inline const struct nfs_rpc_ops *NFS_PROTO(const struct inode *inode)
 	return NFS_SERVER(inode)->nfs_client->rpc_ops;
 }
 
+/*
+ * Attribute cache timeout for read-only mounts (fs.nfs.nfs_ro_attrtimeo).
+ * Nothing on the client changes such a file system, so unless "noac" was
+ * given, attributes are cached for at least this long, and opens do not
+ * force a close-to-open GETATTR.
+ */
+extern int nfs_ro_attrtimeo;
+
+static inline int nfs_ro_attrcache(const struct inode *inode)
+{
+	return nfs_ro_attrtimeo > 0 && (inode->i_sb->s_flags & MS_RDONLY) &&
+		!(NFS_SERVER(inode)->flags & NFS_MOUNT_NOAC);
+}
+
+static inline unsigned nfs_ro_attrtimeo_min(const struct inode *inode,
+					    unsigned timeo)
+{
+	if (!nfs_ro_attrcache(inode))
+		return timeo;
+	return max_t(unsigned, timeo, nfs_ro_attrtimeo);
+}
+
 static inline unsigned NFS_MINATTRTIMEO(const struct inode *inode)
 {
 	struct nfs_server *nfss = NFS_SERVER(inode);
-	return S_ISDIR(inode->i_mode) ? nfss->acdirmin : nfss->acregmin;
+	return nfs_ro_attrtimeo_min(inode, S_ISDIR(inode->i_mode) ?
+				    nfss->acdirmin : nfss->acregmin);
 }
 
 static inline unsigned NFS_MAXATTRTIMEO(const struct inode *inode)
 {
 	struct nfs_server *nfss = NFS_SERVER(inode);
-	return S_ISDIR(inode->i_mode) ? nfss->acdirmax : nfss->acregmax;
+	return nfs_ro_attrtimeo_min(inode, S_ISDIR(inode->i_mode) ?
+				    nfss->acdirmax : nfss->acregmax);
 }
 
 static inline int NFS_STALE(const struct inode *inode)
@@ -343,6 +368,11 @@ static inline int nfs_verify_change_attribute(struct inode *dir, unsigned long c
 	return chattr == NFS_I(dir)->cache_change_attribute;
 }
 
+/*
+ * linux/fs/nfs/client.c
+ */
+extern int nfs_max_readahead;
+
 /*
  * linux/fs/nfs/inode.c
  */
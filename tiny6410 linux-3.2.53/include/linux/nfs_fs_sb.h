@@ -106,6 +106,7 @@ struct nfs_server {
 	unsigned int		caps;		/* server capabilities */
 	unsigned int		rsize;		/* read size */
 	unsigned int		rpages;		/* read size (in pages) */
+	unsigned int		rsize_cur;	/* adaptive read size, or 0 */
 	unsigned int		wsize;		/* write size */
 	unsigned int		wpages;		/* write size (in pages) */
 	unsigned int		wtmult;		/* server disk block size */
@@ -131,6 +132,14 @@ struct nfs_server {
 	struct fscache_cookie	*fscache;	/* superblock cookie */
 #endif
 
+	/* "adaptive_rsize" state, updated as READs complete */
+	spinlock_t		rsize_lock;
+	unsigned int		rsize_reads;	/* READs in this window */
+	unsigned int		rsize_hold;	/* windows before next change */
+	u64			rsize_bytes;	/* bytes read in this window */
+	u64			rsize_rtt_ns;	/* summed RTT in this window */
+	unsigned long		rsize_cost;	/* ns per KiB, last window */
+
 	u32			pnfs_blksize;	/* layout_blksize attr */
 #ifdef CONFIG_NFS_V4
 	u32			attr_bitmask[3];/* V4 bitmask representing the set
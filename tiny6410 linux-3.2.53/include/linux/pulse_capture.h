@@ -0,0 +1,70 @@
+#ifndef _LINUX_PULSE_CAPTURE_H
+#define _LINUX_PULSE_CAPTURE_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Userspace interface of /dev/pulse-capture, see
+ * Documentation/misc-devices/pulse-capture.txt.
+ */
+
+/* struct pulse_capture_setup.mode */
+#define PULSE_CAPTURE_TIMESTAMP	1	/* one event per edge on a GPIO */
+#define PULSE_CAPTURE_COUNT	2	/* edges counted by a timer */
+
+/* struct pulse_capture_setup.flags, timestamp mode */
+#define PULSE_CAPTURE_RISING	(1 << 0)
+#define PULSE_CAPTURE_FALLING	(1 << 1)
+
+/**
+ * struct pulse_capture_setup - select what an open file captures
+ * @mode: PULSE_CAPTURE_TIMESTAMP or PULSE_CAPTURE_COUNT
+ * @source: GPIO number (timestamp mode) or timer number (count mode)
+ * @flags: edges to capture in timestamp mode
+ * @batch: timestamp mode: events queued before a reader is woken;
+ *	count mode: edges counted per event
+ * @timeout_ms: longest a blocking read waits for a full batch, 0 for ever
+ * @padding: must be zero
+ */
+struct pulse_capture_setup {
+	__u32	mode;
+	__u32	source;
+	__u32	flags;
+	__u32	batch;
+	__u32	timeout_ms;
+	__u32	padding;
+};
+
+/**
+ * struct pulse_event - one record returned by read()
+ * @time_ns: CLOCK_MONOTONIC time of the event
+ * @count: edges seen up to and including this event
+ */
+struct pulse_event {
+	__u64	time_ns;
+	__u64	count;
+};
+
+/**
+ * struct pulse_capture_status - current state of a capture
+ * @count: edges seen so far, including those not yet queued
+ * @time_ns: CLOCK_MONOTONIC time at which @count was read
+ * @overruns: events dropped because the buffer was full
+ * @queued: events waiting to be read
+ */
+struct pulse_capture_status {
+	__u64	count;
+	__u64	time_ns;
+	__u32	overruns;
+	__u32	queued;
+};
+
+#define PULSE_CAPTURE_IOC_MAGIC	0xB5
+
+#define PULSE_CAPTURE_SETUP	_IOW(PULSE_CAPTURE_IOC_MAGIC, 0x01, \
+				     struct pulse_capture_setup)
+#define PULSE_CAPTURE_STATUS	_IOR(PULSE_CAPTURE_IOC_MAGIC, 0x02, \
+				     struct pulse_capture_status)
+
+#endif /* _LINUX_PULSE_CAPTURE_H */
@@ -234,6 +234,9 @@ enum
 	LINUX_MIB_TCPREQQFULLDROP,		/* TCPReqQFullDrop */
 	LINUX_MIB_TCPCHALLENGEACK,		/* TCPChallengeACK */
 	LINUX_MIB_TCPSYNCHALLENGE,		/* TCPSYNChallenge */
+	LINUX_MIB_TCPIDLERCVSHRINK,		/* TCPIdleRcvShrink */
+	LINUX_MIB_TCPIDLESNDPAGEFREE,		/* TCPIdleSndPageFree */
+	LINUX_MIB_TCPOFOEARLYCOLLAPSE,		/* TCPOFOEarlyCollapse */
 	__LINUX_MIB_MAX
 };
 
@@ -30,6 +30,13 @@
 
 #define RPC_IOSTATS_VERS	"1.0"
 
+/*
+ * RTT histogram buckets: the first counts replies within 128 usecs,
+ * each next one up to twice as long, the last one everything slower.
+ */
+#define RPC_IOSTATS_HIST	16
+#define RPC_IOSTATS_HIST_SHIFT	7
+
 struct rpc_iostats {
 	/*
 	 * These counters give an idea about how many request
@@ -62,6 +69,12 @@ struct rpc_iostats {
 	ktime_t			om_queue,	/* queued for xmit */
 				om_rtt,		/* RPC RTT */
 				om_execute;	/* RPC execution */
+
+	/*
+	 * The distribution of the RTT, to tell a few very slow requests
+	 * (lost replies, busy server) from a generally slow network.
+	 */
+	unsigned long		om_rtt_hist[RPC_IOSTATS_HIST];
 } ____cacheline_aligned;
 
 struct rpc_task;
@@ -76,6 +89,7 @@ struct rpc_clnt;
 struct rpc_iostats *	rpc_alloc_iostats(struct rpc_clnt *);
 void			rpc_count_iostats(struct rpc_task *);
 void			rpc_print_iostats(struct seq_file *, struct rpc_clnt *);
+void			rpc_print_rtt_hist(struct seq_file *, struct rpc_clnt *);
 void			rpc_free_iostats(struct rpc_iostats *);
 
 #else  /*  CONFIG_PROC_FS  */
@@ -83,6 +97,7 @@ void			rpc_free_iostats(struct rpc_iostats *);
 static inline struct rpc_iostats *rpc_alloc_iostats(struct rpc_clnt *clnt) { return NULL; }
 static inline void rpc_count_iostats(struct rpc_task *task) {}
 static inline void rpc_print_iostats(struct seq_file *seq, struct rpc_clnt *clnt) {}
+static inline void rpc_print_rtt_hist(struct seq_file *seq, struct rpc_clnt *clnt) {}
 static inline void rpc_free_iostats(struct rpc_iostats *stats) {}
 
 #endif  /*  CONFIG_PROC_FS  */
@@ -18,6 +18,7 @@
 #define _LINUX_UDP_H
 
 #include <linux/types.h>
+#include <linux/if_packet.h>
 
 struct udphdr {
 	__be16	source;
@@ -29,12 +30,44 @@ struct udphdr {
 /* UDP socket options */
 #define UDP_CORK	1	/* Never send partially complete segments */
 #define UDP_ENCAP	100	/* Set the socket to accept encapsulated packets */
+#define UDP_TX_RING	101	/* mmap()ed transmit ring, struct tpacket_req */
+#define UDP_RING_STATS	102	/* struct udp_ring_stats */
+#define UDP_RX_RING	103	/* mmap()ed receive ring, struct tpacket_req3 */
 
 /* UDP encapsulation types */
 #define UDP_ENCAP_ESPINUDP_NON_IKE	1 /* draft-ietf-ipsec-nat-t-ike-00/01 */
 #define UDP_ENCAP_ESPINUDP	2 /* draft-ietf-ipsec-udp-encaps-06 */
 #define UDP_ENCAP_L2TPINUDP	3 /* rfc2661 */
 
+/*
+ * Frame header of the memory mapped UDP rings.  The ring geometry is set
+ * with a struct tpacket_req (transmit) or tpacket_req3 (receive, block
+ * mode) and the ownership words use the TP_STATUS_* values of the packet
+ * socket rings; see Documentation/networking/udp_ring.txt
+ */
+struct udp_ring_hdr {
+	__u32		ur_status;
+	__u32		ur_len;		/* datagram payload length */
+	__be32		ur_addr;	/* peer address, 0 for the connected peer */
+	__be16		ur_port;	/* peer port */
+	__u16		ur_pad;
+	__u32		ur_next_offset;	/* rx: next datagram in block, or 0 */
+	__u32		ur_sec;		/* rx: receive timestamp */
+	__u32		ur_nsec;
+};
+
+#define UDP_RING_HDRLEN		TPACKET_ALIGN(sizeof(struct udp_ring_hdr))
+
+struct udp_ring_stats {
+	__u32		tx_frames;	/* datagrams sent from the ring */
+	__u32		tx_errors;	/* frames rejected or failed to send */
+	__u32		tx_kicks;	/* flush requests */
+	__u32		rx_frames;	/* datagrams stored in the ring */
+	__u32		rx_drops;	/* datagrams dropped, ring full or too big */
+	__u32		rx_blocks;	/* blocks handed to userspace */
+	__u32		rx_timeouts;	/* ... of which retired by the timer */
+};
+
 #ifdef __KERNEL__
 #include <net/inet_sock.h>
 #include <linux/skbuff.h>
@@ -81,6 +114,9 @@ struct udp_sock {
 	 * For encapsulation sockets.
 	 */
 	int (*encap_rcv)(struct sock *sk, struct sk_buff *skb);
+#ifdef CONFIG_UDP_RING
+	struct udp_ring_sock __rcu *ring; /* mmap()ed rings, see udp_ring.c */
+#endif
 };
 
 static inline struct udp_sock *udp_sk(const struct sock *sk)
@@ -243,6 +243,20 @@ extern void fib_select_multipath(struct fib_result *res);
 extern void fib_trie_init(void);
 extern struct fib_table *fib_trie_table(u32 id);
 
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+extern atomic_t fib_cache_genid;
+
+/* Any change to routes or nexthop state invalidates all lookup caches */
+static inline void fib_cache_invalidate(void)
+{
+	atomic_inc(&fib_cache_genid);
+}
+#else
+static inline void fib_cache_invalidate(void)
+{
+}
+#endif
+
 static inline void fib_combine_itag(u32 *itag, const struct fib_result *res)
 {
 #ifdef CONFIG_IP_ROUTE_CLASSID
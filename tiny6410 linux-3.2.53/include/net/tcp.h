@@ -129,6 +129,11 @@ extern void tcp_time_wait(struct sock *sk, int state, int timeo);
 						 * most likely due to retrans in 3WHS.
 						 */
 
+#define TCP_IDLE_SHRINK_MIN ((unsigned)(3*HZ))	/* minimal receive idle time before
+						 * tcp_low_footprint shrinks the
+						 * receive buffer
+						 */
+
 #define TCP_RESOURCE_PROBE_INTERVAL ((unsigned)(HZ/2U)) /* Maximal interval between probes
 					                 * for local resources.
 					                 */
@@ -238,6 +243,7 @@ extern int sysctl_tcp_tw_reuse;
 extern int sysctl_tcp_frto;
 extern int sysctl_tcp_frto_response;
 extern int sysctl_tcp_low_latency;
+extern int sysctl_tcp_low_footprint;
 extern int sysctl_tcp_dma_copybreak;
 extern int sysctl_tcp_nometrics_save;
 extern int sysctl_tcp_moderate_rcvbuf;
@@ -1024,6 +1030,8 @@ static inline void tcp_openreq_init(struct request_sock *req,
 }
 
 extern void tcp_enter_memory_pressure(struct sock *sk);
+extern void tcp_shrink_idle_rcvbuf(struct sock *sk);
+extern void tcp_free_idle_sndpage(struct sock *sk);
 
 static inline int keepalive_intvl_when(const struct tcp_sock *tp)
 {
@@ -258,6 +258,90 @@ extern void udp4_proc_exit(void);
 
 extern void udp_init(void);
 
+#ifdef CONFIG_UDP_RING
+/* net/ipv4/udp_ring.c */
+struct udp_ring_buf {
+	char			**pg_vec;
+	unsigned int		pg_vec_order;
+	unsigned int		pg_vec_pages;
+	unsigned int		pg_vec_len;
+	unsigned int		frames_per_block;
+	unsigned int		frame_size;
+	unsigned int		frame_max;
+	unsigned int		head;
+};
+
+/* Receive side block state, protected by lock */
+struct udp_ring_blk {
+	spinlock_t		lock;
+	unsigned int		cur;		/* block being filled */
+	unsigned int		tail;		/* oldest block not yet returned */
+	unsigned int		offset;		/* fill offset in current block */
+	unsigned int		first_offset;	/* first datagram in a block */
+	unsigned int		max_len;	/* largest datagram accepted */
+	unsigned int		num_pkts;
+	unsigned int		open:1,
+				losing:1;
+	struct udp_ring_hdr	*last;		/* last datagram stored */
+	struct timespec		ts_first;
+	struct timespec		ts_last;
+	u64			seq;
+	unsigned long		tov;		/* retire timeout, jiffies */
+	struct timer_list	retire_timer;
+};
+
+struct udp_ring_sock {
+	struct mutex		lock;		/* ring setup, mmap and flush */
+	atomic_t		mapped;
+	struct udp_ring_buf	rx;
+	struct udp_ring_buf	tx;
+	struct udp_ring_blk	blk;
+	struct udp_ring_stats	stats;
+};
+
+extern int udp_ring_setsockopt(struct sock *sk, int optname,
+			       char __user *optval, unsigned int optlen);
+extern int udp_ring_getsockopt(struct sock *sk, int optname,
+			       char __user *optval, int __user *optlen);
+extern int udp_ring_sendmsg(struct sock *sk, struct msghdr *msg);
+extern int udp_ring_rcv(struct sock *sk, struct sk_buff *skb);
+extern unsigned int udp_ring_poll(struct sock *sk);
+extern void udp_ring_destroy(struct sock *sk);
+extern int udp_ring_mmap(struct file *file, struct socket *sock,
+			 struct vm_area_struct *vma);
+
+/*
+ * The rings are only detached when the socket is destroyed, so callers
+ * in process context that hold a reference to the file may use them
+ * without RCU.  The receive path must use rcu_dereference().
+ */
+static inline struct udp_ring_sock *udp_ring_sk(const struct sock *sk)
+{
+	return rcu_dereference_protected(udp_sk(sk)->ring, 1);
+}
+
+static inline bool udp_ring_tx_active(const struct sock *sk)
+{
+	const struct udp_ring_sock *ur = udp_ring_sk(sk);
+
+	return ur && ur->tx.pg_vec;
+}
+
+static inline bool udp_ring_rx_active(const struct sock *sk)
+{
+	const struct udp_ring_sock *ur;
+	bool active;
+
+	rcu_read_lock();
+	ur = rcu_dereference(udp_sk(sk)->ring);
+	active = ur && ur->rx.pg_vec;
+	rcu_read_unlock();
+	return active;
+}
+#else
+#define udp_ring_mmap	sock_no_mmap
+#endif
+
 extern int udp4_ufo_send_check(struct sk_buff *skb);
 extern struct sk_buff *udp4_ufo_fragment(struct sk_buff *skb, u32 features);
 #endif	/* _UDP_H */
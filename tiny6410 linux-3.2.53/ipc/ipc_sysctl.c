@@ -211,6 +211,14 @@ static struct ctl_table ipc_kern_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_ipc_dointvec,
 	},
+	{
+		.procname	= "msgdirect",
+		.data		= &init_ipc_ns.msg_ctldirect,
+		.maxlen		= sizeof (init_ipc_ns.msg_ctldirect),
+		.mode		= 0644,
+		.proc_handler	= proc_ipc_dointvec_minmax,
+		.extra1		= &zero,
+	},
 	{
 		.procname	= "sem",
 		.data		= &init_ipc_ns.sem_ctls,
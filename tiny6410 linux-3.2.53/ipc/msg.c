@@ -37,11 +37,25 @@
 #include <linux/rwsem.h>
 #include <linux/nsproxy.h>
 #include <linux/ipc_namespace.h>
+#include <linux/highmem.h>
 
 #include <asm/current.h>
 #include <asm/uaccess.h>
 #include "util.h"
 
+/*
+ * User pages pinned for a direct transfer, see msgdirect in
+ * Documentation/sysctl/kernel.txt. For a receiver, the sender fills in
+ * the type and length of the message it copied.
+ */
+struct msg_pages {
+	struct page		**pages;
+	int			nr;
+	unsigned int		offset;		/* of the data in pages[0] */
+	size_t			len;
+	long			type;
+};
+
 /*
  * one msg_receiver structure for each sleeping receiver:
  */
@@ -53,9 +67,15 @@ struct msg_receiver {
 	long			r_msgtype;
 	long			r_maxsize;
 
+	struct msg_pages	*r_pages;	/* buffer for a direct copy */
+
 	struct msg_msg		*volatile r_msg;
 };
 
+/* r_msg of a receiver whose buffer the sender has filled directly */
+static char msg_direct_marker;
+#define MSG_DIRECT		((struct msg_msg *)&msg_direct_marker)
+
 /* one msg_sender for each sleeping sender */
 struct msg_sender {
 	struct list_head	list;
@@ -112,6 +132,7 @@ void msg_init_ns(struct ipc_namespace *ns)
 {
 	ns->msg_ctlmax = MSGMAX;
 	ns->msg_ctlmnb = MSGMNB;
+	ns->msg_ctldirect = 0;
 
 	recompute_msgmni(ns);
 
@@ -597,7 +618,88 @@ static int testmsg(struct msg_msg *msg, long type, int mode)
 	return 0;
 }
 
-static inline int pipelined_send(struct msg_queue *msq, struct msg_msg *msg)
+static inline int msg_direct(struct ipc_namespace *ns, size_t msgsz)
+{
+	return ns->msg_ctldirect > 0 && msgsz >= ns->msg_ctldirect;
+}
+
+static void msg_unpin(struct msg_pages *mp, int dirty)
+{
+	int i;
+
+	for (i = 0; i < mp->nr; i++) {
+		if (dirty)
+			set_page_dirty_lock(mp->pages[i]);
+		put_page(mp->pages[i]);
+	}
+	kfree(mp->pages);
+	mp->pages = NULL;
+}
+
+/*
+ * Pin the user buffer of a sender (write == 0) or receiver (write == 1)
+ * for a direct copy. Errors are not reported: the caller just uses the
+ * normal copy, which reports them as before.
+ */
+static void msg_pin(struct msg_pages *mp, void __user *buf, size_t len,
+		    int write)
+{
+	unsigned long start = (unsigned long)buf;
+	int nr;
+
+	mp->offset = start & ~PAGE_MASK;
+	mp->len = len;
+	mp->nr = 0;
+	nr = DIV_ROUND_UP(mp->offset + len, PAGE_SIZE);
+
+	mp->pages = kmalloc(nr * sizeof(struct page *), GFP_KERNEL);
+	if (!mp->pages)
+		return;
+
+	mp->nr = get_user_pages_fast(start & PAGE_MASK, nr, write, mp->pages);
+	if (mp->nr < nr) {
+		if (mp->nr < 0)
+			mp->nr = 0;
+		msg_unpin(mp, 0);
+	}
+}
+
+/* Copy @len bytes between pinned buffers, called with the queue locked */
+static void msg_copy_pages(struct msg_pages *dst, struct msg_pages *src,
+			   size_t len)
+{
+	size_t doff = dst->offset, soff = src->offset;
+
+	while (len) {
+		struct page *dpage = dst->pages[doff >> PAGE_SHIFT];
+		struct page *spage = src->pages[soff >> PAGE_SHIFT];
+		size_t dpo = doff & ~PAGE_MASK, spo = soff & ~PAGE_MASK;
+		size_t n = min_t(size_t, len,
+				 PAGE_SIZE - max(dpo, spo));
+		char *d, *s;
+
+		d = kmap_atomic(dpage);
+		s = kmap_atomic(spage);
+		memcpy(d + dpo, s + spo, n);
+		kunmap_atomic(s);
+		kunmap_atomic(d);
+		flush_dcache_page(dpage);
+
+		doff += n;
+		soff += n;
+		len -= n;
+	}
+}
+
+/*
+ * Hand @msg to the first receiver that waits for it. With @src, @msg
+ * only has a header and the data is copied from the sender's pinned
+ * pages straight into the receiver's. That only works if the receiver
+ * has pinned its buffer too; otherwise nothing is done and the caller
+ * has to load the data and try again.
+ */
+static inline int pipelined_send(struct msg_queue *msq, struct msg_msg *msg,
+				 struct msg_pages *src)
 {
 	struct list_head *tmp;
 
@@ -611,6 +713,10 @@ static inline int pipelined_send(struct msg_queue *msq, struct msg_msg *msg)
 		    !security_msg_queue_msgrcv(msq, msg, msr->r_tsk,
 					       msr->r_msgtype, msr->r_mode)) {
 
+			if (src && msr->r_maxsize >= msg->m_ts &&
+			    (!msr->r_pages || msr->r_pages->len < msg->m_ts))
+				return 0;
+
 			list_del(&msr->r_list);
 			if (msr->r_maxsize < msg->m_ts) {
 				msr->r_msg = NULL;
@@ -618,12 +724,22 @@ static inline int pipelined_send(struct msg_queue *msq, struct msg_msg *msg)
 				smp_mb();
 				msr->r_msg = ERR_PTR(-E2BIG);
 			} else {
+				struct msg_msg *deliver = msg;
+
+				if (src) {
+					msg_copy_pages(msr->r_pages, src,
+						       msg->m_ts);
+					msr->r_pages->len = msg->m_ts;
+					msr->r_pages->type = msg->m_type;
+					deliver = MSG_DIRECT;
+				}
+
 				msr->r_msg = NULL;
 				msq->q_lrpid = task_pid_vnr(msr->r_tsk);
 				msq->q_rtime = get_seconds();
 				wake_up_process(msr->r_tsk);
 				smp_mb();
-				msr->r_msg = msg;
+				msr->r_msg = deliver;
 
 				return 1;
 			}
@@ -637,6 +753,7 @@ long do_msgsnd(int msqid, long mtype, void __user *mtext,
 {
 	struct msg_queue *msq;
 	struct msg_msg *msg;
+	struct msg_pages src = { .pages = NULL };
 	int err;
 	struct ipc_namespace *ns;
 
@@ -647,9 +764,20 @@ long do_msgsnd(int msqid, long mtype, void __user *mtext,
 	if (mtype < 1)
 		return -EINVAL;
 
-	msg = load_msg(mtext, msgsz);
-	if (IS_ERR(msg))
-		return PTR_ERR(msg);
+	/*
+	 * For a direct copy to a waiting receiver, only the header is
+	 * loaded and the data is left in the pinned user pages.
+	 */
+	if (msg_direct(ns, msgsz))
+		msg_pin(&src, mtext, msgsz, 0);
+
+load:
+	msg = load_msg(mtext, src.pages ? 0 : msgsz);
+	if (IS_ERR(msg)) {
+		err = PTR_ERR(msg);
+		msg = NULL;
+		goto out_free;
+	}
 
 	msg->m_type = mtype;
 	msg->m_ts = msgsz;
@@ -703,15 +831,29 @@ long do_msgsnd(int msqid, long mtype, void __user *mtext,
 	msq->q_lspid = task_tgid_vnr(current);
 	msq->q_stime = get_seconds();
 
-	if (!pipelined_send(msq, msg)) {
-		/* no one is waiting for this message, enqueue it */
-		list_add_tail(&msg->m_list, &msq->q_messages);
-		msq->q_cbytes += msgsz;
-		msq->q_qnum++;
-		atomic_add(msgsz, &ns->msg_bytes);
-		atomic_inc(&ns->msg_hdrs);
+	if (pipelined_send(msq, msg, src.pages ? &src : NULL)) {
+		/* after a direct copy, the header is left to free */
+		if (!src.pages)
+			msg = NULL;
+		err = 0;
+		goto out_unlock_free;
 	}
 
+	if (src.pages) {
+		/* no direct copy possible, send a normal message */
+		msg_unlock(msq);
+		free_msg(msg);
+		msg_unpin(&src, 0);
+		goto load;
+	}
+
+	/* no one is waiting for this message, enqueue it */
+	list_add_tail(&msg->m_list, &msq->q_messages);
+	msq->q_cbytes += msgsz;
+	msq->q_qnum++;
+	atomic_add(msgsz, &ns->msg_bytes);
+	atomic_inc(&ns->msg_hdrs);
+
 	err = 0;
 	msg = NULL;
 
@@ -720,6 +862,8 @@ out_unlock_free:
 out_free:
 	if (msg != NULL)
 		free_msg(msg);
+	if (src.pages)
+		msg_unpin(&src, 0);
 	return err;
 }
 
@@ -757,6 +901,7 @@ long do_msgrcv(int msqid, long *pmtype, void __user *mtext,
 {
 	struct msg_queue *msq;
 	struct msg_msg *msg;
+	struct msg_pages dst = { .pages = NULL };
 	int mode;
 	struct ipc_namespace *ns;
 
@@ -765,9 +910,15 @@ long do_msgrcv(int msqid, long *pmtype, void __user *mtext,
 	mode = convert_mode(&msgtyp, msgflg);
 	ns = current->nsproxy->ipc_ns;
 
+	/* Let a sender copy straight into the buffer if we have to wait */
+	if (msg_direct(ns, msgsz) && !(msgflg & IPC_NOWAIT))
+		msg_pin(&dst, mtext, min_t(size_t, msgsz, ns->msg_ctlmax), 1);
+
 	msq = msg_lock_check(ns, msqid);
-	if (IS_ERR(msq))
-		return PTR_ERR(msq);
+	if (IS_ERR(msq)) {
+		msg = ERR_CAST(msq);
+		goto out;
+	}
 
 	for (;;) {
 		struct msg_receiver msr_d;
@@ -832,6 +983,7 @@ long do_msgrcv(int msqid, long *pmtype, void __user *mtext,
 			msr_d.r_maxsize = INT_MAX;
 		else
 			msr_d.r_maxsize = msgsz;
+		msr_d.r_pages = dst.pages ? &dst : NULL;
 		msr_d.r_msg = ERR_PTR(-EAGAIN);
 		current->state = TASK_INTERRUPTIBLE;
 		msg_unlock(msq);
@@ -891,15 +1043,23 @@ out_unlock:
 			break;
 		}
 	}
-	if (IS_ERR(msg))
-		return PTR_ERR(msg);
+out:
+	if (msg == MSG_DIRECT) {
+		*pmtype = dst.type;
+		msgsz = dst.len;
+	} else if (IS_ERR(msg)) {
+		msgsz = PTR_ERR(msg);
+	} else {
+		msgsz = (msgsz > msg->m_ts) ? msg->m_ts : msgsz;
+		*pmtype = msg->m_type;
+		if (store_msg(mtext, msg, msgsz))
+			msgsz = -EFAULT;
 
-	msgsz = (msgsz > msg->m_ts) ? msg->m_ts : msgsz;
-	*pmtype = msg->m_type;
-	if (store_msg(mtext, msg, msgsz))
-		msgsz = -EFAULT;
+		free_msg(msg);
+	}
 
-	free_msg(msg);
+	if (dst.pages)
+		msg_unpin(&dst, msg == MSG_DIRECT);
 
 	return msgsz;
 }
@@ -61,6 +61,9 @@
 #include <linux/nsproxy.h>
 #include <linux/ptrace.h>
 #include <linux/hugetlb.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/percpu.h>
 
 #include <asm/futex.h>
 
@@ -69,6 +72,7 @@
 int __read_mostly futex_cmpxchg_enabled;
 
 #define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
+#define FUTEX_PRIVATE_HASHBITS (CONFIG_BASE_SMALL ? 3 : 6)
 
 /*
  * Futex flags used to encode options to functions and preserve them across
@@ -109,6 +113,8 @@ struct futex_pi_state {
  * @rt_waiter:		rt_waiter storage for use with requeue_pi
  * @requeue_pi_key:	the requeue_pi target futex key
  * @bitset:		bitset for the optional bitmasked wakeup
+ * @wait_start:		when the task was queued (CONFIG_FUTEX_STATS)
+ * @woken_at:		when the task was woken (CONFIG_FUTEX_STATS)
  *
  * We use this hashed waitqueue, instead of a normal wait_queue_t, so
  * we can wake only the relevant ones (hashed queues may be shared).
@@ -131,6 +137,10 @@ struct futex_q {
 	struct rt_mutex_waiter *rt_waiter;
 	union futex_key *requeue_pi_key;
 	u32 bitset;
+#ifdef CONFIG_FUTEX_STATS
+	ktime_t wait_start;
+	ktime_t woken_at;
+#endif
 };
 
 static const struct futex_q futex_q_init = {
@@ -151,17 +161,144 @@ struct futex_hash_bucket {
 
 static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
 
+static void futex_hash_init(struct futex_hash_bucket *hb, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		plist_head_init(&hb[i].chain);
+		spin_lock_init(&hb[i].lock);
+	}
+}
+
 /*
  * We hash on the keys returned from get_futex_key (see below).
+ *
+ * Private futexes of a process that has more than one task sharing its
+ * mm are hashed in a table of its own, so that they do not collide with
+ * the futexes of other processes in the global table.
  */
 static struct futex_hash_bucket *hash_futex(union futex_key *key)
 {
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED)) &&
+	    key->private.mm->futex_hash)
+		return &key->private.mm->futex_hash[hash &
+					((1 << FUTEX_PRIVATE_HASHBITS)-1)];
+#endif
 	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
 }
 
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+/**
+ * futex_mm_share() - Prepare an mm for being shared by another task
+ * @mm:		the mm of the current task
+ *
+ * Called by copy_mm() before a task that shares @mm is created, except
+ * for vfork() children. The private hash table must be in place before
+ * a second task can use @mm: a futex_q queued in the global table would
+ * not be found anymore once the table exists. Until then only the
+ * current task (and a parent waiting for its vfork() child, which can
+ * not be waiting on a futex) uses @mm, so there is no such futex_q.
+ *
+ * Returns 0 on success or -ENOMEM.
+ */
+int futex_mm_share(struct mm_struct *mm)
+{
+	struct futex_hash_bucket *hb;
+
+	if (mm->futex_hash)
+		return 0;
+
+	hb = kmalloc(sizeof(*hb) << FUTEX_PRIVATE_HASHBITS, GFP_KERNEL);
+	if (!hb)
+		return -ENOMEM;
+
+	futex_hash_init(hb, 1 << FUTEX_PRIVATE_HASHBITS);
+	mm->futex_hash = hb;
+	return 0;
+}
+
+/* Called when the last reference to @mm is dropped */
+void futex_mm_free(struct mm_struct *mm)
+{
+	kfree(mm->futex_hash);
+}
+#endif
+
+#ifdef CONFIG_FUTEX_STATS
+#define FUTEX_STAT_BUCKETS	24
+
+/*
+ * Statistics shown in <debugfs>/futex/stats. The latency histograms
+ * have power of two buckets in usecs: bucket i > 0 counts the events
+ * that took [2^(i-1), 2^i) usecs, the last bucket everything longer.
+ */
+struct futex_stats {
+	unsigned long wait[FUTEX_STAT_BUCKETS];
+	unsigned long wake[FUTEX_STAT_BUCKETS];
+	unsigned long collisions;
+	unsigned long pi_waits;
+	unsigned long pi_boosts;
+};
+
+static DEFINE_PER_CPU(struct futex_stats, futex_stats);
+
+#define futex_stat_inc(field)	this_cpu_inc(futex_stats.field)
+
+static int futex_stat_bucket(ktime_t now, ktime_t since)
+{
+	s64 us = ktime_us_delta(now, since);
+
+	if (us <= 0)
+		return 0;
+	return min(fls64(us), FUTEX_STAT_BUCKETS - 1);
+}
+
+static inline void futex_stat_queue(struct futex_q *q)
+{
+	q->wait_start = ktime_get();
+}
+
+static inline void futex_stat_wake(struct futex_q *q)
+{
+	q->woken_at = ktime_get();
+}
+
+/* A futex_wait() that was queued on @q has been woken up */
+static void futex_stat_woken(struct futex_q *q)
+{
+	ktime_t now = ktime_get();
+
+	futex_stat_inc(wait[futex_stat_bucket(now, q->wait_start)]);
+	futex_stat_inc(wake[futex_stat_bucket(now, q->woken_at)]);
+}
+
+/*
+ * The current task is about to block on a PI futex. The owner gets
+ * boosted if the waiter has a higher priority. Must be called with the
+ * hash bucket lock held, which keeps pi_state->owner stable.
+ */
+static void futex_stat_pi_wait(struct futex_pi_state *pi_state)
+{
+	struct task_struct *owner = pi_state->owner;
+
+	futex_stat_inc(pi_waits);
+	if (owner && current->prio < owner->prio)
+		futex_stat_inc(pi_boosts);
+}
+#else
+#define futex_stat_inc(field)	do { } while (0)
+
+static inline void futex_stat_queue(struct futex_q *q) { }
+static inline void futex_stat_wake(struct futex_q *q) { }
+static inline void futex_stat_woken(struct futex_q *q) { }
+static inline void futex_stat_pi_wait(struct futex_pi_state *pi_state) { }
+#endif
+
 /*
  * Return 1 if two futex_keys are equal, 0 otherwise.
  */
@@ -856,6 +993,7 @@ static void wake_futex(struct futex_q *q)
 	 */
 	get_task_struct(p);
 
+	futex_stat_wake(q);
 	__unqueue_futex(q);
 	/*
 	 * The waiting task can free the futex_q as soon as
@@ -1011,7 +1149,8 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 			wake_futex(this);
 			if (++ret >= nr_wake)
 				break;
-		}
+		} else
+			futex_stat_inc(collisions);
 	}
 
 	spin_unlock(&hb->lock);
@@ -1089,7 +1228,8 @@ retry_private:
 			wake_futex(this);
 			if (++ret >= nr_wake)
 				break;
-		}
+		} else
+			futex_stat_inc(collisions);
 	}
 
 	if (op_ret > 0) {
@@ -1105,7 +1245,8 @@ retry_private:
 				wake_futex(this);
 				if (++op_ret >= nr_wake2)
 					break;
-			}
+			} else
+				futex_stat_inc(collisions);
 		}
 		ret += op_ret;
 	}
@@ -1921,13 +2062,16 @@ retry:
 		goto out;
 
 	/* queue_me and wait for wakeup, timeout, or a signal. */
+	futex_stat_queue(&q);
 	futex_wait_queue_me(hb, &q, to);
 
 	/* If we were woken (and unqueued), we succeeded, whatever. */
 	ret = 0;
 	/* unqueue_me() drops q.key ref */
-	if (!unqueue_me(&q))
+	if (!unqueue_me(&q)) {
+		futex_stat_woken(&q);
 		goto out;
+	}
 	ret = -ETIMEDOUT;
 	if (to && !to->task)
 		goto out;
@@ -2034,6 +2178,9 @@ retry_private:
 		}
 	}
 
+	if (!trylock)
+		futex_stat_pi_wait(q.pi_state);
+
 	/*
 	 * Only actually queue now that the atomic ops are done:
 	 */
@@ -2743,7 +2890,6 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 static int __init futex_init(void)
 {
 	u32 curval;
-	int i;
 
 	/*
 	 * This will fail and we want it. Some arch implementations do
@@ -2758,11 +2904,81 @@ static int __init futex_init(void)
 	if (cmpxchg_futex_value_locked(&curval, NULL, 0, 0) == -EFAULT)
 		futex_cmpxchg_enabled = 1;
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	futex_hash_init(futex_queues, ARRAY_SIZE(futex_queues));
 
 	return 0;
 }
 __initcall(futex_init);
+
+#ifdef CONFIG_FUTEX_STATS
+static int futex_stats_show(struct seq_file *m, void *v)
+{
+	struct futex_stats sum, *s;
+	int cpu, i;
+
+	memset(&sum, 0, sizeof(sum));
+	for_each_possible_cpu(cpu) {
+		s = &per_cpu(futex_stats, cpu);
+		for (i = 0; i < FUTEX_STAT_BUCKETS; i++) {
+			sum.wait[i] += s->wait[i];
+			sum.wake[i] += s->wake[i];
+		}
+		sum.collisions += s->collisions;
+		sum.pi_waits += s->pi_waits;
+		sum.pi_boosts += s->pi_boosts;
+	}
+
+	seq_printf(m, "collisions %lu\n", sum.collisions);
+	seq_printf(m, "pi_waits   %lu\n", sum.pi_waits);
+	seq_printf(m, "pi_boosts  %lu\n\n", sum.pi_boosts);
+
+	seq_printf(m, "%10s %12s %12s\n", "usecs", "wait", "wake");
+	for (i = 0; i < FUTEX_STAT_BUCKETS; i++)
+		seq_printf(m, "%10lu %12lu %12lu\n", i ? 1UL << (i - 1) : 0,
+			   sum.wait[i], sum.wake[i]);
+	return 0;
+}
+
+static int futex_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, futex_stats_show, NULL);
+}
+
+/* Any write clears the statistics */
+static ssize_t futex_stats_write(struct file *file, const char __user *buf,
+				 size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(&per_cpu(futex_stats, cpu), 0,
+		       sizeof(struct futex_stats));
+	return count;
+}
+
+static const struct file_operations futex_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= futex_stats_open,
+	.read		= seq_read,
+	.write		= futex_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init futex_stats_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("futex", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	if (!debugfs_create_file("stats", S_IRUSR | S_IWUSR, dir, NULL,
+				 &futex_stats_fops)) {
+		debugfs_remove(dir);
+		return -ENOMEM;
+	}
+	return 0;
+}
+late_initcall(futex_stats_init);
+#endif
@@ -366,6 +366,12 @@ void br_dev_setup(struct net_device *dev)
 	br->bridge_forward_delay = br->forward_delay = 15 * HZ;
 	br->ageing_time = 300 * HZ;
 
+#ifdef CONFIG_BRIDGE_FAST_PATH
+	/* never matches the zeroed port caches */
+	atomic_set(&br->fdb_genid, 1);
+	br->flags |= BR_FAST_PATH;
+#endif
+
 	br_netfilter_rtable_init(br);
 	br_stp_timer_init(br);
 	br_multicast_init(br);
@@ -84,6 +84,10 @@ static inline void fdb_delete(struct net_bridge_fdb_entry *f)
 {
 	fdb_notify(f, RTM_DELNEIGH);
 	hlist_del_rcu(&f->hlist);
+#ifdef CONFIG_BRIDGE_FAST_PATH
+	/* drop references held by the per-port fast path caches */
+	atomic_inc(&f->dst->br->fdb_genid);
+#endif
 	call_rcu(&f->rcu, fdb_rcu_free);
 }
 
@@ -234,6 +238,13 @@ struct net_bridge_fdb_entry *__br_fdb_get(struct net_bridge *br,
 	return NULL;
 }
 
+/* Used by the fast path to check a cached destination entry */
+int br_fdb_expired(const struct net_bridge *br,
+		   const struct net_bridge_fdb_entry *fdb)
+{
+	return has_expired(br, fdb);
+}
+
 #if defined(CONFIG_ATM_LANE) || defined(CONFIG_ATM_LANE_MODULE)
 /* Interface used by ATM LANE hook to test
  * if an addr is on some other bridge port */
@@ -122,6 +122,28 @@ void br_forward(const struct net_bridge_port *to, struct sk_buff *skb, struct sk
 		kfree_skb(skb);
 }
 
+#ifdef CONFIG_BRIDGE_FAST_PATH
+/* called with rcu_read_lock, bypasses the NF_BR_FORWARD and
+ * NF_BR_POST_ROUTING hooks.  Returns false, leaving the skb untouched,
+ * if the frame has to take the normal path instead.
+ */
+bool br_forward_fast(const struct net_bridge_port *to, struct sk_buff *skb)
+{
+	if (!should_deliver(to, skb) || skb_warn_if_lro(skb) ||
+	    unlikely(netpoll_tx_running(to->dev)))
+		return false;
+
+	if (packet_length(skb) > to->dev->mtu && !skb_is_gso(skb))
+		return false;
+
+	skb->dev = to->dev;
+	skb_forward_csum(skb);
+	skb_push(skb, ETH_HLEN);
+	dev_queue_xmit(skb);
+	return true;
+}
+#endif
+
 static int deliver_clone(const struct net_bridge_port *prev,
 			 struct sk_buff *skb,
 			 void (*__packet_hook)(const struct net_bridge_port *p,
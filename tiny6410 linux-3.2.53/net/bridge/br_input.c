@@ -26,6 +26,10 @@ const u8 br_group_address[ETH_ALEN] = { 0x01, 0x80, 0xc2, 0x00, 0x00, 0x00 };
 br_should_route_hook_t __rcu *br_should_route_hook __read_mostly;
 EXPORT_SYMBOL(br_should_route_hook);
 
+/* Maintained by ebtables, the fast path stays off while this is non-zero */
+atomic_t br_ebt_tables_active = ATOMIC_INIT(0);
+EXPORT_SYMBOL(br_ebt_tables_active);
+
 static int br_pass_frame_up(struct sk_buff *skb)
 {
 	struct net_device *indev, *brdev = BR_INPUT_SKB_CB(skb)->brdev;
@@ -139,6 +143,105 @@ static inline int is_link_local(const unsigned char *dest)
 	return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | ((a[2] ^ b[2]) & m)) == 0;
 }
 
+#ifdef CONFIG_BRIDGE_FAST_PATH
+static bool br_fast_cache_get(struct net_bridge_port *p,
+			      const struct ethhdr *eth, int genid,
+			      struct net_bridge_fdb_entry **src,
+			      struct net_bridge_fdb_entry **dst)
+{
+	int i;
+
+	for (i = 0; i < BR_FAST_CACHE_SIZE; i++) {
+		struct br_fast_entry *fe = &p->fast_cache[i];
+		unsigned int seq = ACCESS_ONCE(fe->seq);
+
+		if (seq & 1)
+			continue;
+		smp_rmb();
+		if (fe->genid != genid ||
+		    compare_ether_addr(fe->dst, eth->h_dest) ||
+		    compare_ether_addr(fe->src, eth->h_source))
+			continue;
+		*src = fe->src_fdb;
+		*dst = fe->dst_fdb;
+		smp_rmb();
+		if (ACCESS_ONCE(fe->seq) == seq)
+			return true;
+	}
+	return false;
+}
+
+static void br_fast_cache_put(struct net_bridge_port *p,
+			      const struct ethhdr *eth, int genid,
+			      struct net_bridge_fdb_entry *src,
+			      struct net_bridge_fdb_entry *dst)
+{
+	struct br_fast_entry *fe;
+	unsigned int seq;
+
+	fe = &p->fast_cache[p->fast_next++ % BR_FAST_CACHE_SIZE];
+	seq = ACCESS_ONCE(fe->seq);
+	/* someone else is filling this slot, just skip caching */
+	if ((seq & 1) || cmpxchg(&fe->seq, seq, seq + 1) != seq)
+		return;
+	smp_wmb();
+	fe->genid = genid;
+	memcpy(fe->src, eth->h_source, ETH_ALEN);
+	memcpy(fe->dst, eth->h_dest, ETH_ALEN);
+	fe->src_fdb = src;
+	fe->dst_fdb = dst;
+	smp_wmb();
+	fe->seq = seq + 2;
+}
+
+/*
+ * Forward a unicast frame between two learned stations without running
+ * the bridge netfilter hooks, provided nothing is there to look at it.
+ * The last few address pairs seen on each port are cached along with
+ * their fdb entries, which saves both hash walks; any fdb entry being
+ * freed invalidates all the caches of the bridge through fdb_genid.
+ * Returns true if the frame has been consumed.
+ */
+static bool br_fast_forward(struct net_bridge_port *p, struct sk_buff *skb)
+{
+	struct net_bridge *br = p->br;
+	const struct ethhdr *eth = eth_hdr(skb);
+	struct net_bridge_fdb_entry *src, *dst;
+	int genid;
+
+	if (!(br->flags & BR_FAST_PATH) ||
+	    is_multicast_ether_addr(eth->h_dest) ||
+	    (br->dev->flags & IFF_PROMISC) ||
+	    atomic_read(&br_ebt_tables_active) || br_netfilter_active(br))
+		return false;
+
+	genid = atomic_read(&br->fdb_genid);
+	smp_rmb();
+	if (!br_fast_cache_get(p, eth, genid, &src, &dst)) {
+		src = __br_fdb_get(br, eth->h_source);
+		dst = __br_fdb_get(br, eth->h_dest);
+		if (!src || !dst)
+			return false;
+		br_fast_cache_put(p, eth, genid, src, dst);
+	}
+
+	/* stations that moved, or are us, go through the slow path */
+	if (src->dst != p || src->is_local || dst->is_local ||
+	    br_fdb_expired(br, dst))
+		return false;
+
+	src->updated = jiffies;
+	dst->used = jiffies;
+	return br_forward_fast(dst->dst, skb);
+}
+#else
+static inline bool br_fast_forward(struct net_bridge_port *p,
+				   struct sk_buff *skb)
+{
+	return false;
+}
+#endif
+
 /*
  * Return NULL if skb is handled
  * note: already called with rcu_read_lock
@@ -214,6 +317,8 @@ forward:
 			}
 			dest = eth_hdr(skb)->h_dest;
 		}
+		if (br_fast_forward(p, skb))
+			break;
 		/* fall through */
 	case BR_STATE_LEARNING:
 		if (!compare_ether_addr(p->br->dev->dev_addr, dest))
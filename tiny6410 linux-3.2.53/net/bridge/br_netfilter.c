@@ -151,6 +151,14 @@ void br_netfilter_rtable_init(struct net_bridge *br)
 	rt->dst.ops = &fake_dst_ops;
 }
 
+/* Whether frames on this bridge have to be handed to {ip,ip6,arp}tables */
+bool br_netfilter_active(const struct net_bridge *br)
+{
+	return brnf_call_iptables || br->nf_call_iptables ||
+	       brnf_call_ip6tables || br->nf_call_ip6tables ||
+	       brnf_call_arptables || br->nf_call_arptables;
+}
+
 static inline struct rtable *bridge_parent_rtable(const struct net_device *dev)
 {
 	struct net_bridge_port *port;
@@ -107,6 +107,21 @@ struct net_bridge_mdb_htable
 	u32				ver;
 };
 
+#ifdef CONFIG_BRIDGE_FAST_PATH
+#define BR_FAST_CACHE_SIZE	4
+
+/* A recently forwarded unicast address pair, see br_fast_forward() */
+struct br_fast_entry
+{
+	unsigned int			seq;
+	int				genid;
+	unsigned char			src[ETH_ALEN];
+	unsigned char			dst[ETH_ALEN];
+	struct net_bridge_fdb_entry	*src_fdb;
+	struct net_bridge_fdb_entry	*dst_fdb;
+};
+#endif
+
 struct net_bridge_port
 {
 	struct net_bridge		*br;
@@ -152,6 +167,11 @@ struct net_bridge_port
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	struct netpoll			*np;
 #endif
+
+#ifdef CONFIG_BRIDGE_FAST_PATH
+	struct br_fast_entry		fast_cache[BR_FAST_CACHE_SIZE];
+	unsigned int			fast_next;
+#endif
 };
 
 #define br_port_exists(dev) (dev->priv_flags & IFF_BRIDGE_PORT)
@@ -185,6 +205,10 @@ struct net_bridge
 	struct br_cpu_netstats __percpu *stats;
 	spinlock_t			hash_lock;
 	struct hlist_head		hash[BR_HASH_SIZE];
+#ifdef CONFIG_BRIDGE_FAST_PATH
+	/* bumped whenever an fdb entry is freed */
+	atomic_t			fdb_genid;
+#endif
 #ifdef CONFIG_BRIDGE_NETFILTER
 	struct rtable 			fake_rtable;
 	bool				nf_call_iptables;
@@ -193,6 +217,7 @@ struct net_bridge
 #endif
 	unsigned long			flags;
 #define BR_SET_MAC_ADDR		0x00000001
+#define BR_FAST_PATH		0x00000002
 
 	u16				group_fwd_mask;
 
@@ -349,6 +374,8 @@ extern void br_fdb_delete_by_port(struct net_bridge *br,
 				  const struct net_bridge_port *p, int do_all);
 extern struct net_bridge_fdb_entry *__br_fdb_get(struct net_bridge *br,
 						 const unsigned char *addr);
+extern int br_fdb_expired(const struct net_bridge *br,
+			  const struct net_bridge_fdb_entry *fdb);
 extern int br_fdb_test_addr(struct net_device *dev, unsigned char *addr);
 extern int br_fdb_fillbuf(struct net_bridge *br, void *buf,
 			  unsigned long count, unsigned long off);
@@ -369,6 +396,8 @@ extern int br_dev_queue_push_xmit(struct sk_buff *skb);
 extern void br_forward(const struct net_bridge_port *to,
 		struct sk_buff *skb, struct sk_buff *skb0);
 extern int br_forward_finish(struct sk_buff *skb);
+extern bool br_forward_fast(const struct net_bridge_port *to,
+			    struct sk_buff *skb);
 extern void br_flood_deliver(struct net_bridge *br, struct sk_buff *skb);
 extern void br_flood_forward(struct net_bridge *br, struct sk_buff *skb,
 			     struct sk_buff *skb2);
@@ -486,10 +515,12 @@ static inline bool br_multicast_is_router(struct net_bridge *br)
 extern int br_netfilter_init(void);
 extern void br_netfilter_fini(void);
 extern void br_netfilter_rtable_init(struct net_bridge *);
+extern bool br_netfilter_active(const struct net_bridge *br);
 #else
 #define br_netfilter_init()	(0)
 #define br_netfilter_fini()	do { } while(0)
 #define br_netfilter_rtable_init(x)
+#define br_netfilter_active(br)	(false)
 #endif
 
 /* br_stp.c */
@@ -678,6 +678,32 @@ static ssize_t store_nf_call_arptables(
 static DEVICE_ATTR(nf_call_arptables, S_IRUGO | S_IWUSR,
 		   show_nf_call_arptables, store_nf_call_arptables);
 #endif
+#ifdef CONFIG_BRIDGE_FAST_PATH
+static ssize_t show_fast_path(
+	struct device *d, struct device_attribute *attr, char *buf)
+{
+	struct net_bridge *br = to_bridge(d);
+	return sprintf(buf, "%d\n", !!(br->flags & BR_FAST_PATH));
+}
+
+static int set_fast_path(struct net_bridge *br, unsigned long val)
+{
+	if (val)
+		br->flags |= BR_FAST_PATH;
+	else
+		br->flags &= ~BR_FAST_PATH;
+	return 0;
+}
+
+static ssize_t store_fast_path(
+	struct device *d, struct device_attribute *attr, const char *buf,
+	size_t len)
+{
+	return store_bridge_parm(d, buf, len, set_fast_path);
+}
+static DEVICE_ATTR(fast_path, S_IRUGO | S_IWUSR,
+		   show_fast_path, store_fast_path);
+#endif
 
 static struct attribute *bridge_attrs[] = {
 	&dev_attr_forward_delay.attr,
@@ -717,6 +743,9 @@ static struct attribute *bridge_attrs[] = {
 	&dev_attr_nf_call_iptables.attr,
 	&dev_attr_nf_call_ip6tables.attr,
 	&dev_attr_nf_call_arptables.attr,
+#endif
+#ifdef CONFIG_BRIDGE_FAST_PATH
+	&dev_attr_fast_path.attr,
 #endif
 	NULL
 };
@@ -976,6 +976,21 @@ static void get_counters(const struct ebt_counter *oldcounters,
 	}
 }
 
+/* A table without rules that accepts on all its chains can't change the
+ * fate of a frame, the bridge fast path only has to yield to the others */
+static int ebt_table_active(const struct ebt_table_info *info)
+{
+	int i;
+
+	if (info->nentries)
+		return 1;
+	for (i = 0; i < NF_BR_NUMHOOKS; i++)
+		if (info->hook_entry[i] &&
+		    info->hook_entry[i]->policy != EBT_ACCEPT)
+			return 1;
+	return 0;
+}
+
 static int do_replace_finish(struct net *net, struct ebt_replace *repl,
 			      struct ebt_table_info *newinfo)
 {
@@ -1036,6 +1051,8 @@ static int do_replace_finish(struct net *net, struct ebt_replace *repl,
 
 	t->private = newinfo;
 	write_unlock_bh(&t->lock);
+	atomic_add(ebt_table_active(newinfo) - ebt_table_active(table),
+		   &br_ebt_tables_active);
 	mutex_unlock(&ebt_mutex);
 	/* so, a user can change the chains while having messed up her counter
 	   allocation. Only reason why this is done is because this way the lock
@@ -1222,6 +1239,8 @@ ebt_register_table(struct net *net, const struct ebt_table *input_table)
 		goto free_unlock;
 	}
 	list_add(&table->list, &net->xt.tables[NFPROTO_BRIDGE]);
+	if (ebt_table_active(newinfo))
+		atomic_inc(&br_ebt_tables_active);
 	mutex_unlock(&ebt_mutex);
 	return table;
 free_unlock:
@@ -1251,6 +1270,8 @@ void ebt_unregister_table(struct net *net, struct ebt_table *table)
 	}
 	mutex_lock(&ebt_mutex);
 	list_del(&table->list);
+	if (ebt_table_active(table->private))
+		atomic_dec(&br_ebt_tables_active);
 	mutex_unlock(&ebt_mutex);
 	EBT_ENTRY_ITERATE(table->private->entries, table->private->entries_size,
 			  ebt_cleanup_entry, net, NULL);
@@ -1024,6 +1024,7 @@ int fib_sync_down_addr(struct net *net, __be32 local)
 			ret++;
 		}
 	}
+	fib_cache_invalidate();
 	return ret;
 }
 
@@ -1076,6 +1077,7 @@ int fib_sync_down_dev(struct net_device *dev, int force)
 		}
 	}
 
+	fib_cache_invalidate();
 	return ret;
 }
 
@@ -1192,6 +1194,7 @@ int fib_sync_up(struct net_device *dev)
 		}
 	}
 
+	fib_cache_invalidate();
 	return ret;
 }
 
@@ -73,6 +73,7 @@
 #include <linux/list.h>
 #include <linux/slab.h>
 #include <linux/export.h>
+#include <linux/hash.h>
 #include <net/net_namespace.h>
 #include <net/ip.h>
 #include <net/protocol.h>
@@ -152,11 +153,44 @@ struct trie_stat {
 	unsigned int nodesizes[MAX_STAT_DEPTH];
 };
 
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+/*
+ * Direct mapped cache of lookup results in front of the trie.  Entries
+ * are tagged with fib_cache_genid, which is bumped on every table or
+ * nexthop change, so a stale entry simply never matches again.  Readers
+ * are lockless: seq is odd while an entry is rewritten and readers that
+ * see it change treat the slot as a miss.
+ */
+#define FIB_CACHE_SIZE		(1 << CONFIG_IP_FIB_TRIE_CACHE_BITS)
+
+struct fib_cache_entry {
+	unsigned int		seq;
+	int			genid;
+	__be32			daddr;
+	int			oif;
+	u8			tos;
+	u8			scope;
+	int			ret;
+	struct fib_result	res;
+};
+
+struct fib_cache_stats {
+	unsigned int		hits;
+	unsigned int		misses;
+};
+
+atomic_t fib_cache_genid = ATOMIC_INIT(1);
+#endif
+
 struct trie {
 	struct rt_trie_node __rcu *trie;
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 	struct trie_use_stats stats;
 #endif
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	struct fib_cache_entry *cache;
+	struct fib_cache_stats cache_stats;
+#endif
 };
 
 static void put_child(struct trie *t, struct tnode *tn, int i, struct rt_trie_node *n);
@@ -1288,6 +1322,7 @@ int fib_table_insert(struct fib_table *tb, struct fib_config *cfg)
 			alias_free_mem_rcu(fa);
 
 			fib_release_info(fi_drop);
+			fib_cache_invalidate();
 			if (state & FA_S_ACCESSED)
 				rt_cache_flush(cfg->fc_nlinfo.nl_net, -1);
 			rtmsg_fib(RTM_NEWROUTE, htonl(key), new_fa, plen,
@@ -1336,6 +1371,7 @@ int fib_table_insert(struct fib_table *tb, struct fib_config *cfg)
 	list_add_tail_rcu(&new_fa->fa_list,
 			  (fa ? &fa->fa_list : fa_head));
 
+	fib_cache_invalidate();
 	rt_cache_flush(cfg->fc_nlinfo.nl_net, -1);
 	rtmsg_fib(RTM_NEWROUTE, htonl(key), new_fa, plen, tb->tb_id,
 		  &cfg->fc_nlinfo, 0);
@@ -1417,8 +1453,8 @@ static int check_leaf(struct fib_table *tb, struct trie *t, struct leaf *l,
 	return 1;
 }
 
-int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
-		     struct fib_result *res, int fib_flags)
+static int __fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
+			      struct fib_result *res, int fib_flags)
 {
 	struct trie *t = (struct trie *) tb->tb_data;
 	int ret;
@@ -1609,6 +1645,110 @@ found:
 	return ret;
 }
 
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+static inline struct fib_cache_entry *fib_cache_slot(struct trie *t,
+						     const struct flowi4 *flp)
+{
+	u32 h = ntohl(flp->daddr) ^ ((u32)flp->flowi4_tos << 24) ^
+		flp->flowi4_oif;
+
+	return &t->cache[hash_32(h, CONFIG_IP_FIB_TRIE_CACHE_BITS)];
+}
+
+static bool fib_cache_get(struct fib_cache_entry *ce, const struct flowi4 *flp,
+			  int genid, struct fib_result *res, int *ret)
+{
+	unsigned int seq = ACCESS_ONCE(ce->seq);
+	struct fib_result r;
+	int rv;
+
+	if (seq & 1)
+		return false;
+	smp_rmb();
+
+	if (ce->genid != genid || ce->daddr != flp->daddr ||
+	    ce->oif != flp->flowi4_oif || ce->tos != flp->flowi4_tos ||
+	    ce->scope != flp->flowi4_scope)
+		return false;
+	rv = ce->ret;
+	r = ce->res;
+
+	smp_rmb();
+	if (ACCESS_ONCE(ce->seq) != seq)
+		return false;
+
+	/* Raced with a route delete that has not bumped the genid yet */
+	if (rv == 0 && r.fi->fib_dead)
+		return false;
+
+	*ret = rv;
+	if (rv == 0)
+		*res = r;
+	return true;
+}
+
+static void fib_cache_put(struct fib_cache_entry *ce, const struct flowi4 *flp,
+			  int genid, const struct fib_result *res, int ret)
+{
+	unsigned int seq = ACCESS_ONCE(ce->seq);
+
+	/* Somebody else is rewriting this slot, let them have it */
+	if ((seq & 1) || cmpxchg(&ce->seq, seq, seq + 1) != seq)
+		return;
+	smp_wmb();
+
+	ce->genid = genid;
+	ce->daddr = flp->daddr;
+	ce->oif = flp->flowi4_oif;
+	ce->tos = flp->flowi4_tos;
+	ce->scope = flp->flowi4_scope;
+	ce->ret = ret;
+	if (ret == 0)
+		ce->res = *res;
+
+	smp_wmb();
+	ce->seq = seq + 2;
+}
+
+int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
+		     struct fib_result *res, int fib_flags)
+{
+	struct trie *t = (struct trie *) tb->tb_data;
+	struct fib_cache_entry *ce;
+	int genid, ret;
+
+	if (unlikely(!t->cache))
+		return __fib_table_lookup(tb, flp, res, fib_flags);
+
+	/* Sample the genid first, so that a result computed against an
+	 * older table can never be stored under a newer genid. */
+	genid = atomic_read(&fib_cache_genid);
+	ce = fib_cache_slot(t, flp);
+
+	rcu_read_lock();
+	if (fib_cache_get(ce, flp, genid, res, &ret)) {
+		t->cache_stats.hits++;
+		if (ret == 0 && !(fib_flags & FIB_LOOKUP_NOREF))
+			atomic_inc(&res->fi->fib_clntref);
+		rcu_read_unlock();
+		return ret;
+	}
+
+	t->cache_stats.misses++;
+	ret = __fib_table_lookup(tb, flp, res, fib_flags);
+	fib_cache_put(ce, flp, genid, res, ret);
+	rcu_read_unlock();
+
+	return ret;
+}
+#else
+int fib_table_lookup(struct fib_table *tb, const struct flowi4 *flp,
+		     struct fib_result *res, int fib_flags)
+{
+	return __fib_table_lookup(tb, flp, res, fib_flags);
+}
+#endif
+
 /*
  * Remove the leaf and return parent.
  */
@@ -1709,6 +1849,7 @@ int fib_table_delete(struct fib_table *tb, struct fib_config *cfg)
 	if (hlist_empty(&l->list))
 		trie_leaf_remove(t, l);
 
+	fib_cache_invalidate();
 	if (fa->fa_state & FA_S_ACCESSED)
 		rt_cache_flush(cfg->fc_nlinfo.nl_net, -1);
 
@@ -1842,12 +1983,20 @@ int fib_table_flush(struct fib_table *tb)
 	if (ll && hlist_empty(&ll->list))
 		trie_leaf_remove(t, ll);
 
+	if (found)
+		fib_cache_invalidate();
+
 	pr_debug("trie_flush found=%d\n", found);
 	return found;
 }
 
 void fib_free_table(struct fib_table *tb)
 {
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	struct trie *t = (struct trie *) tb->tb_data;
+
+	kfree(t->cache);
+#endif
 	kfree(tb);
 }
 
@@ -1994,6 +2143,12 @@ struct fib_table *fib_trie_table(u32 id)
 	t = (struct trie *) tb->tb_data;
 	memset(t, 0, sizeof(*t));
 
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+	/* Without the cache lookups still work, only slower */
+	t->cache = kcalloc(FIB_CACHE_SIZE, sizeof(struct fib_cache_entry),
+			   GFP_KERNEL);
+#endif
+
 	return tb;
 }
 
@@ -2174,6 +2329,22 @@ static void trie_show_usage(struct seq_file *seq,
 }
 #endif /*  CONFIG_IP_FIB_TRIE_STATS */
 
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+static void fib_cache_show(struct seq_file *seq, const struct trie *t)
+{
+	unsigned int hits = t->cache_stats.hits;
+	unsigned int misses = t->cache_stats.misses;
+	unsigned long long total = (unsigned long long)hits + misses;
+
+	seq_printf(seq, "\tLookup cache: %u entries, hits %u, misses %u",
+		   t->cache ? FIB_CACHE_SIZE : 0, hits, misses);
+	if (total)
+		seq_printf(seq, ", hit rate %llu%%",
+			   div64_u64(100ULL * hits, total));
+	seq_putc(seq, '\n');
+}
+#endif
+
 static void fib_table_print(struct seq_file *seq, struct fib_table *tb)
 {
 	if (tb->tb_id == RT_TABLE_LOCAL)
@@ -2213,6 +2384,9 @@ static int fib_triestat_seq_show(struct seq_file *seq, void *v)
 			trie_show_stats(seq, &stat);
 #ifdef CONFIG_IP_FIB_TRIE_STATS
 			trie_show_usage(seq, &t->stats);
+#endif
+#ifdef CONFIG_IP_FIB_TRIE_CACHE
+			fib_cache_show(seq, t);
 #endif
 		}
 	}
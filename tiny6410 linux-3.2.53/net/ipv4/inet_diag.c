@@ -97,6 +97,20 @@ static int inet_csk_diag_fill(struct sock *sk,
 	if (ext & (1 << (INET_DIAG_MEMINFO - 1)))
 		minfo = INET_DIAG_PUT(skb, INET_DIAG_MEMINFO, sizeof(*minfo));
 
+	if (ext & (1 << (INET_DIAG_SKMEMINFO - 1))) {
+		u32 *mem = INET_DIAG_PUT(skb, INET_DIAG_SKMEMINFO,
+					 SK_MEMINFO_VARS * sizeof(u32));
+
+		mem[SK_MEMINFO_RMEM_ALLOC] = sk_rmem_alloc_get(sk);
+		mem[SK_MEMINFO_RCVBUF] = sk->sk_rcvbuf;
+		mem[SK_MEMINFO_WMEM_ALLOC] = sk_wmem_alloc_get(sk);
+		mem[SK_MEMINFO_SNDBUF] = sk->sk_sndbuf;
+		mem[SK_MEMINFO_FWD_ALLOC] = sk->sk_forward_alloc;
+		mem[SK_MEMINFO_WMEM_QUEUED] = sk->sk_wmem_queued;
+		mem[SK_MEMINFO_OPTMEM] = atomic_read(&sk->sk_omem_alloc);
+		mem[SK_MEMINFO_BACKLOG] = sk->sk_backlog.len;
+	}
+
 	if (ext & (1 << (INET_DIAG_INFO - 1)))
 		info = INET_DIAG_PUT(skb, INET_DIAG_INFO,
 				     handler->idiag_info_size);
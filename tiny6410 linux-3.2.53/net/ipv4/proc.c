@@ -258,6 +258,9 @@ static const struct snmp_mib snmp4_net_list[] = {
 	SNMP_MIB_ITEM("TCPReqQFullDrop", LINUX_MIB_TCPREQQFULLDROP),
 	SNMP_MIB_ITEM("TCPChallengeACK", LINUX_MIB_TCPCHALLENGEACK),
 	SNMP_MIB_ITEM("TCPSYNChallenge", LINUX_MIB_TCPSYNCHALLENGE),
+	SNMP_MIB_ITEM("TCPIdleRcvShrink", LINUX_MIB_TCPIDLERCVSHRINK),
+	SNMP_MIB_ITEM("TCPIdleSndPageFree", LINUX_MIB_TCPIDLESNDPAGEFREE),
+	SNMP_MIB_ITEM("TCPOFOEarlyCollapse", LINUX_MIB_TCPOFOEARLYCOLLAPSE),
 	SNMP_MIB_SENTINEL
 };
 
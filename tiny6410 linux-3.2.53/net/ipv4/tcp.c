@@ -279,6 +279,9 @@
 
 int sysctl_tcp_fin_timeout __read_mostly = TCP_FIN_TIMEOUT;
 
+int sysctl_tcp_low_footprint __read_mostly;
+EXPORT_SYMBOL(sysctl_tcp_low_footprint);
+
 struct percpu_counter tcp_orphan_count;
 EXPORT_SYMBOL_GPL(tcp_orphan_count);
 
@@ -3194,6 +3197,67 @@ int tcp_cookie_generator(u32 *bakery)
 }
 EXPORT_SYMBOL(tcp_cookie_generator);
 
+/* Low footprint mode: once nothing has been received for a few RTOs
+ * (at least TCP_IDLE_SHRINK_MIN) and the application has drained the
+ * socket, bring its receive buffer and window back down to a few
+ * segments.  If the connection turns busy again, receive buffer
+ * autotuning grows them back from there.  Called from the delayed ACK
+ * timer with the socket locked.  Until the flow is idle long enough,
+ * the timer is re-armed for the next check without ICSK_ACK_TIMER, so
+ * a real delayed ACK simply takes it over.
+ */
+void tcp_shrink_idle_rcvbuf(struct sock *sk)
+{
+	struct inet_connection_sock *icsk = inet_csk(sk);
+	struct tcp_sock *tp = tcp_sk(sk);
+	u32 floor = min(tp->window_clamp, 4U * tp->advmss);
+	u32 idle, limit;
+
+	if (sk->sk_state != TCP_ESTABLISHED || tp->rcv_ssthresh <= floor)
+		return;
+
+	limit = max_t(u32, 4 * icsk->icsk_rto, TCP_IDLE_SHRINK_MIN);
+	idle = tcp_time_stamp - icsk->icsk_ack.lrcvtime;
+	if (idle < limit ||
+	    !skb_queue_empty(&sk->sk_receive_queue) ||
+	    !skb_queue_empty(&tp->out_of_order_queue) ||
+	    !skb_queue_empty(&tp->ucopy.prequeue)) {
+		if (!(icsk->icsk_ack.pending & ICSK_ACK_TIMER))
+			sk_reset_timer(sk, &icsk->icsk_delack_timer, jiffies +
+				       (idle < limit ? limit - idle : limit));
+		return;
+	}
+
+	tp->rcv_ssthresh = floor;
+	tp->rcvq_space.space = floor;
+	if (!(sk->sk_userlocks & SOCK_RCVBUF_LOCK)) {
+		int rcvmem = 4 * SKB_TRUESIZE(tp->advmss + MAX_TCP_HEADER);
+
+		sk->sk_rcvbuf = min(sk->sk_rcvbuf,
+				    max(rcvmem, sysctl_tcp_rmem[0]));
+	}
+	NET_INC_STATS_BH(sock_net(sk), LINUX_MIB_TCPIDLERCVSHRINK);
+	sk_mem_reclaim(sk);
+}
+
+/* Low footprint mode: everything sent has been acknowledged, so give
+ * back the partially filled page tcp_sendmsg() keeps around for the
+ * next write.
+ */
+void tcp_free_idle_sndpage(struct sock *sk)
+{
+	if (!tcp_write_queue_empty(sk))
+		return;
+
+	if (sk->sk_sndmsg_page) {
+		put_page(sk->sk_sndmsg_page);
+		sk->sk_sndmsg_page = NULL;
+		sk->sk_sndmsg_off = 0;
+		NET_INC_STATS_BH(sock_net(sk), LINUX_MIB_TCPIDLESNDPAGEFREE);
+	}
+	sk_mem_reclaim(sk);
+}
+
 void tcp_done(struct sock *sk)
 {
 	if (sk->sk_state == TCP_SYN_SENT || sk->sk_state == TCP_SYN_RECV)
@@ -3844,6 +3844,9 @@ static int tcp_ack(struct sock *sk, const struct sk_buff *skb, int flag)
 	/* See if we can take anything off of the retransmit queue. */
 	flag |= tcp_clean_rtx_queue(sk, prior_fackets, prior_snd_una);
 
+	if (sysctl_tcp_low_footprint && !tp->packets_out)
+		tcp_free_idle_sndpage(sk);
+
 	newly_acked_sacked = (prior_packets - prior_sacked) -
 			     (tp->packets_out - tp->sacked_out);
 
@@ -4479,6 +4482,7 @@ static void tcp_ofo_queue(struct sock *sk)
 
 static int tcp_prune_ofo_queue(struct sock *sk);
 static int tcp_prune_queue(struct sock *sk);
+static void tcp_collapse_ofo_queue(struct sock *sk);
 
 static inline int tcp_try_rmem_schedule(struct sock *sk, unsigned int size)
 {
@@ -4616,6 +4620,17 @@ drop:
 
 	TCP_ECN_check_ce(tp, skb);
 
+	/* In low footprint mode squeeze the ofo queue well before the
+	 * receive buffer fills up and tcp_prune_queue() has to step in.
+	 */
+	if (sysctl_tcp_low_footprint &&
+	    !skb_queue_empty(&tp->out_of_order_queue) &&
+	    atomic_read(&sk->sk_rmem_alloc) > (sk->sk_rcvbuf >> 1)) {
+		NET_INC_STATS_BH(sock_net(sk), LINUX_MIB_TCPOFOEARLYCOLLAPSE);
+		tcp_collapse_ofo_queue(sk);
+		sk_mem_reclaim(sk);
+	}
+
 	if (tcp_try_rmem_schedule(sk, skb->truesize))
 		goto drop;
 
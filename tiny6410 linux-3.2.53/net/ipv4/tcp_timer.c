@@ -261,6 +261,8 @@ static void tcp_delack_timer(unsigned long data)
 	}
 
 out:
+	if (sysctl_tcp_low_footprint)
+		tcp_shrink_idle_rcvbuf(sk);
 	if (tcp_memory_pressure)
 		sk_mem_reclaim(sk);
 out_unlock:
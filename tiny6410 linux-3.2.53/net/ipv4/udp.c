@@ -818,6 +818,12 @@ int udp_sendmsg(struct kiocb *iocb, struct sock *sk, struct msghdr *msg,
 	if (msg->msg_flags & MSG_OOB) /* Mirror BSD error message compatibility */
 		return -EOPNOTSUPP;
 
+#ifdef CONFIG_UDP_RING
+	/* A zero length send() flushes the mmap()ed transmit ring */
+	if (unlikely(!len) && !msg->msg_name && udp_ring_tx_active(sk))
+		return udp_ring_sendmsg(sk, msg);
+#endif
+
 	ipc.opt = NULL;
 	ipc.tx_flags = 0;
 
@@ -1469,6 +1475,10 @@ int udp_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
 	    udp_lib_checksum_complete(skb))
 		goto drop;
 
+#ifdef CONFIG_UDP_RING
+	if (udp_ring_rx_active(sk))
+		return udp_ring_rcv(sk, skb);
+#endif
 
 	if (sk_rcvqueues_full(sk, skb))
 		goto drop;
@@ -1724,6 +1734,9 @@ void udp_destroy_sock(struct sock *sk)
 	bool slow = lock_sock_fast(sk);
 	udp_flush_pending_frames(sk);
 	unlock_sock_fast(sk, slow);
+#ifdef CONFIG_UDP_RING
+	udp_ring_destroy(sk);
+#endif
 }
 
 /*
@@ -1814,6 +1827,11 @@ EXPORT_SYMBOL(udp_lib_setsockopt);
 int udp_setsockopt(struct sock *sk, int level, int optname,
 		   char __user *optval, unsigned int optlen)
 {
+#ifdef CONFIG_UDP_RING
+	if (level == SOL_UDP && sk->sk_prot == &udp_prot &&
+	    (optname == UDP_TX_RING || optname == UDP_RX_RING))
+		return udp_ring_setsockopt(sk, optname, optval, optlen);
+#endif
 	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
 		return udp_lib_setsockopt(sk, level, optname, optval, optlen,
 					  udp_push_pending_frames);
@@ -1879,6 +1897,11 @@ EXPORT_SYMBOL(udp_lib_getsockopt);
 int udp_getsockopt(struct sock *sk, int level, int optname,
 		   char __user *optval, int __user *optlen)
 {
+#ifdef CONFIG_UDP_RING
+	if (level == SOL_UDP && sk->sk_prot == &udp_prot &&
+	    optname == UDP_RING_STATS)
+		return udp_ring_getsockopt(sk, optname, optval, optlen);
+#endif
 	if (level == SOL_UDP  ||  level == SOL_UDPLITE)
 		return udp_lib_getsockopt(sk, level, optname, optval, optlen);
 	return ip_getsockopt(sk, level, optname, optval, optlen);
@@ -1916,6 +1939,11 @@ unsigned int udp_poll(struct file *file, struct socket *sock, poll_table *wait)
 	    !(sk->sk_shutdown & RCV_SHUTDOWN) && !first_packet_length(sk))
 		mask &= ~(POLLIN | POLLRDNORM);
 
+#ifdef CONFIG_UDP_RING
+	if (sk->sk_prot == &udp_prot && udp_ring_sk(sk))
+		mask |= udp_ring_poll(sk);
+#endif
+
 	return mask;
 
 }
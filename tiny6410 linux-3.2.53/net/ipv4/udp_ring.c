@@ -0,0 +1,719 @@
+/*
+ * INET		An implementation of the TCP/IP protocol suite for the LINUX
+ *		operating system.  INET is implemented using the  BSD Socket
+ *		interface as the means of communication with the user level.
+ *
+ *		Memory mapped transmit and receive rings for UDP sockets.
+ *
+ *		The transmit ring is laid out like the PACKET_TX_RING of
+ *		af_packet: userspace fills frames, marks them
+ *		TP_STATUS_SEND_REQUEST and kicks the socket with a zero length
+ *		send().  All pending frames are then pushed through the
+ *		regular udp_sendmsg() path in one system call.  The payload is
+ *		copied into the skb while the frame is being sent, so a frame
+ *		is handed back to userspace (TP_STATUS_AVAILABLE) as soon as
+ *		it has been queued.
+ *
+ *		The receive ring follows the TPACKET_V3 block mode: datagrams
+ *		are packed back to back into the current block, which is
+ *		handed to userspace when it is full or when the retire timer
+ *		fires.  The reader is woken once per block, not per datagram.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/poll.h>
+#include <linux/udp.h>
+#include <linux/if_packet.h>
+#include <asm/cacheflush.h>
+#include <net/udp.h>
+
+#define UDP_RING_BLK_HDRLEN	TPACKET_ALIGN(sizeof(struct tpacket_block_desc))
+#define UDP_RING_DEFAULT_TOV	8	/* msecs */
+
+static inline struct page *udp_ring_to_page(void *addr)
+{
+	if (is_vmalloc_addr(addr))
+		return vmalloc_to_page(addr);
+	return virt_to_page(addr);
+}
+
+static void udp_ring_set_status(struct udp_ring_hdr *hdr, __u32 status)
+{
+	hdr->ur_status = status;
+	flush_dcache_page(udp_ring_to_page(&hdr->ur_status));
+	smp_wmb();
+}
+
+static __u32 udp_ring_get_status(struct udp_ring_hdr *hdr)
+{
+	smp_rmb();
+	flush_dcache_page(udp_ring_to_page(&hdr->ur_status));
+	return hdr->ur_status;
+}
+
+static struct udp_ring_hdr *udp_ring_frame(struct udp_ring_buf *rb,
+					   unsigned int position)
+{
+	unsigned int block = position / rb->frames_per_block;
+	unsigned int offset = position % rb->frames_per_block;
+
+	return (struct udp_ring_hdr *)(rb->pg_vec[block] +
+				       offset * rb->frame_size);
+}
+
+static void udp_ring_increment_head(struct udp_ring_buf *rb)
+{
+	rb->head = rb->head != rb->frame_max ? rb->head + 1 : 0;
+}
+
+static void udp_ring_free_pg_vec(char **pg_vec, unsigned int order,
+				 unsigned int len)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		if (!pg_vec[i])
+			continue;
+		if (is_vmalloc_addr(pg_vec[i]))
+			vfree(pg_vec[i]);
+		else
+			free_pages((unsigned long)pg_vec[i], order);
+	}
+	kfree(pg_vec);
+}
+
+static char *udp_ring_alloc_block(unsigned int order)
+{
+	gfp_t gfp_flags = GFP_KERNEL | __GFP_COMP |
+			  __GFP_ZERO | __GFP_NOWARN | __GFP_NORETRY;
+	char *buffer;
+
+	buffer = (char *)__get_free_pages(gfp_flags, order);
+	if (buffer)
+		return buffer;
+
+	/* Large blocks are hard to find on a fragmented board */
+	return vzalloc((1 << order) * PAGE_SIZE);
+}
+
+static char **udp_ring_alloc_pg_vec(unsigned int block_nr, unsigned int order)
+{
+	char **pg_vec;
+	unsigned int i;
+
+	pg_vec = kcalloc(block_nr, sizeof(char *), GFP_KERNEL);
+	if (!pg_vec)
+		return NULL;
+
+	for (i = 0; i < block_nr; i++) {
+		pg_vec[i] = udp_ring_alloc_block(order);
+		if (!pg_vec[i]) {
+			udp_ring_free_pg_vec(pg_vec, order, block_nr);
+			return NULL;
+		}
+	}
+	return pg_vec;
+}
+
+static void udp_ring_retire_timer(unsigned long data);
+
+static struct udp_ring_sock *udp_ring_get(struct sock *sk)
+{
+	struct udp_sock *up = udp_sk(sk);
+	struct udp_ring_sock *ur;
+
+	lock_sock(sk);
+	ur = udp_ring_sk(sk);
+	if (!ur) {
+		ur = kzalloc(sizeof(*ur), sk->sk_allocation);
+		if (ur) {
+			mutex_init(&ur->lock);
+			spin_lock_init(&ur->blk.lock);
+			setup_timer(&ur->blk.retire_timer,
+				    udp_ring_retire_timer, (unsigned long)sk);
+			rcu_assign_pointer(up->ring, ur);
+		}
+	}
+	release_sock(sk);
+	return ur;
+}
+
+static void udp_ring_blk_init(struct udp_ring_sock *ur,
+			      struct tpacket_req3 *req,
+			      unsigned int first_offset)
+{
+	struct udp_ring_blk *blk = &ur->blk;
+	unsigned int tov = req->tp_retire_blk_tov;
+
+	blk->cur = 0;
+	blk->tail = 0;
+	blk->open = 0;
+	blk->losing = 0;
+	blk->last = NULL;
+	blk->seq = 1;
+	blk->first_offset = first_offset;
+	blk->max_len = ur->rx.frame_size - UDP_RING_HDRLEN;
+	blk->tov = msecs_to_jiffies(tov ? tov : UDP_RING_DEFAULT_TOV) ? : 1;
+}
+
+static int udp_ring_set(struct udp_ring_sock *ur, struct udp_ring_buf *rb,
+			struct tpacket_req3 *req)
+{
+	bool rx = rb == &ur->rx;
+	unsigned int first_offset = 0;
+	char **pg_vec = NULL;
+	unsigned int order = 0;
+	int err;
+
+	if (req->tp_block_nr) {
+		if ((int)req->tp_block_size <= 0 ||
+		    req->tp_block_size & (PAGE_SIZE - 1))
+			return -EINVAL;
+		if (req->tp_frame_size < UDP_RING_HDRLEN ||
+		    req->tp_frame_size & (TPACKET_ALIGNMENT - 1))
+			return -EINVAL;
+		if (rx) {
+			if (req->tp_sizeof_priv >= req->tp_block_size)
+				return -EINVAL;
+			first_offset = TPACKET_ALIGN(UDP_RING_BLK_HDRLEN +
+						     req->tp_sizeof_priv);
+		}
+		if (req->tp_block_size < first_offset + req->tp_frame_size)
+			return -EINVAL;
+		if (req->tp_block_size / req->tp_frame_size * req->tp_block_nr !=
+		    req->tp_frame_nr)
+			return -EINVAL;
+
+		order = get_order(req->tp_block_size);
+		pg_vec = udp_ring_alloc_pg_vec(req->tp_block_nr, order);
+		if (!pg_vec)
+			return -ENOMEM;
+	} else if (req->tp_frame_nr) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&ur->lock);
+	err = -EBUSY;
+	if (atomic_read(&ur->mapped))
+		goto out_unlock;
+	if (pg_vec && rb->pg_vec)
+		goto out_unlock;
+
+	err = 0;
+	spin_lock_bh(&ur->blk.lock);
+	swap(rb->pg_vec, pg_vec);
+	swap(rb->pg_vec_order, order);
+	swap(rb->pg_vec_len, req->tp_block_nr);
+	rb->pg_vec_pages = req->tp_block_size / PAGE_SIZE;
+	rb->frame_size = req->tp_frame_size;
+	rb->frames_per_block = rb->frame_size ?
+			       req->tp_block_size / rb->frame_size : 0;
+	rb->frame_max = req->tp_frame_nr - 1;
+	rb->head = 0;
+	if (rx)
+		udp_ring_blk_init(ur, req, first_offset);
+	spin_unlock_bh(&ur->blk.lock);
+
+	/* The old receive ring may still have its retire timer pending */
+	if (rx && pg_vec)
+		del_timer_sync(&ur->blk.retire_timer);
+
+out_unlock:
+	mutex_unlock(&ur->lock);
+	if (pg_vec)
+		udp_ring_free_pg_vec(pg_vec, order, req->tp_block_nr);
+	return err;
+}
+
+int udp_ring_setsockopt(struct sock *sk, int optname,
+			char __user *optval, unsigned int optlen)
+{
+	struct udp_ring_sock *ur;
+	struct tpacket_req3 req;
+	unsigned int size;
+
+	switch (optname) {
+	case UDP_TX_RING:
+		size = sizeof(struct tpacket_req);
+		break;
+	case UDP_RX_RING:
+		size = sizeof(struct tpacket_req3);
+		break;
+	default:
+		return -ENOPROTOOPT;
+	}
+
+	if (optlen < size)
+		return -EINVAL;
+	memset(&req, 0, sizeof(req));
+	if (copy_from_user(&req, optval, size))
+		return -EFAULT;
+
+	ur = udp_ring_get(sk);
+	if (!ur)
+		return -ENOMEM;
+	return udp_ring_set(ur, optname == UDP_RX_RING ? &ur->rx : &ur->tx,
+			    &req);
+}
+
+int udp_ring_getsockopt(struct sock *sk, int optname,
+			char __user *optval, int __user *optlen)
+{
+	struct udp_ring_sock *ur = udp_ring_sk(sk);
+	struct udp_ring_stats st;
+	int len;
+
+	if (optname != UDP_RING_STATS)
+		return -ENOPROTOOPT;
+
+	if (get_user(len, optlen))
+		return -EFAULT;
+	if (len < 0)
+		return -EINVAL;
+
+	memset(&st, 0, sizeof(st));
+	if (ur) {
+		mutex_lock(&ur->lock);
+		spin_lock_bh(&ur->blk.lock);
+		st = ur->stats;
+		spin_unlock_bh(&ur->blk.lock);
+		mutex_unlock(&ur->lock);
+	}
+
+	len = min_t(unsigned int, len, sizeof(st));
+	if (put_user(len, optlen))
+		return -EFAULT;
+	if (copy_to_user(optval, &st, len))
+		return -EFAULT;
+	return 0;
+}
+
+static int udp_ring_send_frame(struct sock *sk, struct udp_ring_hdr *hdr,
+			       unsigned int len, int flags)
+{
+	struct sockaddr_in sin;
+	struct msghdr msg;
+	struct iovec iov;
+	mm_segment_t oldfs;
+	int err;
+
+	iov.iov_base = (char *)hdr + UDP_RING_HDRLEN;
+	iov.iov_len = len;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_flags = flags;
+
+	if (hdr->ur_addr) {
+		sin.sin_family = AF_INET;
+		sin.sin_addr.s_addr = hdr->ur_addr;
+		sin.sin_port = hdr->ur_port;
+		msg.msg_name = &sin;
+		msg.msg_namelen = sizeof(sin);
+	}
+
+	oldfs = get_fs();
+	set_fs(KERNEL_DS);
+	err = udp_sendmsg(NULL, sk, &msg, len);
+	set_fs(oldfs);
+
+	return err;
+}
+
+/*
+ * Push every frame marked TP_STATUS_SEND_REQUEST, starting at the ring
+ * head.  Zero length datagrams cannot be sent from the ring, a zero
+ * length send() is what triggers the flush in the first place.
+ */
+int udp_ring_sendmsg(struct sock *sk, struct msghdr *msg)
+{
+	struct udp_ring_sock *ur = udp_ring_sk(sk);
+	struct udp_ring_buf *rb = &ur->tx;
+	int flags = msg->msg_flags & (MSG_DONTWAIT | MSG_DONTROUTE);
+	unsigned int max_len;
+	int len_sum = 0;
+	int err = 0;
+
+	mutex_lock(&ur->lock);
+	if (!rb->pg_vec) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	ur->stats.tx_kicks++;
+	max_len = rb->frame_size - UDP_RING_HDRLEN;
+
+	for (;;) {
+		struct udp_ring_hdr *hdr = udp_ring_frame(rb, rb->head);
+		unsigned int len;
+
+		if (udp_ring_get_status(hdr) != TP_STATUS_SEND_REQUEST)
+			break;
+
+		len = hdr->ur_len;
+		if (unlikely(len == 0 || len > max_len)) {
+			ur->stats.tx_errors++;
+			udp_ring_set_status(hdr, TP_STATUS_WRONG_FORMAT);
+			udp_ring_increment_head(rb);
+			continue;
+		}
+
+		udp_ring_set_status(hdr, TP_STATUS_SENDING);
+		err = udp_ring_send_frame(sk, hdr, len, flags);
+		if (unlikely(err < 0)) {
+			/* Leave the frame queued and report the error */
+			ur->stats.tx_errors++;
+			udp_ring_set_status(hdr, TP_STATUS_SEND_REQUEST);
+			break;
+		}
+
+		udp_ring_set_status(hdr, TP_STATUS_AVAILABLE);
+		udp_ring_increment_head(rb);
+		ur->stats.tx_frames++;
+		len_sum += len;
+		err = 0;
+
+		if (need_resched()) {
+			mutex_unlock(&ur->lock);
+			cond_resched();
+			mutex_lock(&ur->lock);
+			if (!rb->pg_vec)
+				break;
+		}
+	}
+out:
+	mutex_unlock(&ur->lock);
+	return len_sum ? len_sum : err;
+}
+
+static __u32 udp_ring_block_status(struct udp_ring_sock *ur, unsigned int n)
+{
+	struct tpacket_block_desc *pbd;
+
+	pbd = (struct tpacket_block_desc *)ur->rx.pg_vec[n];
+	smp_rmb();
+	flush_dcache_page(udp_ring_to_page(pbd));
+	return pbd->hdr.bh1.block_status;
+}
+
+static bool udp_ring_open_block(struct udp_ring_sock *ur)
+{
+	struct udp_ring_blk *blk = &ur->blk;
+	struct tpacket_block_desc *pbd;
+
+	/* Userspace has not returned the block yet: the ring is full */
+	if (udp_ring_block_status(ur, blk->cur) != TP_STATUS_KERNEL)
+		return false;
+
+	pbd = (struct tpacket_block_desc *)ur->rx.pg_vec[blk->cur];
+	pbd->version = TPACKET_V3;
+	pbd->offset_to_priv = UDP_RING_BLK_HDRLEN;
+	pbd->hdr.bh1.num_pkts = 0;
+	pbd->hdr.bh1.offset_to_first_pkt = blk->first_offset;
+	pbd->hdr.bh1.blk_len = 0;
+	pbd->hdr.bh1.seq_num = blk->seq++;
+
+	blk->open = 1;
+	blk->offset = blk->first_offset;
+	blk->num_pkts = 0;
+	blk->last = NULL;
+	return true;
+}
+
+/* Hand the current block over to userspace, called with blk->lock held */
+static void udp_ring_retire_block(struct sock *sk, struct udp_ring_sock *ur,
+				  __u32 status)
+{
+	struct udp_ring_blk *blk = &ur->blk;
+	char *start = ur->rx.pg_vec[blk->cur];
+	struct tpacket_block_desc *pbd = (struct tpacket_block_desc *)start;
+	char *p;
+
+	pbd->hdr.bh1.num_pkts = blk->num_pkts;
+	pbd->hdr.bh1.blk_len = blk->offset;
+	pbd->hdr.bh1.ts_first_pkt.ts_sec = blk->ts_first.tv_sec;
+	pbd->hdr.bh1.ts_first_pkt.ts_nsec = blk->ts_first.tv_nsec;
+	pbd->hdr.bh1.ts_last_pkt.ts_sec = blk->ts_last.tv_sec;
+	pbd->hdr.bh1.ts_last_pkt.ts_nsec = blk->ts_last.tv_nsec;
+
+	if (blk->losing) {
+		status |= TP_STATUS_LOSING;
+		blk->losing = 0;
+	}
+
+	/* Make the datagrams visible before the ownership word */
+	for (p = start + PAGE_SIZE; p < start + blk->offset; p += PAGE_SIZE)
+		flush_dcache_page(udp_ring_to_page(p));
+	smp_wmb();
+	pbd->hdr.bh1.block_status = TP_STATUS_USER | status;
+	flush_dcache_page(udp_ring_to_page(start));
+	smp_wmb();
+
+	blk->open = 0;
+	blk->cur = blk->cur != ur->rx.pg_vec_len - 1 ? blk->cur + 1 : 0;
+	ur->stats.rx_blocks++;
+	if (status & TP_STATUS_BLK_TMO)
+		ur->stats.rx_timeouts++;
+
+	sk->sk_data_ready(sk, 0);
+}
+
+static void udp_ring_retire_timer(unsigned long data)
+{
+	struct sock *sk = (struct sock *)data;
+	struct udp_ring_sock *ur;
+
+	/* udp_ring_destroy() waits for us before freeing the ring */
+	rcu_read_lock();
+	ur = rcu_dereference(udp_sk(sk)->ring);
+	if (ur) {
+		spin_lock(&ur->blk.lock);
+		if (ur->rx.pg_vec && ur->blk.open && ur->blk.num_pkts)
+			udp_ring_retire_block(sk, ur, TP_STATUS_BLK_TMO);
+		spin_unlock(&ur->blk.lock);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Store a datagram in the receive ring instead of the socket receive
+ * queue.  Called from udp_queue_rcv_skb() in softirq context, or from
+ * the socket backlog; the skb is always consumed.
+ */
+int udp_ring_rcv(struct sock *sk, struct sk_buff *skb)
+{
+	struct udp_ring_sock *ur;
+	struct udp_ring_blk *blk;
+	unsigned int len = skb->len - sizeof(struct udphdr);
+	unsigned int size = TPACKET_ALIGN(UDP_RING_HDRLEN + len);
+	unsigned int blk_size;
+	struct udp_ring_hdr *hdr;
+	struct timespec ts;
+
+	if (sk_filter(sk, skb))
+		goto drop;
+	if (udp_lib_checksum_complete(skb))
+		goto drop;
+
+	if (skb->tstamp.tv64)
+		ts = ktime_to_timespec(skb->tstamp);
+	else
+		getnstimeofday(&ts);
+
+	rcu_read_lock();
+	ur = rcu_dereference(udp_sk(sk)->ring);
+	if (unlikely(!ur)) {
+		/* The socket is being destroyed */
+		rcu_read_unlock();
+		goto drop;
+	}
+	blk = &ur->blk;
+
+	spin_lock_bh(&blk->lock);
+	if (unlikely(!ur->rx.pg_vec || len > blk->max_len))
+		goto ring_drop;
+
+	blk_size = ur->rx.pg_vec_pages * PAGE_SIZE;
+	if (blk->open && blk->offset + size > blk_size)
+		udp_ring_retire_block(sk, ur, 0);
+	if (!blk->open && !udp_ring_open_block(ur))
+		goto ring_drop;
+
+	hdr = (struct udp_ring_hdr *)(ur->rx.pg_vec[blk->cur] + blk->offset);
+	hdr->ur_status = TP_STATUS_USER;
+	hdr->ur_len = len;
+	hdr->ur_addr = ip_hdr(skb)->saddr;
+	hdr->ur_port = udp_hdr(skb)->source;
+	hdr->ur_pad = 0;
+	hdr->ur_next_offset = 0;
+	hdr->ur_sec = ts.tv_sec;
+	hdr->ur_nsec = ts.tv_nsec;
+	skb_copy_bits(skb, sizeof(struct udphdr),
+		      (char *)hdr + UDP_RING_HDRLEN, len);
+
+	if (blk->last)
+		blk->last->ur_next_offset = (char *)hdr - (char *)blk->last;
+	blk->last = hdr;
+	if (!blk->num_pkts++) {
+		blk->ts_first = ts;
+		/* Do not re-arm it once udp_ring_destroy() detached us */
+		if (rcu_access_pointer(udp_sk(sk)->ring) == ur)
+			mod_timer(&blk->retire_timer, jiffies + blk->tov);
+	}
+	blk->ts_last = ts;
+	blk->offset += size;
+	ur->stats.rx_frames++;
+	spin_unlock_bh(&blk->lock);
+	rcu_read_unlock();
+
+	UDP_INC_STATS_BH(sock_net(sk), UDP_MIB_INDATAGRAMS, 0);
+	consume_skb(skb);
+	return 0;
+
+ring_drop:
+	blk->losing = 1;
+	ur->stats.rx_drops++;
+	spin_unlock_bh(&blk->lock);
+	rcu_read_unlock();
+	UDP_INC_STATS_BH(sock_net(sk), UDP_MIB_RCVBUFERRORS, 0);
+drop:
+	UDP_INC_STATS_BH(sock_net(sk), UDP_MIB_INERRORS, 0);
+	atomic_inc(&sk->sk_drops);
+	kfree_skb(skb);
+	return -1;
+}
+
+unsigned int udp_ring_poll(struct sock *sk)
+{
+	struct udp_ring_sock *ur = udp_ring_sk(sk);
+	struct udp_ring_blk *blk = &ur->blk;
+	struct udp_ring_buf *rb = &ur->tx;
+	unsigned int mask = 0;
+
+	spin_lock_bh(&blk->lock);
+	if (ur->rx.pg_vec) {
+		/* Skip the blocks userspace has already returned */
+		while (blk->tail != blk->cur &&
+		       udp_ring_block_status(ur, blk->tail) == TP_STATUS_KERNEL)
+			blk->tail = blk->tail != ur->rx.pg_vec_len - 1 ?
+				    blk->tail + 1 : 0;
+		if (udp_ring_block_status(ur, blk->tail) & TP_STATUS_USER)
+			mask |= POLLIN | POLLRDNORM;
+	}
+	spin_unlock_bh(&blk->lock);
+
+	/*
+	 * A flush in progress owns the head; its completions wake us up
+	 * through sk_write_space once the datagrams leave the socket.
+	 */
+	if (!mutex_trylock(&ur->lock))
+		return mask;
+	if (rb->pg_vec &&
+	    udp_ring_get_status(udp_ring_frame(rb, rb->head)) ==
+	    TP_STATUS_AVAILABLE)
+		mask |= POLLOUT | POLLWRNORM;
+	mutex_unlock(&ur->lock);
+
+	return mask;
+}
+
+/*
+ * Called from ->destroy, before the socket is unhashed: datagrams may
+ * still be arriving.  Detach the rings under blk.lock so udp_ring_rcv()
+ * no longer arms the retire timer, wait for the receivers that still
+ * see them, and only then stop the timer and free the memory.
+ */
+void udp_ring_destroy(struct sock *sk)
+{
+	struct udp_sock *up = udp_sk(sk);
+	struct udp_ring_sock *ur = udp_ring_sk(sk);
+
+	if (!ur)
+		return;
+
+	spin_lock_bh(&ur->blk.lock);
+	rcu_assign_pointer(up->ring, NULL);
+	spin_unlock_bh(&ur->blk.lock);
+	synchronize_net();
+	del_timer_sync(&ur->blk.retire_timer);
+	if (ur->rx.pg_vec)
+		udp_ring_free_pg_vec(ur->rx.pg_vec, ur->rx.pg_vec_order,
+				     ur->rx.pg_vec_len);
+	if (ur->tx.pg_vec)
+		udp_ring_free_pg_vec(ur->tx.pg_vec, ur->tx.pg_vec_order,
+				     ur->tx.pg_vec_len);
+	kfree(ur);
+}
+
+static void udp_ring_mm_open(struct vm_area_struct *vma)
+{
+	struct socket *sock = vma->vm_file->private_data;
+	struct sock *sk = sock->sk;
+
+	if (sk && udp_ring_sk(sk))
+		atomic_inc(&udp_ring_sk(sk)->mapped);
+}
+
+static void udp_ring_mm_close(struct vm_area_struct *vma)
+{
+	struct socket *sock = vma->vm_file->private_data;
+	struct sock *sk = sock->sk;
+
+	if (sk && udp_ring_sk(sk))
+		atomic_dec(&udp_ring_sk(sk)->mapped);
+}
+
+static const struct vm_operations_struct udp_ring_mmap_ops = {
+	.open	= udp_ring_mm_open,
+	.close	= udp_ring_mm_close,
+};
+
+static int udp_ring_map(struct vm_area_struct *vma, unsigned long *start,
+			struct udp_ring_buf *rb)
+{
+	unsigned int i, pg;
+	int err;
+
+	for (i = 0; i < rb->pg_vec_len; i++) {
+		char *kaddr = rb->pg_vec[i];
+
+		for (pg = 0; pg < rb->pg_vec_pages; pg++) {
+			err = vm_insert_page(vma, *start,
+					     udp_ring_to_page(kaddr));
+			if (unlikely(err))
+				return err;
+			*start += PAGE_SIZE;
+			kaddr += PAGE_SIZE;
+		}
+	}
+	return 0;
+}
+
+int udp_ring_mmap(struct file *file, struct socket *sock,
+		  struct vm_area_struct *vma)
+{
+	struct sock *sk = sock->sk;
+	struct udp_ring_sock *ur;
+	struct udp_ring_buf *rb;
+	unsigned long expected_size, start;
+	int err = -EINVAL;
+
+	if (sk->sk_prot != &udp_prot)
+		return -ENODEV;
+	ur = udp_ring_sk(sk);
+	if (!ur || vma->vm_pgoff)
+		return -EINVAL;
+
+	mutex_lock(&ur->lock);
+	expected_size = 0;
+	for (rb = &ur->rx; rb <= &ur->tx; rb++)
+		expected_size += (unsigned long)rb->pg_vec_len *
+				 rb->pg_vec_pages * PAGE_SIZE;
+	if (!expected_size || vma->vm_end - vma->vm_start != expected_size)
+		goto out;
+
+	/* The receive ring, if any, comes first as with packet sockets */
+	start = vma->vm_start;
+	for (rb = &ur->rx; rb <= &ur->tx; rb++) {
+		if (!rb->pg_vec)
+			continue;
+		err = udp_ring_map(vma, &start, rb);
+		if (err)
+			goto out;
+	}
+
+	atomic_inc(&ur->mapped);
+	vma->vm_ops = &udp_ring_mmap_ops;
+out:
+	mutex_unlock(&ur->lock);
+	return err;
+}
@@ -142,6 +142,7 @@ void rpc_count_iostats(struct rpc_task *task)
 	struct rpc_iostats *stats;
 	struct rpc_iostats *op_metrics;
 	ktime_t delta;
+	int bucket;
 
 	if (!task->tk_client || !task->tk_client->cl_metrics || !req)
 		return;
@@ -160,6 +161,10 @@ void rpc_count_iostats(struct rpc_task *task)
 	op_metrics->om_queue = ktime_add(op_metrics->om_queue, delta);
 
 	op_metrics->om_rtt = ktime_add(op_metrics->om_rtt, req->rq_rtt);
+	bucket = fls64(ktime_to_us(req->rq_rtt) >> RPC_IOSTATS_HIST_SHIFT);
+	if (bucket >= RPC_IOSTATS_HIST)
+		bucket = RPC_IOSTATS_HIST - 1;
+	op_metrics->om_rtt_hist[bucket]++;
 
 	delta = ktime_sub(ktime_get(), task->tk_start);
 	op_metrics->om_execute = ktime_add(op_metrics->om_execute, delta);
@@ -209,6 +214,44 @@ void rpc_print_iostats(struct seq_file *seq, struct rpc_clnt *clnt)
 }
 EXPORT_SYMBOL_GPL(rpc_print_iostats);
 
+/**
+ * rpc_print_rtt_hist - show the RTT histograms of an RPC client
+ * @seq: seq_file to print to
+ * @clnt: RPC client
+ *
+ * Prints the lower bound of each bucket in usecs, then one line per
+ * procedure that was used. Nothing here starts with "RPC" or ends in a
+ * colon, so tools that parse the RPC iostats are not confused.
+ */
+void rpc_print_rtt_hist(struct seq_file *seq, struct rpc_clnt *clnt)
+{
+	struct rpc_iostats *stats = clnt->cl_metrics;
+	unsigned int op, i;
+
+	if (!stats)
+		return;
+
+	seq_printf(seq, "\trtt histogram (usecs): 0");
+	for (i = 1; i < RPC_IOSTATS_HIST; i++)
+		seq_printf(seq, " %u", 1U << (RPC_IOSTATS_HIST_SHIFT + i - 1));
+	seq_putc(seq, '\n');
+
+	for (op = 0; op < clnt->cl_maxproc; op++) {
+		struct rpc_iostats *metrics = &stats[op];
+
+		if (!metrics->om_ops)
+			continue;
+		if (clnt->cl_procinfo[op].p_name)
+			seq_printf(seq, "\t%12s", clnt->cl_procinfo[op].p_name);
+		else
+			seq_printf(seq, "\t%12u", op);
+		for (i = 0; i < RPC_IOSTATS_HIST; i++)
+			seq_printf(seq, " %lu", metrics->om_rtt_hist[i]);
+		seq_putc(seq, '\n');
+	}
+}
+EXPORT_SYMBOL_GPL(rpc_print_rtt_hist);
+
 /*
  * Register/unregister RPC proc files
  */
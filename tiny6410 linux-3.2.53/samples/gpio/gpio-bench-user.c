@@ -0,0 +1,159 @@
+/*
+ * GPIO toggle rate benchmark for userspace
+ *
+ * Compares writing the sysfs "value" attributes of a group of GPIOs with
+ * one GPIO_SET_MULTIPLE ioctl on /dev/gpio per bus write, and with
+ * GPIO_WRITE_BATCH on GPIOs claimed through /dev/gpio. The GPIOs must be
+ * exported and configured as outputs first; they are unexported before
+ * the last test. For GPIOs 160..167:
+ *
+ *	for i in $(seq 160 167); do
+ *		echo $i > /sys/class/gpio/export
+ *		echo out > /sys/class/gpio/gpio$i/direction
+ *	done
+ *	gpio-bench-user 160 0xff 100000
+ *
+ * The code may be used by anyone for any purpose.
+ */
+
+#include <linux/types.h>
+#include <linux/gpiodev.h>
+
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Values written by one GPIO_WRITE_BATCH call */
+#define BATCH	1024
+
+static double report(const char *name, unsigned long loops, double start)
+{
+	double secs = now() - start;
+	double rate = loops / secs;
+
+	printf("%-18s %lu bus writes in %.3f s, %.0f writes/s\n",
+	       name, loops, secs, rate);
+	return rate;
+}
+
+int main(int argc, char **argv)
+{
+	struct gpio_multiple gm;
+	struct gpio_claim gc;
+	struct gpio_batch gb;
+	__u32 seq[BATCH];
+	unsigned long base, mask, loops, i;
+	int fds[32], nfds = 0, fd, fd2, n;
+	double start, sysfs_rate, ioctl_rate, batch_rate;
+	char path[64];
+
+	if (argc != 4) {
+		fprintf(stderr, "usage: %s BASE MASK LOOPS\n", argv[0]);
+		return 1;
+	}
+	base = strtoul(argv[1], NULL, 0);
+	mask = strtoul(argv[2], NULL, 0) & 0xffffffffUL;
+	loops = strtoul(argv[3], NULL, 0);
+
+	for (n = 0; n < 32; n++) {
+		if (!(mask & (1UL << n)))
+			continue;
+		snprintf(path, sizeof(path), "/sys/class/gpio/gpio%lu/value",
+			 base + n);
+		fds[nfds] = open(path, O_WRONLY);
+		if (fds[nfds] < 0) {
+			perror(path);
+			return 1;
+		}
+		nfds++;
+	}
+
+	start = now();
+	for (i = 0; i < loops; i++)
+		for (n = 0; n < nfds; n++)
+			if (pwrite(fds[n], i & 1 ? "1" : "0", 1, 0) != 1) {
+				perror("sysfs write");
+				return 1;
+			}
+	sysfs_rate = report("sysfs", loops, start);
+
+	fd = open("/dev/gpio", O_RDWR);
+	if (fd < 0) {
+		perror("/dev/gpio");
+		return 1;
+	}
+
+	gm.base = base;
+	gm.mask = mask;
+	start = now();
+	for (i = 0; i < loops; i++) {
+		gm.bits = i & 1 ? mask : 0;
+		if (ioctl(fd, GPIO_SET_MULTIPLE, &gm) < 0) {
+			perror("GPIO_SET_MULTIPLE");
+			return 1;
+		}
+	}
+	ioctl_rate = report("GPIO_SET_MULTIPLE", loops, start);
+
+	/* A claim needs free GPIOs */
+	for (n = 0; n < nfds; n++)
+		close(fds[n]);
+	fd2 = open("/sys/class/gpio/unexport", O_WRONLY);
+	if (fd2 < 0) {
+		perror("/sys/class/gpio/unexport");
+		return 1;
+	}
+	for (n = 0; n < 32; n++) {
+		if (!(mask & (1UL << n)))
+			continue;
+		snprintf(path, sizeof(path), "%lu", base + n);
+		if (pwrite(fd2, path, strlen(path), 0) < 0) {
+			perror("unexport");
+			return 1;
+		}
+	}
+	close(fd2);
+
+	memset(&gc, 0, sizeof(gc));
+	gc.base = base;
+	gc.mask = mask;
+	gc.output = mask;
+	if (ioctl(fd, GPIO_CLAIM, &gc) < 0) {
+		perror("GPIO_CLAIM");
+		return 1;
+	}
+
+	for (i = 0; i < BATCH; i++)
+		seq[i] = i & 1 ? mask : 0;
+	memset(&gb, 0, sizeof(gb));
+	gb.values = (unsigned long)seq;
+	gb.mask = mask;
+	start = now();
+	for (i = 0; i < loops; i += gb.count) {
+		gb.count = loops - i < BATCH ? loops - i : BATCH;
+		if (ioctl(fd, GPIO_WRITE_BATCH, &gb) != (int)gb.count) {
+			perror("GPIO_WRITE_BATCH");
+			return 1;
+		}
+	}
+	batch_rate = report("GPIO_WRITE_BATCH", loops, start);
+
+	printf("speedup over sysfs: GPIO_SET_MULTIPLE %.1fx, "
+	       "GPIO_WRITE_BATCH %.1fx\n",
+	       ioctl_rate / sysfs_rate, batch_rate / sysfs_rate);
+	return 0;
+}
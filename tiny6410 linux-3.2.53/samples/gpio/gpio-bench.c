@@ -0,0 +1,102 @@
+/*
+ * GPIO toggle rate benchmark
+ *
+ * Drives a group of GPIOs like a parallel bus: each "bus write" sets all
+ * of them to a new value, first with one gpio_set_value() call per GPIO,
+ * then with one gpio_set_multiple() call. The GPIOs are requested and
+ * configured as outputs, so nothing else may use them.
+ *
+ *	modprobe gpio-bench base=160 mask=0xff loops=100000
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/gpio.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+
+static int base = -1;
+module_param(base, int, S_IRUGO);
+MODULE_PARM_DESC(base, "GPIO corresponding to bit 0 of mask");
+
+static unsigned long mask = 0xff;
+module_param(mask, ulong, S_IRUGO);
+MODULE_PARM_DESC(mask, "GPIOs to drive (default: 0xff)");
+
+static unsigned int loops = 100000;
+module_param(loops, uint, S_IRUGO);
+MODULE_PARM_DESC(loops, "Number of bus writes (default: 100000)");
+
+static void report(const char *name, ktime_t start)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	pr_info("gpio-bench: %-18s %u bus writes in %lld us, %llu writes/s\n",
+		name, loops, div_s64(ns, NSEC_PER_USEC),
+		div64_u64((u64)loops * NSEC_PER_SEC, max_t(s64, ns, 1)));
+}
+
+static void free_gpios(unsigned long m)
+{
+	for (; m; m &= m - 1)
+		gpio_free(base + __ffs(m));
+}
+
+static int __init gpio_bench_init(void)
+{
+	unsigned long m, requested = 0;
+	unsigned int i;
+	ktime_t start;
+	int err = 0;
+
+	if (!gpio_is_valid(base) || !mask) {
+		pr_err("gpio-bench: specify base= and mask=\n");
+		return -EINVAL;
+	}
+
+	for (m = mask; m; m &= m - 1) {
+		unsigned gpio = base + __ffs(m);
+
+		err = gpio_request_one(gpio, GPIOF_OUT_INIT_LOW, "gpio-bench");
+		if (err) {
+			pr_err("gpio-bench: cannot get GPIO %u, error %d\n",
+			       gpio, err);
+			goto out;
+		}
+		requested |= m & -m;
+		if (gpio_cansleep(gpio)) {
+			pr_err("gpio-bench: GPIO %u may sleep\n", gpio);
+			err = -EINVAL;
+			goto out;
+		}
+	}
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		for (m = mask; m; m &= m - 1)
+			gpio_set_value(base + __ffs(m), i & 1);
+	report("gpio_set_value", start);
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		gpio_set_multiple(base, mask, i & 1 ? mask : 0);
+	report("gpio_set_multiple", start);
+
+out:
+	free_gpios(requested);
+	return err;
+}
+
+static void __exit gpio_bench_exit(void)
+{
+}
+
+module_init(gpio_bench_init);
+module_exit(gpio_bench_exit);
+MODULE_DESCRIPTION("GPIO toggle rate benchmark");
+MODULE_LICENSE("GPL");
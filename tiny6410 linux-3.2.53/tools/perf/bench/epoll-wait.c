@@ -0,0 +1,181 @@
+/*
+ *
+ * epoll-wait.c
+ *
+ * wait: Benchmark for epoll_wait() versus the number of ready descriptors
+ *
+ * A set of pipes is registered with one epoll instance. For every ready
+ * count R, R pipes are written (this runs the epoll wakeup callback R
+ * times) and the R events are collected with epoll_wait(). Both steps
+ * are timed separately; draining the pipes is not timed.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+static int nr_fds = 1000;
+static int loops = 1000;
+static const char *ready_str = "1,10,100,1000";
+static bool edge;
+
+static const struct option options[] = {
+	OPT_INTEGER('n', "fds", &nr_fds,
+		    "Specify number of pipes registered with epoll"),
+	OPT_STRING('r', "ready", &ready_str, "1,10,...",
+		   "Specify comma separated numbers of ready pipes"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of loops per ready count"),
+	OPT_BOOLEAN('e', "edge", &edge,
+		    "Register the pipes with EPOLLET"),
+	OPT_END()
+};
+
+static const char * const bench_epoll_wait_usage[] = {
+	"perf bench epoll wait <options>",
+	NULL
+};
+
+static unsigned long long ns_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void raise_nofile(int nr)
+{
+	struct rlimit rl;
+
+	if (getrlimit(RLIMIT_NOFILE, &rl))
+		die("getrlimit: %s\n", strerror(errno));
+	if (rl.rlim_cur >= (rlim_t)nr)
+		return;
+	rl.rlim_cur = nr;
+	if (rl.rlim_max < rl.rlim_cur)
+		rl.rlim_max = rl.rlim_cur;
+	if (setrlimit(RLIMIT_NOFILE, &rl))
+		die("cannot raise the open files limit to %d: %s\n",
+		    nr, strerror(errno));
+}
+
+int bench_epoll_wait(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct epoll_event ev, *events;
+	unsigned long long t0, t1, post_ns, wait_ns;
+	const char *s;
+	int (*fds)[2];
+	int epfd, ready, got, n, i, j;
+	char c = 0;
+
+	/* see sched-pipe.c */
+	int __used ret;
+
+	argc = parse_options(argc, argv, options,
+			     bench_epoll_wait_usage, 0);
+
+	if (nr_fds <= 0 || loops <= 0)
+		usage_with_options(bench_epoll_wait_usage, options);
+
+	raise_nofile(nr_fds * 2 + 16);
+
+	fds = calloc(nr_fds, sizeof(*fds));
+	events = calloc(nr_fds, sizeof(*events));
+	if (!fds || !events)
+		die("out of memory\n");
+
+	epfd = epoll_create(nr_fds);
+	if (epfd < 0)
+		die("epoll_create: %s\n", strerror(errno));
+
+	for (i = 0; i < nr_fds; i++) {
+		if (pipe(fds[i]))
+			die("pipe: %s\n", strerror(errno));
+		ev.events = EPOLLIN | (edge ? EPOLLET : 0);
+		ev.data.u32 = i;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i][0], &ev))
+			die("epoll_ctl: %s\n", strerror(errno));
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT) {
+		printf("# %d pipes on one epoll instance%s, %d loops\n\n",
+		       nr_fds, edge ? " (edge triggered)" : "", loops);
+		printf(" %8s %14s %14s %14s\n", "ready",
+		       "post ns/fd", "wait usecs", "wait ns/event");
+	}
+
+	for (s = ready_str; *s; s += *s == ',') {
+		ready = strtol(s, (char **)&s, 10);
+		if (ready <= 0 || (*s && *s != ','))
+			die("bad ready count list: %s\n", ready_str);
+		if (ready > nr_fds)
+			ready = nr_fds;
+
+		post_ns = wait_ns = 0;
+		for (i = 0; i < loops; i++) {
+			t0 = ns_now();
+			for (j = 0; j < ready; j++)
+				ret = write(fds[j][1], &c, 1);
+			t1 = ns_now();
+			post_ns += t1 - t0;
+
+			for (got = 0; got < ready; got += n) {
+				n = epoll_wait(epfd, events, nr_fds, -1);
+				if (n < 0 && errno != EINTR)
+					die("epoll_wait: %s\n",
+					    strerror(errno));
+				if (n < 0)
+					n = 0;
+			}
+			wait_ns += ns_now() - t1;
+
+			for (j = 0; j < ready; j++)
+				ret = read(fds[j][0], &c, 1);
+		}
+
+		switch (bench_format) {
+		case BENCH_FORMAT_DEFAULT:
+			printf(" %8d %14.1f %14.3f %14.1f\n", ready,
+			       (double)post_ns / loops / ready,
+			       (double)wait_ns / loops / 1000,
+			       (double)wait_ns / loops / ready);
+			break;
+
+		case BENCH_FORMAT_SIMPLE:
+			printf("%d %.1f %.3f\n", ready,
+			       (double)post_ns / loops / ready,
+			       (double)wait_ns / loops / 1000);
+			break;
+
+		default:
+			/* reaching here is something disaster */
+			fprintf(stderr, "Unknown format:%d\n", bench_format);
+			exit(1);
+			break;
+		}
+	}
+
+	for (i = 0; i < nr_fds; i++) {
+		close(fds[i][0]);
+		close(fds[i][1]);
+	}
+	close(epfd);
+	free(events);
+	free(fds);
+
+	return 0;
+}
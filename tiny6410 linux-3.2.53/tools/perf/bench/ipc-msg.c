@@ -0,0 +1,197 @@
+/*
+ *
+ * ipc-msg.c
+ *
+ * msg: Benchmark for System V message queue throughput
+ *
+ * One process sends messages of a given size to another one through a
+ * private message queue, for each size in a list. Compare the results
+ * with /proc/sys/kernel/msgdirect set to 0 and to the smallest size to
+ * see the effect of direct copies.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/wait.h>
+#include <signal.h>
+
+static int loops = 10000;
+static const char *sizes_str = "64,256,1024,4096,16384,65536";
+
+static const struct option options[] = {
+	OPT_STRING('s', "sizes", &sizes_str, "64,256,...",
+		   "Specify comma separated message sizes in bytes"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of messages per size"),
+	OPT_END()
+};
+
+static const char * const bench_ipc_msg_usage[] = {
+	"perf bench ipc msg <options>",
+	NULL
+};
+
+struct bench_msg {
+	long mtype;
+	char mtext[0];
+};
+
+static long read_sysctl(const char *name)
+{
+	char path[64];
+	long val = -1;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/sys/kernel/%s", name);
+	f = fopen(path, "r");
+	if (!f)
+		return -1;
+	if (fscanf(f, "%ld", &val) != 1)
+		val = -1;
+	fclose(f);
+	return val;
+}
+
+/* Returns the nsecs it took to pass loops messages of size bytes */
+static unsigned long long run_size(int qid, size_t size)
+{
+	struct bench_msg *m;
+	struct timespec start, stop;
+	int i, wait_stat;
+	pid_t pid;
+
+	m = calloc(1, sizeof(*m) + size);
+	if (!m)
+		die("out of memory\n");
+	m->mtype = 1;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0)
+		die("fork: %s\n", strerror(errno));
+
+	if (!pid) {
+		for (i = 0; i < loops; i++) {
+			if (msgrcv(qid, m, size, 0, 0) < 0) {
+				if (errno == EINTR) {
+					i--;
+					continue;
+				}
+				_exit(1);
+			}
+		}
+		_exit(0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < loops; i++) {
+		if (msgsnd(qid, m, size, 0) < 0) {
+			if (errno == EINTR) {
+				i--;
+				continue;
+			}
+			kill(pid, SIGKILL);
+			die("msgsnd: %s\n", strerror(errno));
+		}
+	}
+	if (waitpid(pid, &wait_stat, 0) != pid ||
+	    !WIFEXITED(wait_stat) || WEXITSTATUS(wait_stat))
+		die("receiver failed\n");
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	free(m);
+	return (stop.tv_sec - start.tv_sec) * 1000000000ULL +
+		stop.tv_nsec - start.tv_nsec;
+}
+
+int bench_ipc_msg(int argc, const char **argv,
+		  const char *prefix __used)
+{
+	struct msqid_ds ds;
+	unsigned long long ns;
+	long msgmax, size;
+	const char *s;
+	int qid;
+
+	argc = parse_options(argc, argv, options,
+			     bench_ipc_msg_usage, 0);
+
+	if (loops <= 0)
+		usage_with_options(bench_ipc_msg_usage, options);
+
+	msgmax = read_sysctl("msgmax");
+
+	qid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+	if (qid < 0)
+		die("msgget: %s\n", strerror(errno));
+	if (msgctl(qid, IPC_STAT, &ds))
+		die("msgctl: %s\n", strerror(errno));
+
+	if (bench_format == BENCH_FORMAT_DEFAULT) {
+		printf("# %d messages per size, msgdirect = %ld\n\n",
+		       loops, read_sysctl("msgdirect"));
+		printf(" %8s %14s %14s\n", "bytes", "MB/sec", "usecs/msg");
+	}
+
+	for (s = sizes_str; *s; s += *s == ',') {
+		size = strtol(s, (char **)&s, 10);
+		if (size <= 0 || (*s && *s != ','))
+			die("bad size list: %s\n", sizes_str);
+
+		if (msgmax >= 0 && size > msgmax) {
+			fprintf(stderr, "# %ld bytes: skipped, above "
+				"kernel.msgmax (%ld)\n", size, msgmax);
+			continue;
+		}
+
+		/* Let a few messages fit into the queue if we may */
+		if (ds.msg_qbytes < (msglen_t)size * 4) {
+			ds.msg_qbytes = size * 4;
+			msgctl(qid, IPC_SET, &ds);
+			msgctl(qid, IPC_STAT, &ds);
+		}
+		if (ds.msg_qbytes < (msglen_t)size) {
+			fprintf(stderr, "# %ld bytes: skipped, above the "
+				"queue size (%lu)\n", size,
+				(unsigned long)ds.msg_qbytes);
+			continue;
+		}
+
+		ns = run_size(qid, size);
+
+		switch (bench_format) {
+		case BENCH_FORMAT_DEFAULT:
+			printf(" %8ld %14.2f %14.3f\n", size,
+			       (double)size * loops * 1000 / ns,
+			       (double)ns / loops / 1000);
+			break;
+
+		case BENCH_FORMAT_SIMPLE:
+			printf("%ld %.2f\n", size,
+			       (double)size * loops * 1000 / ns);
+			break;
+
+		default:
+			/* reaching here is something disaster */
+			fprintf(stderr, "Unknown format:%d\n", bench_format);
+			exit(1);
+			break;
+		}
+	}
+
+	msgctl(qid, IPC_RMID, NULL);
+	return 0;
+}
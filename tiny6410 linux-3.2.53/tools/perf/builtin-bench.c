@@ -13,6 +13,8 @@
  * Available subsystem list:
  *  sched ... scheduler and IPC mechanism
  *  mem   ... memory access performance
+ *  epoll ... event polling scalability
+ *  ipc   ... System V IPC throughput
  *
  */
 
@@ -58,6 +60,26 @@ static struct bench_suite mem_suites[] = {
 	  NULL             }
 };
 
+static struct bench_suite epoll_suites[] = {
+	{ "wait",
+	  "epoll_wait() latency versus number of ready descriptors",
+	  bench_epoll_wait },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite ipc_suites[] = {
+	{ "msg",
+	  "Message queue throughput for various message sizes",
+	  bench_ipc_msg },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL          }
+};
+
 struct bench_subsys {
 	const char *name;
 	const char *summary;
@@ -71,6 +93,12 @@ static struct bench_subsys subsystems[] = {
 	{ "mem",
 	  "memory access performance",
 	  mem_suites },
+	{ "epoll",
+	  "event polling scalability",
+	  epoll_suites },
+	{ "ipc",
+	  "System V IPC throughput",
+	  ipc_suites },
 	{ "all",		/* sentinel: easy for help */
 	  "test all subsystem (pseudo subsystem)",
 	  NULL },